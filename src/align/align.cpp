@@ -18,6 +18,8 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ****/
 
+#include <chrono>
+#include <fstream>
 #include <memory>
 #include "../basic/value.h"
 #include "align.h"
@@ -27,6 +29,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "legacy/pipeline.h"
 #include "../util/async_buffer.h"
 #include "../util/parallel/thread_pool.h"
+#include "../util/trace.h"
+#include "../util/memory/memory_tracker.h"
+#include "../util/status.h"
 #if _MSC_FULL_VER == 191627042
 #include "../util/algo/merge_sort.h"
 #endif
@@ -36,6 +41,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #endif
 #include "../util/algo/radix_sort.h"
 #include "target.h"
+#include "replay.h"
 #define _REENTRANT
 #include "../lib/ips4o/ips4o.hpp"
 
@@ -50,6 +56,25 @@ using std::vector;
 
 DpStat dp_stat;
 
+// Lower bound for the size of the output backlog, before threads that finished out of order wait.
+static const int64_t MIN_OUTPUT_BACKLOG = 64 * MEGABYTES;
+
+// Per query cost records (--query-cost-file), appended by the align threads once per batch.
+static std::ofstream query_cost_out;
+static mutex query_cost_mtx;
+static std::once_flag query_cost_open;
+
+static void write_query_costs(const TextBuffer& buf) {
+	std::call_once(query_cost_open, []() {
+		query_cost_out.open(config.query_cost_file);
+		if (!query_cost_out)
+			throw std::runtime_error("Error opening file " + config.query_cost_file);
+		query_cost_out << "query\tquery_len\tref_block\tseed_hits\ttargets\tdp_cells\ttime_us\tmode\n";
+	});
+	lock_guard<mutex> lock(query_cost_mtx);
+	query_cost_out.write(buf.data(), buf.size());
+}
+
 static vector<int64_t> partition;
 
 namespace Extension {
@@ -223,6 +248,7 @@ TextBuffer* legacy_pipeline(const HitIterator::Hits& hits, Search::Config& cfg,
 bool align_worker(HitIterator* hit_it, ThreadPool::TaskSet* task_set, Search::Config* cfg)
 {
 	try {
+		Util::Trace::Span span("Align batch");
 		vector<HitIterator::Hits> hits = **hit_it;
 #ifdef OLD
 		if(hit_it->good(hits))
@@ -234,6 +260,9 @@ bool align_worker(HitIterator* hit_it, ThreadPool::TaskSet* task_set, Search::Co
 		Statistics stat;
 		DpStat dp_stat;
 		const bool parallel = config.swipe_all && (cfg->target->seqs().size() >= cfg->query->seqs().size());
+		stat.inc(Statistics::QUERIES_EXTENDED, hits.size());
+		const bool log_cost = !config.query_cost_file.empty();
+		TextBuffer cost_buf;
 
 		for (auto h = hits.cbegin(); h < hits.cend(); ++h) {
 			if (config.frame_shift != 0) {
@@ -251,11 +280,31 @@ bool align_worker(HitIterator* hit_it, ThreadPool::TaskSet* task_set, Search::Co
 				continue;
 			}
 
+			const int64_t seed_hits = h->end - h->begin;
+			// Hard queries are run target parallel as tasks on the align thread pool, so that idle workers pick them up
+			// without starting threads of their own. With a single worker there is nobody to share with, and they fall back to
+			// the query parallel path.
+			const bool hard = !parallel && config.hard_query_seed_hits > 0 && seed_hits >= config.hard_query_seed_hits,
+				hard_fallback = hard && cfg->thread_pool->thread_count() < 2;
+			if (hard)
+				stat.inc(Statistics::HARD_QUERIES);
+			if (hard_fallback)
+				stat.inc(Statistics::HARD_QUERIES_FALLBACK);
+			const DP::Flags flags = parallel ? DP::Flags::PARALLEL : (hard && !hard_fallback ? DP::Flags::PARALLEL | DP::Flags::THREAD_POOL : DP::Flags::NONE);
+			const stat_type targets0 = stat.get(Statistics::TARGET_HITS0), cells0 = stat.get(Statistics::GROSS_DP_CELLS);
+			const auto t0 = std::chrono::steady_clock::now();
+
 			pair<vector<Extension::Match>, Extension::Stats> matches =
 #ifdef WITH_DNA
            align_mode.mode == AlignMode::blastn ? Dna::extend(*cfg, cfg->query->seqs()[h->query]) :
 #endif
-				Extension::extend(h->query, h->begin, h->end, *cfg, stat, parallel ? DP::Flags::PARALLEL : DP::Flags::NONE);
+				Extension::extend(h->query, h->begin, h->end, *cfg, stat, flags);
+			if (log_cost) {
+				const auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t0).count();
+				cost_buf << cfg->query->ids()[h->query] << '\t' << cfg->query->source_len(h->query) << '\t' << cfg->current_ref_block << '\t' << seed_hits
+					<< '\t' << stat.get(Statistics::TARGET_HITS0) - targets0 << '\t' << stat.get(Statistics::GROSS_DP_CELLS) - cells0 << '\t' << (int64_t)us
+					<< '\t' << (parallel ? "parallel" : (hard ? (hard_fallback ? "hard_fallback" : "hard") : "normal")) << '\n';
+			}
 			TextBuffer* buf = cfg->blocked_processing ? Extension::generate_intermediate_output(matches.first, h->query, *cfg) : Extension::generate_output(matches.first, matches.second, h->query, stat, *cfg);
 			if (!matches.first.empty() && cfg->track_aligned_queries) {
 				std::lock_guard<std::mutex> lock(query_aligned_mtx);
@@ -278,6 +327,8 @@ bool align_worker(HitIterator* hit_it, ThreadPool::TaskSet* task_set, Search::Co
 
 		}
 
+		if (log_cost && cost_buf.size() > 0)
+			write_query_costs(cost_buf);
 		statistics += stat;
 		::dp_stat += dp_stat;
 	}
@@ -289,30 +340,32 @@ bool align_worker(HitIterator* hit_it, ThreadPool::TaskSet* task_set, Search::Co
 
 void align_queries(Consumer* output_file, Search::Config& cfg)
 {
-	const int64_t mem_limit = Util::String::interpret_number(config.memory_limit.get("16G"));
-
 	pair<BlockId, BlockId> query_range;
 	TaskTimer timer(nullptr, 3);
 
-	if (!cfg.blocked_processing && !cfg.iterated())
+	if (!cfg.blocked_processing && !cfg.iterated() && cfg.db)
 		cfg.db->init_random_access(cfg.current_query_block, 0, false);
+	unique_ptr<Replay> capture(Replay::capture(cfg) ? new Replay(cfg) : nullptr);
 
-	int64_t res_size = cfg.query->mem_size() + cfg.target->mem_size(), last_size = 0;
-	cfg.seed_hit_buf->load(std::min(mem_limit - res_size - cfg.seed_hit_buf->bin_size(1) * (int64_t)sizeof(Search::Hit), config.trace_pt_fetch_size));
+	const int64_t disk_size = cfg.seed_hit_buf->disk_size();
+	Util::Status::set_temp_disk(disk_size);
+	// Seed hit bins that do not fit into the memory left under the limit stay on disk until the
+	// previous bins have been processed.
+	cfg.seed_hit_buf->load(std::min(Util::Memory::available() - cfg.seed_hit_buf->bin_size(1) * (int64_t)sizeof(Search::Hit), config.trace_pt_fetch_size));
 
 	while (true) {
 		timer.go("Loading trace points");				
-		tuple<vector<Search::Hit>*, BlockId, BlockId> input = cfg.seed_hit_buf->retrieve();
+		tuple<AsyncBuffer<Search::Hit>::Vector*, BlockId, BlockId> input = cfg.seed_hit_buf->retrieve();
 		if (get<0>(input) == nullptr)
 			break;
 		statistics.inc(Statistics::TIME_LOAD_SEED_HITS, timer.microseconds());
-		vector<Search::Hit>* hit_buf = get<0>(input);
-		res_size += hit_buf->size() * sizeof(Search::Hit);
+		AsyncBuffer<Search::Hit>::Vector* hit_buf = get<0>(input);
 		query_range = { get<1>(input), get<2>(input) };
-		cfg.seed_hit_buf->load(std::min(mem_limit - res_size, config.trace_pt_fetch_size));
+		Util::Status::set_temp_disk(disk_size - (int64_t)cfg.seed_hit_buf->total_disk_size());
+		cfg.seed_hit_buf->load(std::min(Util::Memory::available(), config.trace_pt_fetch_size));
 
-		if (res_size + last_size > mem_limit)
-			log_stream << "Warning: resident size (" << (res_size + last_size) << ") exceeds memory limit." << std::endl;
+		if (Util::Memory::available() < 0)
+			log_stream << "Warning: tracked memory (" << Util::Memory::total() << ") exceeds memory limit." << std::endl;
 
 		timer.go("Sorting trace points");
 #ifdef NDEBUG
@@ -321,6 +374,8 @@ void align_queries(Consumer* output_file, Search::Config& cfg)
 		std::sort(hit_buf->begin(), hit_buf->end());
 #endif
 		statistics.inc(Statistics::TIME_SORT_SEED_HITS, timer.microseconds());
+		if (capture)
+			capture->add(hit_buf->data(), hit_buf->data() + hit_buf->size());
 
 #ifndef OLD
 		timer.go("Computing partition");
@@ -331,6 +386,7 @@ void align_queries(Consumer* output_file, Search::Config& cfg)
 		HitIterator hit_it(query_range.first, query_range.second, hit_buf->data(), hit_buf->data() + hit_buf->size());
         OutputWriter writer{output_file, (*cfg.output_format == OutputFormat::json) ? ',' : char(0)};
 		output_sink.reset(new ReorderQueue<TextBuffer*, OutputWriter>(query_range.first, writer));
+		output_sink->set_size_limit((size_t)std::max(Util::Memory::available(), MIN_OUTPUT_BACKLOG));
 		unique_ptr<thread> heartbeat;
 		if (config.verbosity >= 3 && config.load_balancing == Config::query_parallel && !config.swipe_all && config.heartbeat)
 			heartbeat.reset(new thread(heartbeat_worker, query_range.second, &cfg));
@@ -358,16 +414,17 @@ void align_queries(Consumer* output_file, Search::Config& cfg)
 		timer.go("Deallocating buffers");
 		cfg.thread_pool.reset();
 		output_sink.reset();
-		last_size = hit_buf->size() * sizeof(Search::Hit);
-		res_size -= last_size;
 		delete hit_buf;
 	}
 	statistics.max(Statistics::SEARCH_TEMP_SPACE, cfg.seed_hit_buf->total_disk_size());
+	Util::Status::set_temp_disk(0);
 	for (auto i : Extension::target_matrices)
 		delete[] i;
 	Extension::target_matrices.clear();
 	statistics.inc(Statistics::MATRIX_ADJUST_COUNT, Extension::target_matrix_count);
 
-	if (!cfg.blocked_processing && !cfg.iterated())
+	if (!cfg.blocked_processing && !cfg.iterated() && cfg.db)
 		cfg.db->end_random_access(false);
+	if (capture)
+		capture->write(config.replay_file);
 }
\ No newline at end of file
@@ -88,7 +88,10 @@ pair<FlatArray<SeedHit>, vector<uint32_t>> gapped_filter(const Sequence* query,
 	
 	if(flag_any(flags, DP::Flags::PARALLEL)) {
 		mutex mtx;
-		Util::Parallel::scheduled_thread_pool_auto(config.threads_, n, gapped_filter_worker, query_profile.data(), seed_hits, target_block_ids, &hits_out, &target_ids_out, &mtx, &params);
+		if (flag_any(flags, DP::Flags::THREAD_POOL))
+			Util::Parallel::thread_pool_tasks(*params.thread_pool, n, gapped_filter_worker, query_profile.data(), seed_hits, target_block_ids, &hits_out, &target_ids_out, &mtx, &params);
+		else
+			Util::Parallel::scheduled_thread_pool_auto(config.threads_, n, gapped_filter_worker, query_profile.data(), seed_hits, target_block_ids, &hits_out, &target_ids_out, &mtx, &params);
 	}
 	else {
 
@@ -222,7 +222,7 @@ pair<vector<Target>, Stats> align(const vector<WorkTarget> &targets, const Seque
 			const auto v8 = p8.pointers(0), vr8 = p8_rev.pointers(0);
 			for (int i = 0; i < 6; ++i)
 				for (const DpTarget& t : dp_targets[frame][i]) {
-					const char* tid = cfg.target->ids()[r[t.target_idx].block_id];
+					const char* tid = cfg.target->has_ids() ? cfg.target->ids()[r[t.target_idx].block_id] : "";
 					DP::PrefixScan::Config cfg{ query_seq[frame], t.seq, query_id, tid, t.d_begin, t.d_end,
 						t.chaining_target_range, v.data(), vr.data(), v8.data(), vr8.data(), stat, 0, 0, t.chaining_score };
 					//Hsp h = DP::PrefixScan::align(cfg);
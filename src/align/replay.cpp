@@ -0,0 +1,308 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2024 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <buchfink@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#include <stdexcept>
+#include "replay.h"
+#include "align.h"
+#include "../basic/config.h"
+#include "../data/block/block.h"
+#include "../data/sequence_file.h"
+#include "../output/output_format.h"
+#include "../run/config.h"
+#include "../search/search.h"
+#include "../stats/score_matrix.h"
+#include "../util/async_buffer.h"
+#include "../util/io/input_file.h"
+#include "../util/io/output_file.h"
+#include "../util/log_stream.h"
+
+using std::string;
+using std::vector;
+using std::pair;
+using std::runtime_error;
+using std::endl;
+
+const uint64_t Replay::MAGIC_NUMBER = 0x7d2c91e4a05b3f68llu;
+const uint32_t Replay::VERSION = 0;
+
+enum { SOURCE_SEQS = 1, UNMASKED_SEQS = 2 };
+
+static bool captured = false;
+
+static void write_seq(OutputFile& out, Sequence seq) {
+	out.write((int32_t)seq.length());
+	out.write(seq.data(), seq.length());
+}
+
+static void read_seq(Deserializer& in, SequenceSet& seqs, vector<Letter>& buf) {
+	int32_t len;
+	in.read(len);
+	buf.resize(len);
+	if (in.read(buf.data(), len) != (size_t)len)
+		throw runtime_error("Unexpected end of replay file.");
+	seqs.push_back(buf.cbegin(), buf.cend());
+}
+
+Replay::Replay(Search::Config& cfg):
+	cfg_(cfg)
+{}
+
+bool Replay::capture(const Search::Config& cfg) {
+	return !config.replay_file.empty() && !captured && config.command != Config::blastn && cfg.current_query_block == 0
+		&& cfg.current_ref_block == config.replay_ref_block;
+}
+
+void Replay::add(const Search::Hit* begin, const Search::Hit* end) {
+	hits_.insert(hits_.end(), begin, end);
+}
+
+void Replay::write(const string& file_name) {
+	TaskTimer timer("Writing replay file");
+	captured = true;
+	const int contexts = align_mode.query_contexts;
+	Block& query = *cfg_.query, & target = *cfg_.target;
+	vector<BlockId> query_map(query.seqs().size() / contexts, -1), target_map(target.seqs().size(), -1);
+	vector<pair<BlockId, Loc>> subjects;
+	subjects.reserve(hits_.size());
+	for (const Search::Hit& hit : hits_) {
+		query_map[hit.query_ / contexts] = 0;
+		subjects.push_back(target.seqs().local_position((int64_t)hit.subject_));
+		target_map[subjects.back().first] = 0;
+	}
+
+	BlockId query_count = 0;
+	for (BlockId& i : query_map)
+		if (i == 0)
+			i = query_count++;
+
+	// Targets that have not been masked yet under lazy masking are masked in a copy, so that the
+	// replay runs on the same sequences as the extension stage.
+	SequenceSet target_seqs(target.alphabet());
+	vector<Letter> seq;
+	for (BlockId i = 0; i < (BlockId)target_map.size(); ++i) {
+		if (target_map[i] == -1)
+			continue;
+		target_map[i] = target_seqs.size();
+		if (cfg_.lazy_masking && target.fetch_seq_if_unmasked(i, seq)) {
+			Masking::get()(seq.data(), seq.size(), cfg_.target_masking, i);
+			target_seqs.push_back(seq.cbegin(), seq.cend());
+		}
+		else
+			target_seqs.push_back(target.seqs()[i].data(), target.seqs()[i].end());
+	}
+	target_seqs.finish_reserve();
+
+	OutputFile out(file_name);
+	out.write(MAGIC_NUMBER);
+	out.write(VERSION);
+	out.write((int32_t)align_mode.mode);
+	out.write((int32_t)config.sensitivity);
+	out.write((int32_t)contexts);
+	out.write((int32_t)cfg_.current_ref_block);
+	out.write(cfg_.db_seqs);
+	out.write(cfg_.db_letters);
+
+	out.write((int32_t)query.alphabet());
+	out.write((int64_t)query_count);
+	out.write((int32_t)(align_mode.query_translated ? SOURCE_SEQS : 0));
+	for (BlockId i = 0; i < (BlockId)query_map.size(); ++i) {
+		if (query_map[i] == -1)
+			continue;
+		out.write((int64_t)query.block_id2oid(i));
+		out << string(query.ids()[i]);
+		if (align_mode.query_translated)
+			write_seq(out, query.source_seqs()[i]);
+		for (int j = 0; j < contexts; ++j)
+			write_seq(out, query.seqs()[i * contexts + j]);
+	}
+
+	const bool unmasked = !target.unmasked_seqs().empty();
+	if (!target.has_ids())
+		cfg_.db->init_random_access(cfg_.current_query_block, 0, false);
+	out.write((int32_t)target.alphabet());
+	out.write((int64_t)target_seqs.size());
+	out.write((int32_t)(unmasked ? UNMASKED_SEQS : 0));
+	for (BlockId i = 0; i < (BlockId)target_map.size(); ++i) {
+		if (target_map[i] == -1)
+			continue;
+		const OId oid = target.block_id2oid(i);
+		out.write((int64_t)oid);
+		out << (target.has_ids() ? string(target.ids()[i]) : cfg_.db->seqid(oid));
+		write_seq(out, target_seqs[target_map[i]]);
+		if (unmasked)
+			write_seq(out, target.unmasked_seqs()[i]);
+	}
+	if (!target.has_ids())
+		cfg_.db->end_random_access(false);
+
+	out.write((int64_t)hits_.size());
+	for (size_t i = 0; i < hits_.size(); ++i) {
+		const Search::Hit& hit = hits_[i];
+		out.write((uint32_t)(query_map[hit.query_ / contexts] * contexts + hit.query_ % contexts));
+		out.write((uint64_t)target_seqs.position(target_map[subjects[i].first], subjects[i].second));
+		out.write((int32_t)hit.seed_offset_);
+		out.write(hit.score_);
+	}
+	out.close();
+	timer.finish();
+	message_stream << "Captured " << hits_.size() << " seed hits of " << query_count << " queries and " << target_seqs.size()
+		<< " targets (reference block " << cfg_.current_ref_block << ") into " << file_name << endl;
+	hits_.clear();
+	hits_.shrink_to_fit();
+}
+
+Block* Replay::read_block(Deserializer& in, int contexts) {
+	int32_t alphabet, flags;
+	int64_t n;
+	in.read(alphabet);
+	in.read(n);
+	in.read(flags);
+	Block* block = new Block((Alphabet)alphabet);
+	string title;
+	vector<Letter> buf;
+	for (int64_t i = 0; i < n; ++i) {
+		int64_t oid;
+		in.read(oid);
+		in >> title;
+		block->block2oid_.push_back(oid);
+		block->ids_.push_back(title.cbegin(), title.cend());
+		if (flags & SOURCE_SEQS)
+			read_seq(in, block->source_seqs_, buf);
+		for (int j = 0; j < contexts; ++j)
+			read_seq(in, block->seqs_, buf);
+		if (flags & UNMASKED_SEQS)
+			read_seq(in, block->unmasked_seqs_, buf);
+	}
+	block->seqs_.finish_reserve();
+	block->source_seqs_.finish_reserve();
+	block->unmasked_seqs_.finish_reserve();
+	block->ids_.finish_reserve();
+	return block;
+}
+
+void Replay::run() {
+	TaskTimer total;
+	TaskTimer timer("Opening the replay file");
+	if (config.replay_file.empty())
+		throw runtime_error("Missing parameter: replay file (--replay-file)");
+	InputFile in(config.replay_file);
+	uint64_t magic;
+	uint32_t version;
+	int32_t mode, sensitivity, contexts, ref_block;
+	uint64_t db_seqs, db_letters;
+	in.read(magic);
+	if (magic != MAGIC_NUMBER)
+		throw runtime_error("File is not a DIAMOND replay file: " + config.replay_file);
+	in.read(version);
+	if (version != VERSION)
+		throw runtime_error("Unsupported version of the replay file.");
+	in.read(mode);
+	in.read(sensitivity);
+	in.read(contexts);
+	in.read(ref_block);
+	in.read(db_seqs);
+	in.read(db_letters);
+
+	align_mode = AlignMode(mode);
+	value_traits = amino_acid_traits;
+	input_value_traits = align_mode.query_translated ? nucleotide_traits : amino_acid_traits;
+	if (align_mode.query_contexts != contexts)
+		throw runtime_error("Invalid replay file.");
+	config.sensitivity = (Sensitivity)sensitivity;
+
+	Search::Config cfg;
+	cfg.output_format.reset(init_output(cfg.max_target_seqs));
+	const OutputFormat& f = *cfg.output_format;
+	if (f == OutputFormat::daa || f == OutputFormat::blast_xml || f.needs_taxon_id_lists || f.needs_taxon_nodes || f.needs_taxon_scientific_names
+		|| f.needs_taxon_ranks || config.taxon_k != 0)
+		throw runtime_error("The output format is not supported by the replay command.");
+	statistics.reset();
+	cfg.db_seqs = db_seqs;
+	cfg.db_letters = db_letters;
+	cfg.ref_blocks = 1;
+	score_matrix.set_db_letters(config.db_size ? config.db_size : db_letters);
+	setup_search(config.sensitivity, cfg);
+	cfg.lazy_masking = false;
+	if (cfg.gapped_filter_evalue != 0.0) {
+		cfg.cutoff_gapped1 = { config.gapped_filter_evalue1 };
+		cfg.cutoff_gapped2 = { cfg.gapped_filter_evalue };
+		cfg.cutoff_gapped1_new = { config.gapped_filter_evalue1 };
+		cfg.cutoff_gapped2_new = { cfg.gapped_filter_evalue };
+	}
+	cfg.current_query_block = 0;
+	cfg.current_ref_block = ref_block;
+	cfg.blocked_processing = false;
+
+	timer.go("Loading sequences");
+	cfg.query.reset(read_block(in, contexts));
+	cfg.target.reset(read_block(in, 1));
+	const BlockId query_count = cfg.query->seqs().size() / contexts;
+
+	timer.go("Loading seed hits");
+	int64_t n;
+	in.read(n);
+	cfg.seed_hit_buf.reset(new AsyncBuffer<Search::Hit>(query_count, config.tmpdir, cfg.query_bins, { cfg.target->long_offsets(), contexts }));
+	{
+		AsyncBuffer<Search::Hit>::Iterator it(*cfg.seed_hit_buf, 0);
+		uint32_t query, last_query = 0;
+		uint64_t subject;
+		int32_t seed_offset, last_seed_offset = 0;
+		uint16_t score;
+		for (int64_t i = 0; i < n; ++i) {
+			in.read(query);
+			in.read(subject);
+			in.read(seed_offset);
+			in.read(score);
+			if (i == 0 || query != last_query || seed_offset != last_seed_offset) {
+				it = SerializerTraits<Search::Hit>::make_sentry(query, seed_offset);
+				last_query = query;
+				last_seed_offset = seed_offset;
+			}
+			it = Search::Hit(query, subject, seed_offset, score);
+		}
+	}
+	in.close();
+	timer.finish();
+	message_stream << "Replaying " << n << " seed hits of " << query_count << " queries and " << cfg.target->seqs().size() << " targets." << endl;
+
+	if (flag_any(cfg.output_format->flags, Output::Flags::SELF_ALN_SCORES)) {
+		timer.go("Computing self alignment scores");
+		cfg.query->compute_self_aln(MaskingAlgo::NONE);
+		cfg.target->compute_self_aln(MaskingAlgo::NONE);
+	}
+
+	timer.go("Opening the output file");
+	OutputFile out(config.output_file, config.compressor());
+	if (query_count > 0)
+		cfg.output_format->print_header(out, align_mode.mode, config.matrix.c_str(), score_matrix.gap_open(), score_matrix.gap_extend(), config.max_evalue, cfg.query->ids()[0],
+			unsigned(align_mode.query_translated ? cfg.query->source_seqs()[0].length() : cfg.query->seqs()[0].length()));
+	timer.finish();
+
+	align_queries(&out, cfg);
+
+	timer.go("Closing the output file");
+	cfg.output_format->print_footer(out);
+	out.finalize();
+	timer.go("Cleaning up");
+	cfg.free();
+	timer.finish();
+	message_stream << "Total time = " << total.get() << "s" << endl;
+	statistics.print();
+}
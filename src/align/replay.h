@@ -0,0 +1,58 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2024 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <buchfink@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "../search/hit.h"
+
+namespace Search { struct Config; }
+struct Block;
+struct Deserializer;
+
+// Capture of the workload of the extension stage (--replay-file): the sorted seed hits of one
+// reference block of the first query block together with the query and target sequences they
+// touch, renumbered into a self-contained file. The replay command runs only the extension
+// stage and the output on such a file, using the extension and output options given on its own
+// command line.
+
+struct Replay {
+
+	Replay(Search::Config& cfg);
+	// Adds a batch of sorted seed hits as passed to the extension stage.
+	void add(const Search::Hit* begin, const Search::Hit* end);
+	void write(const std::string& file_name);
+
+	// Returns true if the current query and reference block of the search are to be captured.
+	static bool capture(const Search::Config& cfg);
+	static void run();
+
+	static const uint64_t MAGIC_NUMBER;
+	static const uint32_t VERSION;
+
+private:
+
+	static Block* read_block(Deserializer& in, int contexts);
+
+	Search::Config& cfg_;
+	std::vector<Search::Hit> hits_;
+
+};
@@ -27,6 +27,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "sequence.h"
 #include "../masking/masking.h"
 #include "../util/util.h"
+#include "../util/metrics.h"
 #include "../stats/standard_matrix.h"
 
 const char* Const::version_string = "2.1.9";
@@ -179,9 +180,30 @@ std::vector<Letter> Sequence::reverse() const {
 	return v;
 }
 
+static const char* const STATISTICS_NAMES[] = {
+	"SEED_HITS", "TENTATIVE_MATCHES0", "TENTATIVE_MATCHES1", "TENTATIVE_MATCHES2", "TENTATIVE_MATCHES3", "TENTATIVE_MATCHES4", "TENTATIVE_MATCHESX",
+	"MATCHES", "ALIGNED", "GAPPED", "DUPLICATES", "GAPPED_HITS", "QUERY_SEEDS", "QUERY_SEEDS_HIT", "REF_SEEDS", "REF_SEEDS_HIT", "QUERY_SIZE",
+	"REF_SIZE", "OUT_HITS", "OUT_MATCHES", "COLLISION_LOOKUPS", "QCOV", "BIAS_ERRORS", "SCORE_TOTAL", "ALIGNED_QLEN", "PAIRWISE", "HIGH_SIM",
+	"SEARCH_TEMP_SPACE", "SECONDARY_HITS", "ERASED_HITS", "SQUARED_ERROR", "CELLS", "TARGET_HITS0", "TARGET_HITS1", "TARGET_HITS2", "TARGET_HITS3",
+	"TARGET_HITS3_CBS", "TARGET_HITS4", "TARGET_HITS5", "TARGET_HITS6", "TIME_GREEDY_EXT", "LOW_COMPLEXITY_SEEDS", "SWIPE_REALIGN", "EXT8", "EXT16",
+	"EXT32", "GAPPED_FILTER_TARGETS", "GAPPED_FILTER_HITS1", "GAPPED_FILTER_HITS2", "GROSS_DP_CELLS", "NET_DP_CELLS", "TIME_TARGET_SORT", "TIME_SW",
+	"TIME_EXT", "TIME_GAPPED_FILTER", "TIME_LOAD_HIT_TARGETS", "TIME_CHAINING", "TIME_LOAD_SEED_HITS", "TIME_SORT_SEED_HITS",
+	"TIME_SORT_TARGETS_BY_SCORE", "TIME_TARGET_PARALLEL", "TIME_TRACEBACK_SW", "TIME_TRACEBACK", "HARD_QUERIES", "TIME_MATRIX_ADJUST",
+	"MATRIX_ADJUST_COUNT", "MASKED_LAZY", "SWIPE_TASKS_TOTAL", "SWIPE_TASKS_ASYNC", "TRIVIAL_ALN", "TIME_EXT_32", "EXT_OVERFLOW_8", "EXT_WASTED_16",
+	"DP_CELLS_8", "DP_CELLS_16", "DP_CELLS_32", "TIME_PROFILE", "TIME_ANCHORED_SWIPE", "TIME_ANCHORED_SWIPE_ALLOC", "TIME_ANCHORED_SWIPE_SORT",
+	"TIME_ANCHORED_SWIPE_ADD", "TIME_ANCHORED_SWIPE_OUTPUT", "QUERIES_EXTENDED", "HARD_QUERIES_FALLBACK"
+};
+
+static_assert(sizeof(STATISTICS_NAMES) / sizeof(STATISTICS_NAMES[0]) == Statistics::COUNT, "Statistics names do not match the counters.");
+
+const char* Statistics::name(value v) {
+	return STATISTICS_NAMES[v];
+}
+
 void Statistics::print() const
 {
 	using std::endl;
+	Util::Metrics::add_statistics(*this);
 	//log_stream << "Used ref size = " << data_[REF_SIZE] << endl;
 	//log_stream << "Traceback errors = " << data_[BIAS_ERRORS] << endl;
 	//log_stream << "Low complexity seeds  = " << data_[LOW_COMPLEXITY_SEEDS] << endl;
@@ -214,6 +236,7 @@ void Statistics::print() const
 	log_stream << "SWIPE tasks (async)   = " << data_[SWIPE_TASKS_ASYNC] << endl;
 	log_stream << "Trivial aln           = " << data_[TRIVIAL_ALN] << endl;
 	log_stream << "Hard queries          = " << data_[HARD_QUERIES] << endl;
+	log_stream << "Hard queries (fallback) = " << data_[HARD_QUERIES_FALLBACK] << endl;
 #ifdef DP_STAT
 	log_stream << "Gross DP Cells        = " << data_[GROSS_DP_CELLS] << endl;
 	log_stream << "Net DP Cells          = " << data_[NET_DP_CELLS] << " (" << data_[NET_DP_CELLS] * 100.0 / data_[GROSS_DP_CELLS] << " %)" << endl;
@@ -171,6 +171,7 @@ Config::Config(int argc, const char **argv, bool check_io, CommandLineParser& pa
 		.add_command("greedy-vertex-cover", "Compute greedy vertex cover", GREEDY_VERTEX_COVER)
 		.add_command("roc", "", roc)
 		.add_command("benchmark", "", benchmark)
+		.add_command("replay", "", REPLAY)
 		.add_command("deepclust", "", DEEPCLUST)
 #ifdef EXTRA
 		.add_command("random-seqs", "", random_seqs)
@@ -208,23 +209,29 @@ Config::Config(int argc, const char **argv, bool check_io, CommandLineParser& pa
 #endif
 		;
 
-	auto& general = parser.add_group("General options", { makedb, blastp, blastx, cluster, view, prep_db, getseq, dbinfo, makeidx, CLUSTER_REALIGN, GREEDY_VERTEX_COVER, DEEPCLUST, RECLUSTER, MERGE_DAA, LINCLUST, CLUSTER_REASSIGN });
+	auto& general = parser.add_group("General options", { makedb, blastp, blastx, REPLAY, cluster, view, prep_db, getseq, dbinfo, makeidx, CLUSTER_REALIGN, GREEDY_VERTEX_COVER, DEEPCLUST, RECLUSTER, MERGE_DAA, LINCLUST, CLUSTER_REASSIGN });
 	general.add()
 		("threads", 'p', "number of CPU threads", threads_)
 		("verbose", 'v', "verbose console output", verbose)
 		("log", 0, "enable debug log", debug_log)
 		("quiet", 0, "disable console output", quiet)
-		("tmpdir", 't', "directory for temporary files", tmpdir);
-
-	auto& general_db = parser.add_group("General/database options", { makedb, blastp, blastx, cluster, prep_db, getseq, dbinfo, makeidx, CLUSTER_REALIGN, GREEDY_VERTEX_COVER, DEEPCLUST, RECLUSTER, LINCLUST, CLUSTER_REASSIGN });
+		("tmpdir", 't', "directory for temporary files", tmpdir)
+		("metrics-file", 0, "write run metrics (phase times, counters, memory) to this JSON file", metrics_file)
+		("trace-out", 0, "write a per-thread timeline of the run in Chrome trace event format", trace_out)
+		("perf-counters", 0, "record hardware performance counters per phase in the metrics file (Linux; threads are counted in the phase in which they are joined)", perf_counters)
+		("status-file", 0, "periodically write the progress and throughput of the run to this JSON file", status_file)
+		("status-interval", 0, "interval for updating the status file in seconds (default=10)", status_interval, 10);
+
+	auto& general_db = parser.add_group("General/database options", { makedb, blastp, blastx, REPLAY, cluster, prep_db, getseq, dbinfo, makeidx, CLUSTER_REALIGN, GREEDY_VERTEX_COVER, DEEPCLUST, RECLUSTER, LINCLUST, CLUSTER_REASSIGN });
 	general_db.add()
-		("db", 'd', "database file", database);
+		("db", 'd', "database file", database)
+		("blastdb-cache", 0, "directory for a local cache of BLAST database sequences", blastdb_cache);
 
-	auto& general_out = parser.add_group("General/output", { blastp, blastx, cluster, view, getseq, CLUSTER_REALIGN, GREEDY_VERTEX_COVER, DEEPCLUST, RECLUSTER, MERGE_DAA, LINCLUST, CLUSTER_REASSIGN });
+	auto& general_out = parser.add_group("General/output", { blastp, blastx, REPLAY, cluster, view, getseq, CLUSTER_REALIGN, GREEDY_VERTEX_COVER, DEEPCLUST, RECLUSTER, MERGE_DAA, LINCLUST, CLUSTER_REASSIGN });
 	general_out.add()
 		("out", 'o', "output file", output_file);
 
-	auto& general_out2 = parser.add_group("General/output2", { blastp, blastx, cluster, view, CLUSTER_REALIGN, GREEDY_VERTEX_COVER, DEEPCLUST, RECLUSTER, LINCLUST, CLUSTER_REASSIGN });
+	auto& general_out2 = parser.add_group("General/output2", { blastp, blastx, REPLAY, cluster, view, CLUSTER_REALIGN, GREEDY_VERTEX_COVER, DEEPCLUST, RECLUSTER, LINCLUST, CLUSTER_REASSIGN });
 	general_out2.add()
 		("header", 0, "Use header lines in tabular output format (0/simple/verbose).", output_header, Option<vector<string>>(), 0);
 	
@@ -233,13 +240,22 @@ Config::Config(int argc, const char **argv, bool check_io, CommandLineParser& pa
 	makedb_opt.add()
 		("in", 0, "input reference file in FASTA format/input DAA files for merge-daa", input_ref_file);
 
+	auto& makedb_format_opt = parser.add_group("Makedb/format options", { makedb });
+	makedb_format_opt.add()
+		("pack-seqs", 0, "store residues 6-bit packed to reduce database size and load time", pack_seqs);
+
 	auto& makedb_tax_opt = parser.add_group("Makedb/taxon options", { makedb });
 	makedb_tax_opt.add()
 		("taxonmap", 0, "protein accession to taxid mapping file", prot_accession2taxid)
 		("taxonnodes", 0, "taxonomy nodes.dmp from NCBI", nodesdmp)
 		("taxonnames", 0, "taxonomy names.dmp from NCBI", namesdmp);
 
-	auto& align_clust_realign = parser.add_group("Aligner/Clustering/Realign options", { blastp, blastx, cluster, RECLUSTER, CLUSTER_REASSIGN, DEEPCLUST, CLUSTER_REALIGN, LINCLUST });
+	auto& makeidx_opt = parser.add_group("Makeidx options", { makeidx });
+	makeidx_opt.add()
+		("accessions", 0, "build accession index for --seqidlist and cluster input lookups", accession_index)
+		("cluster-layout", 0, "precompute length order and self alignment scores for clustering", cluster_layout);
+
+	auto& align_clust_realign = parser.add_group("Aligner/Clustering/Realign options", { blastp, blastx, REPLAY, cluster, RECLUSTER, CLUSTER_REASSIGN, DEEPCLUST, CLUSTER_REALIGN, LINCLUST, makeidx });
 	align_clust_realign.add()
 		("comp-based-stats", 0, "composition based statistics mode (0-4)", comp_based_stats, 1u)
 		("masking", 0, "masking algorithm (none, seg, tantan=default)", masking_)
@@ -247,19 +263,19 @@ Config::Config(int argc, const char **argv, bool check_io, CommandLineParser& pa
 		("mmseqs-compat", 0, "", mmseqs_compat)
 		("no-block-size-limit", 0, "", no_block_size_limit);
 
-	auto& align_clust = parser.add_group("Aligner/Clustering options", { blastp, blastx, cluster, RECLUSTER, CLUSTER_REASSIGN, DEEPCLUST, LINCLUST });
+	auto& align_clust = parser.add_group("Aligner/Clustering options", { blastp, blastx, REPLAY, cluster, RECLUSTER, CLUSTER_REASSIGN, DEEPCLUST, LINCLUST });
 	align_clust.add()		
 		("evalue", 'e', "maximum e-value to report alignments (default=0.001)", max_evalue, 0.001)
 		("motif-masking", 0, "softmask abundant motifs (0/1)", motif_masking)
 		("approx-id", 0, "minimum approx. identity% to report an alignment/to cluster sequences", approx_min_id)
 		("ext", 0, "Extension mode (banded-fast/banded-slow/full)", ext_);
 
-	auto& aligner_view = parser.add_group("Aligner/view options", { blastp, blastx, view });
+	auto& aligner_view = parser.add_group("Aligner/view options", { blastp, blastx, REPLAY, view });
 	aligner_view.add()
 		("max-target-seqs", 'k', "maximum number of target sequences to report alignments for (default=25)", max_target_seqs_)
 		("top", 0, "report alignments within this percentage range of top alignment score (overrides --max-target-seqs)", toppercent, 100.0);
 
-	auto& aligner_sens = parser.add_group("Aligner/sens options", { blastp, blastx, makeidx });
+	auto& aligner_sens = parser.add_group("Aligner/sens options", { blastp, blastx, REPLAY, makeidx });
 	aligner_sens.add()
 		("faster", 0, "enable faster mode", mode_faster)
 		("fast", 0, "enable fast mode", mode_fast)
@@ -271,7 +287,7 @@ Config::Config(int argc, const char **argv, bool check_io, CommandLineParser& pa
 		("ultra-sensitive", 0, "enable ultra sensitive mode", mode_ultra_sensitive)
 		("shapes", 's', "number of seed shapes (default=all available)", shapes);
 
-	auto& aligner = parser.add_group("Aligner options", { blastp, blastx });
+	auto& aligner = parser.add_group("Aligner options", { blastp, blastx, REPLAY });
 	aligner.add()
 		("query", 'q', "input query file", query_file)
 		("strand", 0, "query strands to search (both/minus/plus)", query_strands, string("both"))
@@ -292,6 +308,7 @@ Config::Config(int argc, const char **argv, bool check_io, CommandLineParser& pa
 		("global-ranking", 'g', "number of targets for global ranking", global_ranking_targets)
 		("block-size", 'b', "sequence block size in billions of letters (default=2.0)", chunk_size)
 		("index-chunks", 'c', "number of chunks for index processing (default=4)", lowmem_)
+		("auto-tune", 0, "choose block size, index chunks, query bins and tile size based on the first reference block", auto_tune)
 		("parallel-tmpdir", 0, "directory for temporary files used by multiprocessing", parallel_tmpdir)
 		("gapopen", 0, "gap open penalty", gap_open, -1)
 		("gapextend", 0, "gap extension penalty", gap_extend, -1)
@@ -308,7 +325,7 @@ Config::Config(int argc, const char **argv, bool check_io, CommandLineParser& pa
 		("seqidlist", 0, "filter the database by list of accessions", seqidlist)
 		("skip-missing-seqids", 0, "ignore accessions missing in the database", skip_missing_seqids);
 
-	auto& format = parser.add_group("Output format options", { blastp, blastx, view, CLUSTER_REALIGN });
+	auto& format = parser.add_group("Output format options", { blastp, blastx, REPLAY, view, CLUSTER_REALIGN });
 	format.add()
 		("outfmt", 'f', "output format\n\
 \t0   = BLAST pairwise\n\
@@ -373,16 +390,23 @@ Config::Config(int argc, const char **argv, bool check_io, CommandLineParser& pa
 	auto& cluster_opt = parser.add_group("Clustering options", { cluster, RECLUSTER, DEEPCLUST, LINCLUST });
 	kmer_ranking = false;
 	cluster_opt.add()
-		("cluster-steps", 0, "Clustering steps", cluster_steps)
+		("cluster-steps", 0, "Clustering steps (the linear k-mer step \"kmer\" is only run if listed here)", cluster_steps)
+		("cluster-algo", 0, "Clustering algorithm (\"mcl\", \"incremental\")", cluster_algo)
 		("kmer-ranking", 0, "Rank sequences based on kmer frequency in linear stage", kmer_ranking)
 		("round-coverage", 0, "Per-round coverage cutoffs for cascaded clustering", round_coverage)
-		("round-approx-id", 0, "Per-round approx-id cutoffs for cascaded clustering", round_approx_id);
+		("round-approx-id", 0, "Per-round approx-id cutoffs for cascaded clustering", round_approx_id)
+		("round-checkpoint", 0, "Directory to store clustering round and super block checkpoints for resuming", round_checkpoint)
+		("kmer-per-seq", 0, "k-mers per sequence for the kmer clustering step (default=21)", kmer_per_seq, 21)
+		("component-jobs", 0, "Restrict clustering rounds to connected components of the previous round (approximate)", component_jobs);
 
 	auto& cluster_reassign_opt = parser.add_group("Clustering/reassign options", { cluster, RECLUSTER, CLUSTER_REASSIGN, GREEDY_VERTEX_COVER, DEEPCLUST, LINCLUST });
 	cluster_reassign_opt.add()
 		("memory-limit", 'M', "Memory limit in GB (default = 16G)", memory_limit)
 		("member-cover", 0, "Minimum coverage% of the cluster member sequence (default=80.0)", member_cover)
-		("mutual-cover", 0, "Minimum mutual coverage% of the cluster member and representative sequence", mutual_cover);
+		("mutual-cover", 0, "Minimum mutual coverage% of the cluster member and representative sequence", mutual_cover)
+		("parallel-gvc", 0, "compute the greedy vertex cover in parallel rounds", parallel_gvc)
+		("external-gvc", 0, "compute the greedy vertex cover out of core if the edges exceed the memory limit (clusters may differ from the in-memory computation and depend on --memory-limit)", external_gvc)
+		("clustering-format", 0, "Format of the clustering output (tsv/binary/binary-sorted, default=tsv)", clustering_format);
 
 	auto& gvc_opt = parser.add_group("GVC options", { GREEDY_VERTEX_COVER });
 	gvc_opt.add()
@@ -393,7 +417,7 @@ Config::Config(int argc, const char **argv, bool check_io, CommandLineParser& pa
 		("no-reassign", 0, "Do not reassign to closest representative", no_gvc_reassign)
 		("connected-component-depth", 0, "Depth to cluster connected components", connected_component_depth);
 
-	auto& realign_opt = parser.add_group("Cluster input options", { CLUSTER_REALIGN, RECLUSTER, CLUSTER_REASSIGN });
+	auto& realign_opt = parser.add_group("Cluster input options", { CLUSTER_REALIGN, RECLUSTER, CLUSTER_REASSIGN, cluster });
 	realign_opt.add()
 		("clusters", 0, "Clustering input file mapping sequences to representatives", clustering);
 
@@ -402,14 +426,14 @@ Config::Config(int argc, const char **argv, bool check_io, CommandLineParser& pa
     string dna_extension_string;
 #endif
 
-	auto& advanced_gen = parser.add_group("Advanced/general", { blastp, blastx, blastn, CLUSTER_REASSIGN, regression_test, cluster, DEEPCLUST, LINCLUST, makedb });
+	auto& advanced_gen = parser.add_group("Advanced/general", { blastp, blastx, REPLAY, blastn, CLUSTER_REASSIGN, regression_test, cluster, DEEPCLUST, LINCLUST, makedb });
 	advanced_gen.add()
 		("file-buffer-size", 0, "file buffer size in bytes (default=67108864)", file_buffer_size, (size_t)67108864)
 		("no-unlink", 0, "Do not unlink temporary files.", no_unlink)
 		("ignore-warnings", 0, "Ignore warnings", ignore_warnings)
 		("no-parse-seqids", 0, "Print raw seqids without parsing", no_parse_seqids);
 
-	auto& advanced_aln_cluster = parser.add_group("Advanced options aln/cluster", { blastp, blastx, blastn, CLUSTER_REASSIGN, regression_test, cluster, DEEPCLUST, LINCLUST, RECLUSTER });
+	auto& advanced_aln_cluster = parser.add_group("Advanced options aln/cluster", { blastp, blastx, REPLAY, blastn, CLUSTER_REASSIGN, regression_test, cluster, DEEPCLUST, LINCLUST, RECLUSTER });
 	advanced_aln_cluster.add()
 		("bin", 0, "number of query bins for seed search", query_bins_)
 		("ext-chunk-size", 0, "chunk size for adaptive ranking (default=auto)", ext_chunk_size)
@@ -418,7 +442,7 @@ Config::Config(int argc, const char **argv, bool check_io, CommandLineParser& pa
 		("no-auto-append", 0, "disable auto appending of DAA and DMND file extensions", no_auto_append)
 		("tantan-minMaskProb", 0, "minimum repeat probability for masking (default=0.9)", tantan_minMaskProb, 0.9);
 
-	auto& advanced = parser.add_group("Advanced options", { blastp, blastx, blastn, regression_test });
+	auto& advanced = parser.add_group("Advanced options", { blastp, blastx, REPLAY, blastn, regression_test });
 	advanced.add()
 		("algo", 0, "Seed search algorithm (0=double-indexed/1=query-indexed/ctg=contiguous-seed)", algo_str)
 		("min-orf", 'l', "ignore translated sequences without an open reading frame of at least this length", run_len)
@@ -450,6 +474,10 @@ Config::Config(int argc, const char **argv, bool check_io, CommandLineParser& pa
 		("family-map", 0, "", family_map)
 		("family-map-query", 0, "", family_map_query)
 		("query-parallel-limit", 0, "", query_parallel_limit, 3000000u)
+		("query-cost-file", 0, "write seed hits, targets, DP cells and time spent per query to this file", query_cost_file)
+		("hard-query-seed-hits", 0, "align queries with at least this many seed hits target-parallel", hard_query_seed_hits, (int64_t)0)
+		("replay-file", 0, "capture the extension workload of a reference block into this file (input of the replay command)", replay_file)
+		("replay-ref-block", 0, "reference block to capture for --replay-file (default=0)", replay_ref_block, 0)
 		("log-evalue-scale", 0, "", log_evalue_scale, 1.0 / std::log(2.0))
 		("bootstrap", 0, "", bootstrap)
 		("heartbeat", 0, "", heartbeat)
@@ -470,7 +498,7 @@ Config::Config(int argc, const char **argv, bool check_io, CommandLineParser& pa
 
 		("query-or-subject-cover", 0, "", query_or_target_cover);
 
-	auto& view_align_options = parser.add_group("View/Align options", { view, blastp, blastx });
+	auto& view_align_options = parser.add_group("View/Align options", { view, blastp, blastx, REPLAY });
 	view_align_options.add()
 		("daa", 'a', "DIAMOND alignment archive (DAA) file", daa_file);
 
@@ -484,7 +512,7 @@ Config::Config(int argc, const char **argv, bool check_io, CommandLineParser& pa
 
 	double rank_ratio2, lambda, K;
 	unsigned window, min_ungapped_score, hit_band, min_hit_score;
-	auto& deprecated_options = parser.add_group("", { blastp, blastx });
+	auto& deprecated_options = parser.add_group("", { blastp, blastx, REPLAY });
 	deprecated_options.add()
 		("window", 'w', "window size for local hit search", window)
 		("ungapped-score", 0, "minimum alignment score to continue local extension", min_ungapped_score)
@@ -587,6 +615,10 @@ Config::Config(int argc, const char **argv, bool check_io, CommandLineParser& pa
 		("full-sw-len", 0, "", full_sw_len)
 		("relaxed-evalue-factor", 0, "", relaxed_evalue_factor, 1.0)
 		("type", 0, "", type)
+		("bench-scale", 0, "", bench_scale, 1.0)
+		("bench-baseline", 0, "", bench_baseline)
+		("bench-tolerance", 0, "", bench_tolerance, 0.1)
+		("bench-runs", 0, "", bench_runs, 3)
 		("raw", 0, "", raw)
 		("chaining-len-cap", 0, "", chaining_len_cap, 2.0)
 		("chaining-min-nodes", 0, "", chaining_min_nodes, (size_t)200)
@@ -656,7 +688,6 @@ Config::Config(int argc, const char **argv, bool check_io, CommandLineParser& pa
 		("mcl-sparsity-switch", 0, "MCL switch to sparse matrix computation (default=0.8) ", cluster_mcl_sparsity_switch, 0.8)
 		("mcl-nonsymmetric", 0, "Do not symmetrize the transistion matrix before clustering", cluster_mcl_nonsymmetric)
 		("mcl-stats", 0, "Some stats about the connected components in MCL", cluster_mcl_stats)
-		("cluster-algo", 0, "Clustering algorithm (\"mcl\")", cluster_algo)
 		("approx-backtrace", 0, "", approx_backtrace)
 		("prefix-scan", 0, "", prefix_scan)
 		("narrow-band-cov", 0, "", narrow_band_cov)
@@ -835,6 +866,7 @@ Config::Config(int argc, const char **argv, bool check_io, CommandLineParser& pa
 	case Config::blastp:
     case Config::blastx:
 	case Config::benchmark:
+	case Config::REPLAY:
 	case Config::model_sim:
 	case Config::opt:
 	case Config::mask:
@@ -849,6 +881,7 @@ Config::Config(int argc, const char **argv, bool check_io, CommandLineParser& pa
 	case Config::CLUSTER_REALIGN:
 	case Config::RECLUSTER:
 	case Config::MODEL_SEQS:
+	case Config::makeidx:
 		if (frame_shift != 0 && command == Config::blastp)
 			throw std::runtime_error("Frameshift alignments are only supported for translated searches.");
 		if (query_range_culling && frame_shift == 0)
@@ -872,7 +905,7 @@ Config::Config(int argc, const char **argv, bool check_io, CommandLineParser& pa
 
 	if (command == Config::blastp || command == Config::blastx || command == Config::blastn || command == Config::benchmark || command == Config::model_sim || command == Config::opt
 		|| command == Config::mask || command == Config::cluster || command == Config::compute_medoids || command == Config::regression_test || command == Config::CLUSTER_REASSIGN
-		|| command == Config::RECLUSTER || command == Config::DEEPCLUST || command == Config::LINCLUST) {
+		|| command == Config::RECLUSTER || command == Config::DEEPCLUST || command == Config::LINCLUST || command == Config::REPLAY) {
 		if (tmpdir == "")
 			tmpdir = extract_dir(output_file);
 
@@ -919,6 +952,9 @@ Config::Config(int argc, const char **argv, bool check_io, CommandLineParser& pa
 	if (target_indexed && lowmem_ != 1)
 		throw std::runtime_error("--target-indexed requires -c1.");
 
+	if (auto_tune && (multiprocessing || target_indexed))
+		throw std::runtime_error("--auto-tune is not compatible with --multiprocessing and --target-indexed.");
+
 	/*log_stream << "sizeof(hit)=" << sizeof(hit) << " sizeof(packed_uint40_t)=" << sizeof(packed_uint40_t)
 		<< " sizeof(sorted_list::entry)=" << sizeof(sorted_list::entry) << endl;*/
 
@@ -78,6 +78,7 @@ struct Config
 	string compression;
 	unsigned		lowmem_;
 	double	chunk_size;
+	bool	auto_tune;
 	unsigned min_identities_;
 	unsigned min_identities2;
 	double ungapped_xdrop;
@@ -90,6 +91,11 @@ struct Config
 	double	max_seed_freq;
 	string	tmpdir;
 	string	parallel_tmpdir;
+	string metrics_file;
+	string trace_out;
+	bool perf_counters;
+	string status_file;
+	int status_interval;
 	bool		long_mode;
 	double gapped_xdrop;
 	double	max_evalue;
@@ -154,6 +160,10 @@ struct Config
 	unsigned max_cells;
 	Option<string> masking_;
 	bool log_query;
+	string query_cost_file;
+	int64_t hard_query_seed_hits;
+	string replay_file;
+	int replay_ref_block;
 	bool log_subject;
 	unsigned threads_align;
 	double score_ratio;
@@ -238,6 +248,10 @@ struct Config
 	int full_sw_len;
 	double relaxed_evalue_factor;
 	string type;
+	double bench_scale;
+	string bench_baseline;
+	double bench_tolerance;
+	int bench_runs;
 	bool raw;
 	bool mode_ultra_sensitive;
 	double chaining_len_cap;
@@ -322,6 +336,8 @@ struct Config
 	double diag_filter_id;
 	double diag_filter_cov;
 	bool strict_gvc;
+	bool parallel_gvc;
+	bool external_gvc;
 	bool mmseqs_compat;
 	string edge_format;
 	bool no_block_size_limit;
@@ -360,6 +376,10 @@ struct Config
 	string_vector connected_component_depth;
 	std::vector<string> round_coverage;
 	string_vector round_approx_id;
+	string round_checkpoint;
+	int kmer_per_seq;
+	bool component_jobs;
+	string clustering_format;
 	int max_indirection;
 	bool mode_shapes30x10;
 	string aln_out;
@@ -379,7 +399,7 @@ struct Config
 		match_file_stat = 14, model_seqs = 15, opt = 16, mask = 17, fastq2fasta = 18, dbinfo = 19, test_extra = 20, test_io = 21, db_annot_stats = 22, read_sim = 23, info = 24, seed_stat = 25,
 		smith_waterman = 26, cluster = 27, translate = 28, filter_blasttab = 29, show_cbs = 30, simulate_seqs = 31, split = 32, upgma = 33, upgma_mc = 34, regression_test = 35,
 		reverse_seqs = 36, compute_medoids = 37, mutate = 38, rocid = 40, makeidx = 41, find_shapes, prep_db, composition, JOIN, HASH_SEQS, LIST_SEEDS, CLUSTER_REALIGN,
-		GREEDY_VERTEX_COVER, INDEX_FASTA, FETCH_SEQ, CLUSTER_REASSIGN, blastn, RECLUSTER, LENGTH_SORT, MERGE_DAA, DEEPCLUST, LINCLUST, WORD_COUNT, CUT, MODEL_SEQS
+		GREEDY_VERTEX_COVER, INDEX_FASTA, FETCH_SEQ, CLUSTER_REASSIGN, blastn, RECLUSTER, LENGTH_SORT, MERGE_DAA, DEEPCLUST, LINCLUST, WORD_COUNT, CUT, MODEL_SEQS, REPLAY
 	};
 
 
@@ -403,6 +423,10 @@ struct Config
 	uint32_t cluster_mcl_max_iter;
 	bool cluster_mcl_stats;
 	bool cluster_mcl_nonsymmetric;
+	bool accession_index;
+	bool pack_seqs;
+	bool cluster_layout;
+	string blastdb_cache;
 
 	enum { query_parallel = 0, target_parallel = 1 };
 	unsigned load_balancing;
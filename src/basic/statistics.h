@@ -38,7 +38,7 @@ struct Statistics
 		SWIPE_REALIGN, EXT8, EXT16, EXT32, GAPPED_FILTER_TARGETS, GAPPED_FILTER_HITS1, GAPPED_FILTER_HITS2, GROSS_DP_CELLS, NET_DP_CELLS, TIME_TARGET_SORT, TIME_SW, TIME_EXT, TIME_GAPPED_FILTER,
 		TIME_LOAD_HIT_TARGETS, TIME_CHAINING, TIME_LOAD_SEED_HITS, TIME_SORT_SEED_HITS, TIME_SORT_TARGETS_BY_SCORE, TIME_TARGET_PARALLEL, TIME_TRACEBACK_SW, TIME_TRACEBACK, HARD_QUERIES, TIME_MATRIX_ADJUST,
 		MATRIX_ADJUST_COUNT, MASKED_LAZY, SWIPE_TASKS_TOTAL, SWIPE_TASKS_ASYNC, TRIVIAL_ALN, TIME_EXT_32, EXT_OVERFLOW_8, EXT_WASTED_16, DP_CELLS_8, DP_CELLS_16, DP_CELLS_32, TIME_PROFILE, TIME_ANCHORED_SWIPE,
-		TIME_ANCHORED_SWIPE_ALLOC, TIME_ANCHORED_SWIPE_SORT, TIME_ANCHORED_SWIPE_ADD, TIME_ANCHORED_SWIPE_OUTPUT, COUNT
+		TIME_ANCHORED_SWIPE_ALLOC, TIME_ANCHORED_SWIPE_SORT, TIME_ANCHORED_SWIPE_ADD, TIME_ANCHORED_SWIPE_OUTPUT, QUERIES_EXTENDED, HARD_QUERIES_FALLBACK, COUNT
 	};
 
 	Statistics()
@@ -47,6 +47,7 @@ struct Statistics
 	}
 
 	void reset() {
+		std::lock_guard<std::mutex> lock(mtx_);
 		std::fill(data_, data_ + COUNT, (stat_type)0);
 	}
 
@@ -70,7 +71,14 @@ struct Statistics
 	stat_type get(const value v) const
 	{ return data_[v]; }
 
+	// Reads a counter from another thread than the ones merging into it through operator+=.
+	stat_type get_synchronized(const value v) {
+		std::lock_guard<std::mutex> lock(mtx_);
+		return data_[v];
+	}
+
 	void print() const;
+	static const char* name(value v);
 
 	stat_type data_[COUNT];
 	std::mutex mtx_;
@@ -20,6 +20,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ****/
 
 #include <numeric>
+#include <sstream>
+#include <iomanip>
 #include "cascaded.h"
 #include "../util/util.h"
 #include "../util/sequence/sequence.h"
@@ -27,6 +29,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../util/algo/algo.h"
 #include "../../basic/statistics.h"
 #include "../../run/workflow.h"
+#include "../../data/sequence_file_view.h"
+#include "../../data/dmnd/dmnd.h"
+#include "../../util/data_structures/disjoint_set.h"
 
 const char* const DEFAULT_MEMORY_LIMIT = "16G";
 const double CASCADED_ROUND_MAX_EVALUE = 0.001;
@@ -42,6 +47,7 @@ using std::tie;
 using std::string;
 using std::pair;
 using std::iota;
+using std::unique_ptr;
 
 namespace Cluster {
 
@@ -57,7 +63,7 @@ static BitVector rep_bitset(const vector<SuperBlockId> &centroid, const BitVecto
 	return r;
 }
 
-vector<SuperBlockId> cluster(shared_ptr<SequenceFile>& db, const shared_ptr<BitVector>& filter, const SuperBlockId* member_counts, int round, int round_count) {
+vector<SuperBlockId> cluster(shared_ptr<SequenceFile>& db, const shared_ptr<BitVector>& filter, const SuperBlockId* member_counts, int round, int round_count, DisjointSet<SuperBlockId>* components) {
 	using Edge = Util::Algo::Edge<SuperBlockId>;
 	statistics.reset();
 	const bool mutual_cover = config.mutual_cover.present();
@@ -82,31 +88,55 @@ vector<SuperBlockId> cluster(shared_ptr<SequenceFile>& db, const shared_ptr<BitV
 	if(filter) {
 		config.db_size = db->letters_filtered(*filter);
 	}
-	tie(config.chunk_size, config.lowmem_) = block_size(Util::String::interpret_number(config.memory_limit.get(DEFAULT_MEMORY_LIMIT)), config.sensitivity, config.lin_stage1);
+	const int64_t memory_limit = Util::String::interpret_number(config.memory_limit.get(DEFAULT_MEMORY_LIMIT));
+	tie(config.chunk_size, config.lowmem_) = block_size(memory_limit, config.sensitivity, config.lin_stage1);
 
-	shared_ptr<Callback> callback(mutual_cover ? (Callback*)new CallbackBidirectional : (Callback*)new CallbackUnidirectional);
+	const SuperBlockId node_count = (SuperBlockId)db->sequence_count();
+	shared_ptr<Callback> callback(mutual_cover ? (Callback*)new CallbackBidirectional(node_count) : (Callback*)new CallbackUnidirectional(node_count));
 
 	Search::run(db, nullptr, callback, filter);
+	callback->flush();
 
 	message_stream << "Finished search. #Edges: " << callback->count << endl;
-	TaskTimer timer("Allocating buffers");
-	vector<Edge> edges(callback->count);
-	timer.go("Loading edges");
+	const auto algo = from_string<GraphAlgo>(config.graph_algo);
+	const bool last_round = round == round_count - 1;
+	const int ccd = round_ccd(round, round_count);
+	const bool merge_recursive = last_round && !config.strict_gvc && !mutual_cover;
+	// The edge array is held twice while building the dense flat array. Incompatible options have been rejected by cascaded().
+	if (config.external_gvc && callback->count * (int64_t)sizeof(Edge) * 2 > memory_limit) {
+		message_stream << "Edge set exceeds the memory limit, computing vertex cover out of core." << endl;
+		InputFile f(callback->edge_file);
+		const std::function<vector<Edge>(int)> load_bucket = [&callback, &f, components](int bucket) {
+			vector<Edge> edges = callback->load_bucket(f, bucket);
+			if (components)
+				for (const Edge& e : edges)
+					components->merge(e.node1, e.node2);
+			return edges;
+		};
+		const int64_t max_edges = std::max(memory_limit / (int64_t)(sizeof(Edge) * 2), (int64_t)1);
+		vector<SuperBlockId> centroids = Util::Algo::greedy_vertex_cover_external(node_count, callback->bucket_size, callback->bucket_edges(), max_edges, load_bucket,
+			config.weighted_gvc ? member_counts : nullptr, merge_recursive, !config.no_gvc_reassign, config.threads_);
+		f.close_and_delete();
+		db->reopen();
+		return centroids;
+	}
+
+	TaskTimer timer("Loading edges");
 	InputFile f(callback->edge_file);
-	f.read(edges.data(), callback->count);
+	vector<Edge> edges = callback->load_all(f);
 	f.close_and_delete();
 	if (!config.aln_out.empty())
 		output_edges(config.aln_out, *db, edges);
+	if (components)
+		for (const Edge& e : edges)
+			components->merge(e.node1, e.node2);
 	timer.go("Sorting edges");
 	db->reopen();
-	FlatArray<Edge> edge_array = make_flat_array_dense(move(edges), (SuperBlockId)db->sequence_count(), config.threads_, Edge::GetKey());
+	FlatArray<Edge> edge_array = make_flat_array_dense(move(edges), node_count, config.threads_, Edge::GetKey());
 	timer.finish();
 
-	const auto algo = from_string<GraphAlgo>(config.graph_algo);
-	const bool last_round = round == round_count - 1;
-	const int ccd = round_ccd(round, round_count);
 	return algo == GraphAlgo::GREEDY_VERTEX_COVER ?
-		Util::Algo::greedy_vertex_cover(edge_array, config.weighted_gvc ? member_counts : nullptr, last_round && !config.strict_gvc && !mutual_cover, !config.no_gvc_reassign, ccd)
+		Util::Algo::greedy_vertex_cover(edge_array, config.weighted_gvc ? member_counts : nullptr, merge_recursive, !config.no_gvc_reassign, ccd, config.parallel_gvc ? config.threads_ : 1)
 		: len_sorted_clust(edge_array);
 }
 
@@ -119,10 +149,100 @@ static pair<vector<SuperBlockId>, BitVector> update_clustering(const BitVector&
 	return { current_centroids, oid_filter };
 }
 
-vector<SuperBlockId> cascaded(shared_ptr<SequenceFile>& db, bool linear) {
+// Runs a clustering round separately for groups of connected components of the previous round's
+// similarity graph. Small components are packed into jobs of up to one search block.
+static vector<SuperBlockId> cluster_components(shared_ptr<SequenceFile>& db, const BitVector& filter, DisjointSet<SuperBlockId>& previous_components, bool kmer_step,
+	const SuperBlockId* member_counts, int round, int round_count, DisjointSet<SuperBlockId>* components)
+{
+	const SuperBlockId n = (SuperBlockId)db->sequence_count();
+	vector<pair<SuperBlockId, SuperBlockId>> nodes;
+	for (SuperBlockId i = 0; i < n; ++i)
+		if (filter.get(i))
+			nodes.emplace_back(previous_components.find(i), i);
+	std::sort(nodes.begin(), nodes.end());
+
+	const int64_t memory_limit = Util::String::interpret_number(config.memory_limit.get(DEFAULT_MEMORY_LIMIT));
+	const int64_t max_letters = (int64_t)(block_size(memory_limit, config.sensitivity, config.lin_stage1).first * 1e9);
+	vector<vector<SuperBlockId>> jobs(1);
+	int64_t letters = 0;
+	for (auto it = nodes.cbegin(); it != nodes.cend();) {
+		if (letters >= max_letters) {
+			jobs.emplace_back();
+			letters = 0;
+		}
+		const SuperBlockId component = it->first;
+		for (; it != nodes.cend() && it->first == component; ++it) {
+			jobs.back().push_back(it->second);
+			letters += db->seq_length(it->second);
+		}
+	}
+	message_stream << "Clustering round " << round + 1 << " in " << jobs.size() << " component jobs." << endl;
+
+	config.db_size = db->letters_filtered(filter);
+	vector<SuperBlockId> centroids(n);
+	iota(centroids.begin(), centroids.end(), 0);
+	for (size_t i = 0; i < jobs.size(); ++i) {
+		vector<SuperBlockId>& job = jobs[i];
+		std::sort(job.begin(), job.end());
+		message_stream << "Processing component job " << i + 1 << '/' << jobs.size() << " #Sequences: " << job.size() << endl;
+		shared_ptr<SequenceFile> job_db(sub_db_view(db, job.cbegin(), job.cend()));
+		vector<SuperBlockId> job_member_counts;
+		if (member_counts)
+			for (SuperBlockId j : job)
+				job_member_counts.push_back(member_counts[j]);
+		unique_ptr<DisjointSet<SuperBlockId>> job_components(components ? new DisjointSet<SuperBlockId>((SuperBlockId)job.size()) : nullptr);
+		const vector<SuperBlockId> c = (kmer_step ? kmer_cluster : cluster)(job_db, nullptr, member_counts ? job_member_counts.data() : nullptr, round, round_count, job_components.get());
+		for (SuperBlockId j = 0; j < (SuperBlockId)job.size(); ++j) {
+			centroids[job[j]] = job[c[j]];
+			if (components)
+				components->merge(job[j], job[job_components->find(j)]);
+		}
+		job_db->close();
+	}
+	return centroids;
+}
+
+// Identifies the input of the clustering: the content hash for DIAMOND databases, otherwise the file name.
+string db_identity(SequenceFile& db) {
+	if (db.type() != SequenceFile::Type::DMND)
+		return db.file_name();
+	std::ostringstream ss;
+	ss << std::hex << std::setfill('0');
+	for (char c : static_cast<const DatabaseFile&>(db).header2.hash)
+		ss << std::setw(2) << (int)(unsigned char)c;
+	return ss.str();
+}
+
+string clustering_parameters() {
+	std::ostringstream ss;
+	ss << config.member_cover << ' ' << (config.mutual_cover.present() ? config.mutual_cover.get_present() : -1.0)
+		<< ' ' << config.graph_algo << ' ' << config.weighted_gvc << ' ' << config.strict_gvc << ' ' << config.no_gvc_reassign
+		<< ' ' << config.comp_based_stats << ' ' << config.masking_.get(string()) << ' ' << config.kmer_per_seq << ' ' << config.component_jobs << ' ' << config.parallel_gvc << ' ' << config.external_gvc;
+	return ss.str();
+}
+
+// Parameters that determine the result of a clustering round, used to validate checkpoints.
+static string round_parameters(SequenceFile& db, const string& identity, const vector<string>& steps, int round) {
+	std::ostringstream ss;
+	ss << (identity.empty() ? db_identity(db) : identity) << ' ' << db.sequence_count() << ' ' << db.letters() << ' ' << steps[round] << ' ' << config.approx_min_id << ' ' << config.max_evalue
+		<< ' ' << (config.round_coverage.empty() ? string() : config.round_coverage[std::min((size_t)round, config.round_coverage.size() - 1)])
+		<< ' ' << round_ccd(round, (int)steps.size()) << ' ' << (round == (int)steps.size() - 1) << ' ' << clustering_parameters();
+	return ss.str();
+}
+
+vector<SuperBlockId> cascaded(shared_ptr<SequenceFile>& db, bool linear, const string& checkpoint, const string& identity) {
 	if (db->sequence_count() > (int64_t)numeric_limits<SuperBlockId>::max())
 		throw runtime_error("Workflow supports a maximum of " + to_string(numeric_limits<SuperBlockId>::max()) + " input sequences.");
 	const auto steps = cluster_steps(config.approx_min_id, linear);
+	if (config.external_gvc) {
+		if (!config.aln_out.empty())
+			throw runtime_error("Option --aln-out is not supported with --external-gvc.");
+		if (from_string<GraphAlgo>(config.graph_algo) != GraphAlgo::GREEDY_VERTEX_COVER)
+			throw runtime_error("Option --external-gvc requires the greedy vertex cover graph algorithm.");
+		for (int i = 0; i < (int)steps.size(); ++i)
+			if (round_ccd(i, (int)steps.size()) > 0)
+				throw runtime_error("Option --connected-component-depth is not supported with --external-gvc.");
+	}
 	const double evalue_cutoff = config.max_evalue,
 		target_approx_id = config.approx_min_id;
 	shared_ptr<BitVector> oid_filter(new BitVector);
@@ -130,23 +250,68 @@ vector<SuperBlockId> cascaded(shared_ptr<SequenceFile>& db, bool linear) {
 	vector<SuperBlockId> centroids(cluster_count);
 	iota(centroids.begin(), centroids.end(), 0);
 
-	for (int i = 0; i < (int)steps.size(); i++) {
-		TaskTimer timer;
+	auto init_round = [&](int i) {
 		config.lin_stage1 = ends_with(steps[i], "_lin");
-		config.sensitivity = from_string<Sensitivity>(rstrip(steps[i], "_lin"));
+		config.sensitivity = step_sensitivity(steps[i]);
 		const vector<string> round_approx_id = config.round_approx_id.empty() ? default_round_approx_id(steps.size()) : config.round_approx_id;
 		config.approx_min_id = std::max(target_approx_id, round_value(round_approx_id, "--round-approx-id", i, steps.size()));
 		config.max_evalue = (size_t)i == steps.size() - 1 ? evalue_cutoff : std::min(evalue_cutoff, CASCADED_ROUND_MAX_EVALUE);
+	};
+
+	vector<uint64_t> fingerprint(steps.size());
+	vector<SuperBlockId> component_roots;
+	int first_round = 0;
+	if (!checkpoint.empty()) {
+		for (int i = 0; i < (int)steps.size(); ++i) {
+			init_round(i);
+			fingerprint[i] = RoundCheckpoint::fingerprint(i == 0 ? 0 : fingerprint[i - 1], round_parameters(*db, identity, steps, i));
+		}
+		for (int i = (int)steps.size() - 1; i >= 0; --i) {
+			if (RoundCheckpoint::read(checkpoint, i, fingerprint[i], centroids, *oid_filter, component_roots)) {
+				cluster_count = oid_filter->one_count();
+				message_stream << "Resuming clustering after round " << i + 1 << ". #Clusters: " << cluster_count << endl;
+				init_round(i);
+				first_round = i + 1;
+				break;
+			}
+		}
+	}
+
+	// With --component-jobs, the connected components of a round's graph partition the next round.
+	unique_ptr<DisjointSet<SuperBlockId>> components;
+	if (!component_roots.empty()) {
+		components.reset(new DisjointSet<SuperBlockId>((SuperBlockId)component_roots.size()));
+		for (SuperBlockId j = 0; j < (SuperBlockId)component_roots.size(); ++j)
+			components->merge(j, component_roots[j]);
+	}
+	for (int i = first_round; i < (int)steps.size(); i++) {
+		TaskTimer timer;
+		init_round(i);
+		unique_ptr<DisjointSet<SuperBlockId>> round_components(config.component_jobs && i < (int)steps.size() - 1 ? new DisjointSet<SuperBlockId>((SuperBlockId)db->sequence_count()) : nullptr);
+		const vector<SuperBlockId> counts = config.weighted_gvc ? member_counts(centroids) : vector<SuperBlockId>();
+		const SuperBlockId* counts_ptr = config.weighted_gvc ? counts.data() : nullptr;
 		tie(centroids, *oid_filter) = update_clustering(*oid_filter,
 			centroids,
-			cluster(db, i == 0 ? nullptr : oid_filter, config.weighted_gvc ? member_counts(centroids).data() : nullptr, i, (int)steps.size()),
+			components
+				? cluster_components(db, *oid_filter, *components, steps[i] == KMER_CLUSTER_STEP, counts_ptr, i, (int)steps.size(), round_components.get())
+				: (steps[i] == KMER_CLUSTER_STEP ? kmer_cluster : cluster)(db, i == 0 ? nullptr : oid_filter, counts_ptr, i, (int)steps.size(), round_components.get()),
 			i);
+		components = std::move(round_components);
 		const int64_t n = oid_filter->one_count();
 		message_stream << "Clustering round " << i + 1 << " complete. #Input sequences: " << cluster_count
 			<< " #Clusters: " << n
 			<< " #Letters: " << db->letters_filtered(*oid_filter)
 			<< " Time: " << timer.seconds() << 's' << endl;
 		cluster_count = n;
+		if (!checkpoint.empty()) {
+			vector<SuperBlockId> roots;
+			if (components) {
+				roots.reserve(db->sequence_count());
+				for (SuperBlockId j = 0; j < (SuperBlockId)db->sequence_count(); ++j)
+					roots.push_back(components->find(j));
+			}
+			RoundCheckpoint::write(checkpoint, i, fingerprint[i], centroids, *oid_filter, roots);
+		}
 	}
 	return centroids;
 }
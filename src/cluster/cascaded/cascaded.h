@@ -21,6 +21,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #pragma once
 #include "../cluster.h"
+#include "../../util/data_structures/disjoint_set.h"
 
 namespace Cluster { 
 
@@ -33,50 +34,116 @@ struct Cascaded : public ClusteringAlgorithm {
 	}
 };
 
-std::vector<SuperBlockId> cascaded(std::shared_ptr<SequenceFile>& db, bool linear);
+// Round checkpoints are validated against the identity of db, or against identity if given, e.g. for
+// temporary databases that are derived from the input.
+std::vector<SuperBlockId> cascaded(std::shared_ptr<SequenceFile>& db, bool linear, const std::string& checkpoint = std::string(), const std::string& identity = std::string());
+std::string db_identity(SequenceFile& db);
+// Options besides the round settings that determine the result of the clustering.
+std::string clustering_parameters();
 std::vector<std::string> cluster_steps(double approx_id, bool linear);
+Sensitivity step_sensitivity(const std::string& step);
+std::vector<SuperBlockId> kmer_cluster(std::shared_ptr<SequenceFile>& db, const std::shared_ptr<BitVector>& filter, const SuperBlockId* member_counts, int round, int round_count, DisjointSet<SuperBlockId>* components);
+
+// Name of the clustering step that runs kmer_cluster instead of a search.
+extern const char* const KMER_CLUSTER_STEP;
 std::vector<std::string> default_round_approx_id(int steps);
 std::vector<std::string> default_round_cov(int steps);
 int round_ccd(int round, int round_count);
+// Searches the sequences in queries against the centroids with the member coverage cutoff of the
+// clustering, and assigns each query to its best centroid in clustering. Returns the number of
+// assigned queries, and the OIds of the unassigned ones in unassigned if given. E-values are computed
+// for a database of db_size letters, or of the size of the centroids if db_size is 0. With
+// reset_filters, --top and --query-or-target-cover are cleared instead of taken from the user.
+int64_t assign_to_centroids(std::shared_ptr<SequenceFile>& db, std::vector<OId>& clustering, const std::vector<OId>& centroids, const std::vector<OId>& queries, int64_t db_size, bool reset_filters, std::vector<OId>* unassigned = nullptr);
+
+// State of the cascaded clustering after a completed round, stored in files named
+// <prefix>_<round>.ckpt. The fingerprint covers the input and the parameters of all rounds up to
+// the stored one, so that a checkpoint is only used if it would be reproduced by the current run.
+// With --component-jobs, the root of each sequence in the connected components of the round's graph
+// is stored as well, since they partition the next round; otherwise component_roots is empty.
+struct RoundCheckpoint {
+	static uint64_t fingerprint(uint64_t previous, const std::string& parameters);
+	static std::string file_name(const std::string& prefix, int round);
+	static void write(const std::string& prefix, int round, uint64_t fingerprint, const std::vector<SuperBlockId>& centroids, const BitVector& oid_filter, const std::vector<SuperBlockId>& component_roots);
+	static bool read(const std::string& prefix, int round, uint64_t fingerprint, std::vector<SuperBlockId>& centroids, BitVector& oid_filter, std::vector<SuperBlockId>& component_roots);
+};
+
+// Result of a super block of the clustering of inputs that exceed the memory limit, stored in files
+// named <prefix>_<super_block>.ckpt: the super block ids of its new centroids and the (centroid OId,
+// member OId) pairs of the sequences it assigned. The fingerprint chains the input, the OIds of the
+// super blocks up to the stored one and the parameters, see RoundCheckpoint.
+struct SuperBlockCheckpoint {
+	static void write(const std::string& prefix, int super_block, uint64_t fingerprint, const std::vector<SuperBlockId>& centroids, const std::vector<OId>& assignments);
+	static bool read(const std::string& prefix, int super_block, uint64_t fingerprint, std::vector<SuperBlockId>& centroids, std::vector<OId>& assignments);
+};
 
+// Receives the edges of the clustering search. Edges are partitioned by node1 into buckets of
+// consecutive node ranges, staged in memory and appended to the edge file in chunks, so that the
+// edges of a node range can be read back without loading the whole graph. The buckets are fine
+// grained so that the out-of-core vertex cover can group them into loads of similar edge count.
 struct Callback : public Consumer {
 	using Edge = Util::Algo::Edge<SuperBlockId>;
-	Callback() :
-		count(0)
+	static constexpr int BUCKET_COUNT = 4096;
+	static constexpr size_t CHUNK_SIZE = 512;
+	Callback(SuperBlockId node_count) :
+		count(0),
+		bucket_size(node_count / BUCKET_COUNT + 1),
+		chunks(BUCKET_COUNT),
+		file_offset_(0),
+		buffers_(BUCKET_COUNT)
 	{}
 	virtual void consume(const char* ptr, size_t n) override = 0;
+	void push(const Edge& e) {
+		const int b = e.node1 / bucket_size;
+		buffers_[b].push_back(e);
+		if (buffers_[b].size() >= CHUNK_SIZE)
+			flush(b);
+		++count;
+	}
+	void flush();
+	std::vector<Edge> load_bucket(InputFile& f, int bucket) const;
+	std::vector<int64_t> bucket_edges() const;
+	std::vector<Edge> load_all(InputFile& f) const;
 	TempFile edge_file;
 	int64_t count;
+	const SuperBlockId bucket_size;
+	// File offset and edge count of the chunks belonging to each bucket.
+	std::vector<std::vector<std::pair<int64_t, int64_t>>> chunks;
+private:
+	void flush(int bucket);
+	int64_t file_offset_;
+	std::vector<std::vector<Edge>> buffers_;
 };
 
 struct CallbackUnidirectional : public Callback {
+	CallbackUnidirectional(SuperBlockId node_count) :
+		Callback(node_count)
+	{}
 	virtual void consume(const char* ptr, size_t n) override {
 		const char* end = ptr + n;
 		while (ptr < end) {
 			const auto edge = *(Output::Format::Edge::Data*)ptr;
 			ptr += sizeof(Output::Format::Edge::Data);
-			if (edge.qcovhsp >= config.member_cover) {
-				edge_file.write(Edge((SuperBlockId)edge.target, (SuperBlockId)edge.query, edge.evalue));
-				++count;
-			}
-			if (edge.scovhsp >= config.member_cover) {
-				edge_file.write(Edge((SuperBlockId)edge.query, (SuperBlockId)edge.target, edge.evalue));
-				++count;
-			}
+			if (edge.qcovhsp >= config.member_cover)
+				push(Edge((SuperBlockId)edge.target, (SuperBlockId)edge.query, edge.evalue));
+			if (edge.scovhsp >= config.member_cover)
+				push(Edge((SuperBlockId)edge.query, (SuperBlockId)edge.target, edge.evalue));
 		}
 	}
 };
 
 struct CallbackBidirectional : public Callback {
+	CallbackBidirectional(SuperBlockId node_count) :
+		Callback(node_count)
+	{}
 	virtual void consume(const char* ptr, size_t n) override {
 		const char* end = ptr + n;
 		while (ptr < end) {
 			const auto edge = *(Output::Format::Edge::Data*)ptr;
 			ptr += sizeof(Output::Format::Edge::Data);
 			if (edge.query != edge.target) {
-				edge_file.write(Edge((SuperBlockId)edge.target, (SuperBlockId)edge.query, edge.evalue));
-				edge_file.write(Edge((SuperBlockId)edge.query, (SuperBlockId)edge.target, edge.evalue));
-				count += 2;
+				push(Edge((SuperBlockId)edge.target, (SuperBlockId)edge.query, edge.evalue));
+				push(Edge((SuperBlockId)edge.query, (SuperBlockId)edge.target, edge.evalue));
 			}
 		}
 	}
@@ -0,0 +1,170 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2024 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <buchfink@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#include <cstdio>
+#include <stdexcept>
+#include "cascaded.h"
+#include "../../util/algo/MurmurHash3.h"
+#include "../../util/io/output_file.h"
+#include "../../util/io/input_file.h"
+#include "../../util/system/system.h"
+#include "../../util/log_stream.h"
+
+using std::string;
+using std::vector;
+using std::runtime_error;
+using std::to_string;
+
+// Layout of a round checkpoint file:
+// magic number, version, round, parameter fingerprint, centroid count, centroids, filter size, filter bit vector,
+// component root count, component roots
+static const uint64_t MAGIC_NUMBER = 0x3c9a1d5e7b24f860llu;
+static const uint32_t VERSION = 1;
+// Layout of a super block checkpoint file:
+// magic number, version, super block, fingerprint, centroid count, centroids, assignment count, assignments
+static const uint64_t SUPER_BLOCK_MAGIC_NUMBER = 0x5b17e2c0a9d4f386llu;
+static const uint32_t SUPER_BLOCK_VERSION = 0;
+static const char FINGERPRINT_SEED[16] = { 0 };
+
+namespace Cluster {
+
+uint64_t RoundCheckpoint::fingerprint(uint64_t previous, const string& parameters) {
+	const string s = to_string(previous) + '\t' + parameters;
+	uint64_t h[2];
+	MurmurHash3_x64_128(s.data(), (int)s.length(), FINGERPRINT_SEED, h);
+	return h[0];
+}
+
+string RoundCheckpoint::file_name(const string& prefix, int round) {
+	return prefix + "_" + to_string(round + 1) + ".ckpt";
+}
+
+void RoundCheckpoint::write(const string& prefix, int round, uint64_t fingerprint, const vector<SuperBlockId>& centroids, const BitVector& oid_filter, const vector<SuperBlockId>& component_roots) {
+	const string name = file_name(prefix, round), tmp_name = name + ".tmp";
+	OutputFile out(tmp_name);
+	out.write(MAGIC_NUMBER);
+	out.write(VERSION);
+	out.write((int32_t)round);
+	out.write(fingerprint);
+	out.write((int64_t)centroids.size());
+	out.write(centroids.data(), centroids.size());
+	out.write((int64_t)oid_filter.size());
+	out.write(oid_filter.data(), oid_filter.word_count());
+	out.write((int64_t)component_roots.size());
+	out.write(component_roots.data(), component_roots.size());
+	out.close();
+	// The file is only visible under its final name once it is complete.
+	if (std::rename(tmp_name.c_str(), name.c_str()) != 0)
+		throw runtime_error("Error renaming checkpoint file " + tmp_name);
+	log_stream << "Wrote clustering checkpoint " << name << std::endl;
+}
+
+bool RoundCheckpoint::read(const string& prefix, int round, uint64_t fingerprint, vector<SuperBlockId>& centroids, BitVector& oid_filter, vector<SuperBlockId>& component_roots) {
+	const string name = file_name(prefix, round);
+	if (!exists(name))
+		return false;
+	InputFile in(name);
+	uint64_t magic, fp;
+	uint32_t version;
+	int32_t r;
+	int64_t n, filter_size, root_count;
+	// Files of another format or version are treated like stale checkpoints and recomputed.
+	if (in.read(&magic, 1) != 1 || magic != MAGIC_NUMBER || in.read(&version, 1) != 1 || version != VERSION) {
+		in.close();
+		message_stream << "Warning: ignoring clustering checkpoint of unknown format: " << name << std::endl;
+		return false;
+	}
+	in.read(r);
+	in.read(fp);
+	if (r != round || fp != fingerprint) {
+		in.close();
+		return false;
+	}
+	in.read(n);
+	vector<SuperBlockId> c(n);
+	if (in.read(c.data(), n) != (size_t)n)
+		throw runtime_error("Clustering checkpoint file is truncated: " + name);
+	in.read(filter_size);
+	BitVector f(filter_size);
+	if (in.read(f.data(), f.word_count()) != f.word_count())
+		throw runtime_error("Clustering checkpoint file is truncated: " + name);
+	in.read(root_count);
+	vector<SuperBlockId> roots(root_count);
+	if (in.read(roots.data(), root_count) != (size_t)root_count)
+		throw runtime_error("Clustering checkpoint file is truncated: " + name);
+	in.close();
+	centroids = std::move(c);
+	oid_filter = std::move(f);
+	component_roots = std::move(roots);
+	return true;
+}
+
+void SuperBlockCheckpoint::write(const string& prefix, int super_block, uint64_t fingerprint, const vector<SuperBlockId>& centroids, const vector<OId>& assignments) {
+	const string name = RoundCheckpoint::file_name(prefix, super_block), tmp_name = name + ".tmp";
+	OutputFile out(tmp_name);
+	out.write(SUPER_BLOCK_MAGIC_NUMBER);
+	out.write(SUPER_BLOCK_VERSION);
+	out.write((int32_t)super_block);
+	out.write(fingerprint);
+	out.write((int64_t)centroids.size());
+	out.write(centroids.data(), centroids.size());
+	out.write((int64_t)assignments.size());
+	out.write(assignments.data(), assignments.size());
+	out.close();
+	if (std::rename(tmp_name.c_str(), name.c_str()) != 0)
+		throw runtime_error("Error renaming checkpoint file " + tmp_name);
+	log_stream << "Wrote super block checkpoint " << name << std::endl;
+}
+
+bool SuperBlockCheckpoint::read(const string& prefix, int super_block, uint64_t fingerprint, vector<SuperBlockId>& centroids, vector<OId>& assignments) {
+	const string name = RoundCheckpoint::file_name(prefix, super_block);
+	if (!exists(name))
+		return false;
+	InputFile in(name);
+	uint64_t magic, fp;
+	uint32_t version;
+	int32_t b;
+	int64_t n, m;
+	if (in.read(&magic, 1) != 1 || magic != SUPER_BLOCK_MAGIC_NUMBER || in.read(&version, 1) != 1 || version != SUPER_BLOCK_VERSION) {
+		in.close();
+		message_stream << "Warning: ignoring super block checkpoint of unknown format: " << name << std::endl;
+		return false;
+	}
+	in.read(b);
+	in.read(fp);
+	if (b != super_block || fp != fingerprint) {
+		in.close();
+		return false;
+	}
+	in.read(n);
+	vector<SuperBlockId> c(n);
+	if (in.read(c.data(), n) != (size_t)n)
+		throw runtime_error("Super block checkpoint file is truncated: " + name);
+	in.read(m);
+	vector<OId> a(m);
+	if (in.read(a.data(), m) != (size_t)m)
+		throw runtime_error("Super block checkpoint file is truncated: " + name);
+	in.close();
+	centroids = std::move(c);
+	assignments = std::move(a);
+	return true;
+}
+
+}
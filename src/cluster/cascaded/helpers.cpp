@@ -20,13 +20,65 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <sstream>
 #include "cascaded.h"
+#include "../../util/io/input_file.h"
+#include "../../util/log_stream.h"
+#include "../../basic/statistics.h"
+#include "../../run/workflow.h"
+#include "../../data/sequence_file_view.h"
 
 using std::stringstream;
 using std::string;
 using std::vector;
+using std::shared_ptr;
+using std::make_shared;
 
 namespace Cluster {
 
+void Callback::flush(int bucket) {
+	vector<Edge>& buf = buffers_[bucket];
+	if (buf.empty())
+		return;
+	edge_file.write(buf.data(), buf.size());
+	chunks[bucket].emplace_back(file_offset_, (int64_t)buf.size());
+	file_offset_ += buf.size() * sizeof(Edge);
+	buf.clear();
+}
+
+void Callback::flush() {
+	for (int i = 0; i < BUCKET_COUNT; ++i)
+		flush(i);
+}
+
+vector<Callback::Edge> Callback::load_bucket(InputFile& f, int bucket) const {
+	int64_t n = 0;
+	for (const auto& c : chunks[bucket])
+		n += c.second;
+	vector<Edge> edges(n);
+	Edge* ptr = edges.data();
+	for (const auto& c : chunks[bucket]) {
+		f.seek(c.first);
+		f.read(ptr, c.second);
+		ptr += c.second;
+	}
+	return edges;
+}
+
+vector<int64_t> Callback::bucket_edges() const {
+	vector<int64_t> v(BUCKET_COUNT, 0);
+	for (int i = 0; i < BUCKET_COUNT; ++i)
+		for (const auto& c : chunks[i])
+			v[i] += c.second;
+	return v;
+}
+
+vector<Callback::Edge> Callback::load_all(InputFile& f) const {
+	vector<Edge> edges(count);
+	f.read(edges.data(), count);
+	return edges;
+}
+
+const char* const KMER_CLUSTER_STEP = "kmer";
+
 vector<string> cluster_steps(double approx_id, bool linear) {
 	if (!config.cluster_steps.empty())
 		return config.cluster_steps;
@@ -41,6 +93,52 @@ vector<string> cluster_steps(double approx_id, bool linear) {
 	return v;
 }
 
+// The k-mer step does not run a search, its sensitivity is only used where a step list ends with it.
+Sensitivity step_sensitivity(const string& step) {
+	if (step == KMER_CLUSTER_STEP)
+		return Sensitivity::FASTER;
+	return from_string<Sensitivity>(rstrip(step, "_lin"));
+}
+
+int64_t assign_to_centroids(shared_ptr<SequenceFile>& db, vector<OId>& clustering, const vector<OId>& centroids, const vector<OId>& queries, int64_t db_size, bool reset_filters, vector<OId>* unassigned) {
+	TaskTimer timer("Creating centroid database");
+	shared_ptr<SequenceFile> centroid_db(sub_db_view(db, centroids.cbegin(), centroids.cend()));
+
+	timer.go("Creating query database");
+	shared_ptr<SequenceFile> query_db(sub_db_view(db, queries.cbegin(), queries.cend()));
+	timer.finish();
+
+	statistics.reset();
+	config.command = Config::blastp;
+	config.max_target_seqs_ = 1;
+	if (reset_filters)
+		config.toppercent = 100;
+	config.output_format = { "edge" };
+	config.self = false;
+	if (config.mutual_cover.present())
+		config.query_cover = config.subject_cover = config.mutual_cover.get_present();
+	else {
+		config.query_cover = config.member_cover;
+		config.subject_cover = 0;
+	}
+	if (reset_filters)
+		config.query_or_target_cover = 0;
+	config.sensitivity = step_sensitivity(cluster_steps(config.approx_min_id, false).back());
+	config.db_size = db_size ? db_size : centroid_db->letters();
+	shared_ptr<Mapback> mapback = make_shared<Mapback>(queries.size());
+	Search::run(centroid_db, query_db, mapback);
+
+	timer.go("Updating clustering");
+	const int64_t n = update_clustering(clustering.begin(), mapback->centroid_id.cbegin(), queries.cbegin(), queries.cend(), centroids.cbegin());
+	if (unassigned)
+		for (OId i : mapback->unmapped())
+			unassigned->push_back(queries[i]);
+	timer.go("Closing the databases");
+	query_db->close();
+	centroid_db->close();
+	return n;
+}
+
 vector<string> default_round_approx_id(int steps) {
 	switch (steps) {
 	case 1:
@@ -0,0 +1,406 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2024 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <buchfink@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#include <algorithm>
+#include <cmath>
+#include <atomic>
+#include <thread>
+#include <tuple>
+#include "cascaded.h"
+#include "../../basic/reduction.h"
+#include "../../data/block/block.h"
+#include "../../stats/score_matrix.h"
+#include "../../util/hash_function.h"
+#include "../../util/string/string.h"
+#include "../../util/algo/radix_sort.h"
+#define _REENTRANT
+#include "../../lib/ips4o/ips4o.hpp"
+
+using std::vector;
+using std::shared_ptr;
+using std::unique_ptr;
+using std::atomic;
+using std::thread;
+using std::pair;
+using std::endl;
+using std::min;
+using std::max;
+
+// Linear clustering round in the spirit of MMseqs2 linclust: every sequence contributes the
+// kmer_per_seq k-mers with the smallest hash values over a reduced alphabet, and is only compared
+// to the longest sequence of each k-mer group. The database is streamed in blocks and the k-mers
+// are collected in as many passes over disjoint key ranges as the memory limit requires, each pass
+// verifying its own candidate pairs before the next one starts. Candidates are verified by an
+// ungapped alignment on the diagonal of the shared k-mer, or by a banded gapped alignment around it
+// if that fails, and the resulting edges are passed to the greedy vertex cover.
+
+namespace Cluster {
+
+static const int KMER_LEN = 10;
+// Half width of the band of the gapped verification.
+static const Loc BAND = 16;
+
+namespace {
+
+// The key is the k-mer itself, so that groups never merge unrelated k-mers.
+struct KmerEntry {
+	using Key = uint64_t;
+	struct GetKey {
+		Key operator()(const KmerEntry& e) const {
+			return e.key;
+		}
+	};
+	Key key;
+	Loc len;
+	uint32_t block;
+	BlockId block_id;
+	Loc pos;
+};
+
+struct Candidate {
+	bool operator<(const Candidate& c) const {
+		return std::tie(rep_block, member_block, rep, member) < std::tie(c.rep_block, c.member_block, c.rep, c.member);
+	}
+	bool operator==(const Candidate& c) const {
+		return rep_block == c.rep_block && member_block == c.member_block && rep == c.rep && member == c.member;
+	}
+	uint32_t rep_block, member_block;
+	BlockId rep, member;
+	Loc diag;
+};
+
+struct Alignment {
+	int score;
+	Loc ident, len, member_span, rep_span;
+};
+
+}
+
+// Constructed on first use, since a global reduction may be initialized before the letter tables it is built from.
+static const Reduction& reduction() {
+	static const Reduction r("AST C DN EQ FY G H IV KR LM P W");
+	return r;
+}
+
+static uint64_t kmer_space() {
+	return (uint64_t)pow((double)reduction().size(), KMER_LEN);
+}
+
+static void get_kmers(const Sequence& seq, uint32_t block, BlockId block_id, int kmer_per_seq, uint64_t partitions, uint64_t partition, vector<std::tuple<uint64_t, uint64_t, Loc>>& buf, vector<KmerEntry>& out) {
+	buf.clear();
+	uint64_t kmer = 0;
+	int valid = 0;
+	const Reduction& r = reduction();
+	const uint64_t mod = kmer_space() / r.size();
+	for (Loc i = 0; i < seq.length(); ++i) {
+		const Letter l = letter_mask(seq[i]);
+		if (!is_amino_acid(l)) {
+			valid = 0;
+			kmer = 0;
+			continue;
+		}
+		if (valid == KMER_LEN)
+			kmer %= mod;
+		else
+			++valid;
+		kmer = kmer * r.size() + r(l);
+		if (valid == KMER_LEN)
+			buf.emplace_back(MurmurHash()(kmer), kmer, i - KMER_LEN + 1);
+	}
+	const size_t n = min(buf.size(), (size_t)kmer_per_seq);
+	std::partial_sort(buf.begin(), buf.begin() + n, buf.end());
+	for (size_t i = 0; i < n; ++i) {
+		const uint64_t key = std::get<1>(buf[i]);
+		if ((i == 0 || key != std::get<1>(buf[i - 1])) && key % partitions == partition)
+			out.push_back({ key, seq.length(), block, block_id, std::get<2>(buf[i]) });
+	}
+}
+
+template<typename F>
+static void parallel_for(int64_t n, F f) {
+	const int64_t chunk = max(n / (config.threads_ * 16) + 1, (int64_t)1024);
+	atomic<int64_t> next(0);
+	vector<thread> threads;
+	for (int t = 0; t < config.threads_; ++t)
+		threads.emplace_back([&, t] {
+			int64_t begin;
+			while ((begin = next.fetch_add(chunk)) < n)
+				f(t, begin, min(begin + chunk, n));
+		});
+	for (thread& t : threads)
+		t.join();
+}
+
+// Ungapped alignment of the member on the diagonal of the shared k-mer, over the whole overlap.
+static Alignment ungapped(const Sequence& rep, const Sequence& member, Loc diag) {
+	const Loc begin = max(0, -diag), end = min(member.length(), rep.length() - diag);
+	Alignment a{ 0, 0, max(end - begin, 0), 0, 0 };
+	for (Loc i = begin; i < end; ++i) {
+		const Letter r = letter_mask(rep[i + diag]), m = letter_mask(member[i]);
+		a.score += score_matrix(r, m);
+		if (r == m)
+			++a.ident;
+	}
+	a.member_span = a.rep_span = a.len;
+	return a;
+}
+
+// Local alignment restricted to the diagonals diag-BAND..diag+BAND. Each cell carries the
+// identities, the length and the start of its path so that no traceback is needed.
+static Alignment banded(const Sequence& rep, const Sequence& member, Loc diag) {
+	struct Cell {
+		int score;
+		Loc ident, len, i0, j0;
+	};
+	const Cell none{ 0, 0, 0, 0, 0 };
+	const int gap_open = score_matrix.gap_open() + score_matrix.gap_extend(), gap_extend = score_matrix.gap_extend();
+	const Loc w = 2 * BAND + 1, m = member.length(), n = rep.length();
+	Cell h[2][2 * BAND + 2], f[2][2 * BAND + 2];
+	std::fill(h[0], h[0] + w + 1, none);
+	std::fill(f[0], f[0] + w + 1, none);
+	h[1][w] = f[1][w] = none;
+	Cell best = none;
+	Loc best_i = 0, best_j = 0;
+	const Loc i_begin = max(0, -diag - BAND), i_end = min(m, n - diag + BAND);
+	for (Loc i = i_begin; i < i_end; ++i) {
+		const Cell* ph = h[(i - i_begin) & 1], * pf = f[(i - i_begin) & 1];
+		Cell* ch = h[(i - i_begin + 1) & 1], * cf = f[(i - i_begin + 1) & 1];
+		Cell e = none;
+		for (Loc k = 0; k < w; ++k) {
+			const Loc j = i + diag - BAND + k;
+			if (j < 0 || j >= n) {
+				ch[k] = cf[k] = e = none;
+				continue;
+			}
+			const Letter r = letter_mask(rep[j]), l = letter_mask(member[i]);
+			Cell d = ph[k].score > 0 ? ph[k] : Cell{ 0, 0, 0, i, j };
+			d.score += score_matrix(r, l);
+			d.ident += r == l;
+			++d.len;
+			if (k > 0 && ch[k - 1].score - gap_open > e.score - gap_extend)
+				e = { ch[k - 1].score - gap_open, ch[k - 1].ident, ch[k - 1].len + 1, ch[k - 1].i0, ch[k - 1].j0 };
+			else {
+				e.score -= gap_extend;
+				++e.len;
+			}
+			Cell v = pf[k + 1];
+			if (ph[k + 1].score - gap_open > v.score - gap_extend)
+				v = { ph[k + 1].score - gap_open, ph[k + 1].ident, ph[k + 1].len + 1, ph[k + 1].i0, ph[k + 1].j0 };
+			else {
+				v.score -= gap_extend;
+				++v.len;
+			}
+			if (e.score <= 0)
+				e = none;
+			if (v.score <= 0)
+				v = none;
+			Cell c = d;
+			if (e.score > c.score)
+				c = e;
+			if (v.score > c.score)
+				c = v;
+			if (c.score <= 0)
+				c = none;
+			ch[k] = c;
+			cf[k] = v;
+			if (c.score > best.score) {
+				best = c;
+				best_i = i;
+				best_j = j;
+			}
+		}
+	}
+	if (best.score == 0)
+		return { 0, 0, 0, 0, 0 };
+	return { best.score, best.ident, best.len, best_i - best.i0 + 1, best_j - best.j0 + 1 };
+}
+
+vector<SuperBlockId> kmer_cluster(shared_ptr<SequenceFile>& db, const shared_ptr<BitVector>& filter, const SuperBlockId* member_counts, int round, int round_count, DisjointSet<SuperBlockId>* components) {
+	using Edge = Util::Algo::Edge<SuperBlockId>;
+	const int64_t memory_limit = Util::String::interpret_number(config.memory_limit.get(DEFAULT_MEMORY_LIMIT)),
+		max_letters = (int64_t)(block_size(memory_limit, config.sensitivity, config.lin_stage1).first * 1e9),
+		seq_count = filter ? filter->one_count() : db->sequence_count();
+	// Each k-mer yields at most one candidate pair, and the candidates of a partition are verified before the next one is computed.
+	const uint64_t partitions = (uint64_t)(seq_count * config.kmer_per_seq * (int64_t)(sizeof(KmerEntry) + sizeof(Candidate)) / max(memory_limit / 2, (int64_t)1)) + 1;
+	// Position of the sequence info pointer at the start of each block, used to load it again.
+	vector<OId> block_ptr;
+	auto load_block = [&](uint32_t i) {
+		db->set_seqinfo_ptr(block_ptr[i]);
+		return unique_ptr<Block>(db->load_seqs(max_letters, filter.get(), SequenceFile::LoadFlags::SEQS));
+	};
+
+	const bool mutual_cover = config.mutual_cover.present();
+	double cover = config.member_cover;
+	if (mutual_cover) {
+		const vector<std::string> round_coverage = config.round_coverage.empty() ? default_round_cov(round_count) : config.round_coverage;
+		cover = max(config.mutual_cover.get_present(), round_value(round_coverage, "--round-coverage", round, round_count));
+	}
+	const double min_id = config.approx_min_id.get(0.0);
+	auto accept = [&](const Alignment& a, Loc member_len, Loc rep_len) {
+		return a.len > 0 && a.ident * 100.0 >= min_id * a.len && a.member_span * 100.0 >= cover * member_len
+			&& (!mutual_cover || a.rep_span * 100.0 >= cover * rep_len);
+	};
+
+	TaskTimer timer;
+	// Edges of all previous partitions, sorted and without duplicates. A pair that shares k-mers from
+	// several partitions is only verified in the first one.
+	vector<Edge> edges;
+	vector<vector<Edge>> thread_edges(config.threads_);
+	int64_t candidate_count = 0, gapped = 0;
+	unique_ptr<Block> rep_block, member_block;
+	for (uint64_t partition = 0; partition < partitions; ++partition) {
+		timer.go("Computing k-mers");
+		vector<vector<KmerEntry>> thread_kmers(config.threads_);
+		db->set_seqinfo_ptr(0);
+		for (uint32_t b = 0;; ++b) {
+			if (partition == 0)
+				block_ptr.push_back(db->tell_seq());
+			else if (b == block_ptr.size())
+				break;
+			unique_ptr<Block> block(db->load_seqs(max_letters, filter.get(), SequenceFile::LoadFlags::SEQS));
+			if (block->empty()) {
+				block_ptr.pop_back();
+				break;
+			}
+			const SequenceSet& seqs = block->seqs();
+			parallel_for((int64_t)seqs.size(), [&](int thread_id, int64_t begin, int64_t end) {
+				vector<std::tuple<uint64_t, uint64_t, Loc>> buf;
+				for (BlockId i = (BlockId)begin; i < (BlockId)end; ++i)
+					get_kmers(seqs[i], b, i, config.kmer_per_seq, partitions, partition, buf, thread_kmers[thread_id]);
+			});
+		}
+		vector<KmerEntry> kmers;
+		for (vector<KmerEntry>& v : thread_kmers) {
+			kmers.insert(kmers.end(), v.begin(), v.end());
+			vector<KmerEntry>().swap(v);
+		}
+
+		timer.go("Sorting k-mers");
+		radix_sort<KmerEntry, KmerEntry::GetKey>(kmers.data(), kmers.data() + kmers.size(), kmer_space() - 1, config.threads_);
+		log_stream << "K-mers: " << kmers.size() << " Partition: " << partition + 1 << '/' << partitions << endl;
+
+		timer.go("Computing candidate pairs");
+		vector<int64_t> group_begin;
+		for (int64_t i = 0; i < (int64_t)kmers.size(); ++i)
+			if (i == 0 || kmers[i].key != kmers[i - 1].key)
+				group_begin.push_back(i);
+		group_begin.push_back((int64_t)kmers.size());
+		vector<vector<Candidate>> thread_candidates(config.threads_);
+		parallel_for((int64_t)group_begin.size() - 1, [&](int thread_id, int64_t begin, int64_t end) {
+			for (int64_t g = begin; g < end; ++g) {
+				const KmerEntry* first = kmers.data() + group_begin[g], * last = kmers.data() + group_begin[g + 1];
+				if (last - first < 2)
+					continue;
+				const KmerEntry* rep = first;
+				for (const KmerEntry* e = first + 1; e < last; ++e)
+					if (e->len > rep->len || (e->len == rep->len && std::tie(e->block, e->block_id) < std::tie(rep->block, rep->block_id)))
+						rep = e;
+				for (const KmerEntry* e = first; e < last; ++e)
+					if (e != rep)
+						thread_candidates[thread_id].push_back({ rep->block, e->block, rep->block_id, e->block_id, rep->pos - e->pos });
+			}
+		});
+		vector<KmerEntry>().swap(kmers);
+		vector<Candidate> candidates;
+		for (vector<Candidate>& v : thread_candidates) {
+			candidates.insert(candidates.end(), v.begin(), v.end());
+			vector<Candidate>().swap(v);
+		}
+		ips4o::parallel::sort(candidates.begin(), candidates.end(), std::less<Candidate>(), config.threads_);
+		candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+		candidate_count += candidates.size();
+
+		timer.go("Verifying candidate pairs");
+		// Candidates are sorted by the pair of blocks, so every block of representatives is loaded
+		// once and the blocks of members it pairs with are streamed past it.
+		for (auto it = candidates.cbegin(); it != candidates.cend();) {
+			const uint32_t rb = it->rep_block, mb = it->member_block;
+			auto group_end = it;
+			while (group_end != candidates.cend() && group_end->rep_block == rb && group_end->member_block == mb)
+				++group_end;
+			if (it == candidates.cbegin() || rb != (it - 1)->rep_block)
+				rep_block = load_block(rb);
+			const Block& reps = *rep_block;
+			if (mb != rb)
+				member_block = load_block(mb);
+			const Block& members = mb == rb ? reps : *member_block;
+			const Candidate* first = &*it;
+			atomic<int64_t> gapped_group(0);
+			parallel_for(group_end - it, [&](int thread_id, int64_t begin, int64_t end) {
+				vector<Edge>& out = thread_edges[thread_id];
+				int64_t gapped_count = 0;
+				for (int64_t i = begin; i < end; ++i) {
+					const Candidate& c = first[i];
+					const SuperBlockId rep_oid = (SuperBlockId)reps.block_id2oid(c.rep), member_oid = (SuperBlockId)members.block_id2oid(c.member);
+					if (std::binary_search(edges.cbegin(), edges.cend(), Edge(rep_oid, member_oid, 0.0)))
+						continue;
+					const Sequence rep = reps.seqs()[c.rep], member = members.seqs()[c.member];
+					Alignment a = ungapped(rep, member, c.diag);
+					if (!accept(a, member.length(), rep.length())) {
+						a = banded(rep, member, c.diag);
+						++gapped_count;
+						if (!accept(a, member.length(), rep.length()))
+							continue;
+					}
+					out.emplace_back(rep_oid, member_oid, a.score);
+					if (a.rep_span * 100.0 >= cover * rep.length())
+						out.emplace_back(member_oid, rep_oid, a.score);
+				}
+				gapped_group += gapped_count;
+			});
+			gapped += gapped_group;
+			it = group_end;
+		}
+		vector<Candidate>().swap(candidates);
+
+		// Pairs found with several representatives of the same partition yield duplicate edges, the best scoring one is kept.
+		for (vector<Edge>& v : thread_edges) {
+			edges.insert(edges.end(), v.begin(), v.end());
+			vector<Edge>().swap(v);
+		}
+		ips4o::parallel::sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b) {
+			return a < b || (!(b < a) && a.weight > b.weight);
+		}, config.threads_);
+		edges.erase(std::unique(edges.begin(), edges.end(), [](const Edge& a, const Edge& b) {
+			return a.node1 == b.node1 && a.node2 == b.node2;
+		}), edges.end());
+	}
+	log_stream << "Candidate pairs: " << candidate_count << " Blocks: " << block_ptr.size() << endl;
+	log_stream << "Gapped verifications: " << gapped << endl;
+	rep_block.reset();
+	member_block.reset();
+	db->reopen();
+	timer.finish();
+	message_stream << "Finished k-mer clustering. #Edges: " << edges.size() << endl;
+
+	if (components)
+		for (const Edge& e : edges)
+			components->merge(e.node1, e.node2);
+
+	timer.go("Sorting edges");
+	const SuperBlockId node_count = (SuperBlockId)db->sequence_count();
+	FlatArray<Edge> edge_array = make_flat_array_dense(std::move(edges), node_count, config.threads_, Edge::GetKey());
+	timer.finish();
+	const bool merge_recursive = round == round_count - 1 && !config.strict_gvc && !mutual_cover;
+	return Util::Algo::greedy_vertex_cover(edge_array, config.weighted_gvc ? member_counts : nullptr, merge_recursive, !config.no_gvc_reassign,
+		round_ccd(round, round_count), config.parallel_gvc ? config.threads_ : 1);
+}
+
+}
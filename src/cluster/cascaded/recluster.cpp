@@ -20,11 +20,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "cascaded.h"
 #include "../../basic/config.h"
-#include "../../data/fasta/fasta_file.h"
+#include "../../data/sequence_file_view.h"
 #include "../../run/workflow.h"
 #include "../../output/output_format.h"
 #include "../../basic/statistics.h"
 #include "../search/search.h"
+#include "../clustering_file.h"
 
 using std::unique_ptr;
 using std::endl;
@@ -68,14 +69,12 @@ static vector<OId> recluster(shared_ptr<SequenceFile>& db, const vector<OId>& cl
 	const vector<OId> unal_members = centroid_aligned.negative_list();
 	if (unal_members.empty())
 		return clustering;
-	shared_ptr<FastaFile> unaligned(db->sub_db(unal_members.cbegin(), unal_members.cend()));
-	unaligned->set_seqinfo_ptr(0);
+	shared_ptr<SequenceFile> unaligned(sub_db_view(db, unal_members.cbegin(), unal_members.cend()));
 	timer.finish();
 	message_stream << "#Sequences that failed to align against assigned centroid: " << unal_members.size() << endl;
 
 	timer.go("Creating centroid database");
-	shared_ptr<FastaFile> centroid_db(db->sub_db(centroids.cbegin(), centroids.cend()));
-	centroid_db->set_seqinfo_ptr(0);
+	shared_ptr<SequenceFile> centroid_db(sub_db_view(db, centroids.cbegin(), centroids.cend()));
 	timer.finish();
 
 	statistics.reset();
@@ -92,7 +91,7 @@ static vector<OId> recluster(shared_ptr<SequenceFile>& db, const vector<OId>& cl
 		config.subject_cover = 0;
 	}	
 	config.query_or_target_cover = 0;
-	config.sensitivity = from_string<Sensitivity>(cluster_steps(config.approx_min_id, false).back());
+	config.sensitivity = step_sensitivity(cluster_steps(config.approx_min_id, false).back());
 	//tie(config.chunk_size, config.lowmem_) = block_size(Util::String::interpret_number(config.memory_limit.get(DEFAULT_MEMORY_LIMIT)), Search::iterated_sens.at(config.sensitivity).front(), false);
 	config.lowmem_ = 1;
 	config.chunk_size = 4.0;
@@ -116,7 +115,7 @@ static vector<OId> recluster(shared_ptr<SequenceFile>& db, const vector<OId>& cl
 
 	shared_ptr<SequenceFile> unmapped;
 	timer.go("Creating database of unmapped sequences");
-	unmapped.reset(unaligned->sub_db(unmapped_members.cbegin(), unmapped_members.cend()));
+	unmapped.reset(sub_db_view(unaligned, unmapped_members.cbegin(), unmapped_members.cend()));
 	mapback.reset();
 	timer.finish();
 
@@ -146,10 +145,10 @@ void recluster() {
 	message_stream << "Coverage cutoff: " << (config.mutual_cover.present() ? config.mutual_cover.get_present() : config.member_cover) << '%' << endl;
 
 	TaskTimer timer("Opening the database");
-	shared_ptr<SequenceFile> db(SequenceFile::auto_create({ config.database }, SequenceFile::Flags::NEED_LETTER_COUNT | SequenceFile::Flags::ACC_TO_OID_MAPPING | SequenceFile::Flags::OID_TO_ACC_MAPPING, SequenceFile::Metadata()));
+	shared_ptr<SequenceFile> db(SequenceFile::auto_create({ config.database }, SequenceFile::Flags::NEED_LETTER_COUNT | ClusteringFile::accession_flags(config.clustering, true), SequenceFile::Metadata()));
 	config.db_size = db->letters();
 	timer.finish();
-	unique_ptr<Util::Tsv::File> out(open_out_tsv());
+	ClusteringOutput out;
 	message_stream << "#Database sequences: " << db->sequence_count() << ", #Letters: " << db->letters() << endl;
 
 	timer.go("Reading the input file");
@@ -161,7 +160,7 @@ void recluster() {
 	timer.go("Generating output");
 	if (flag_any(db->format_flags(), SequenceFile::FormatFlags::TITLES_LAZY))
 		db->init_random_access(0, 0, false);
-	output_mem(*out, *db, member2centroid);
+	out.write(*db, member2centroid);
 
 	timer.go("Closing the database");
 	db.reset();
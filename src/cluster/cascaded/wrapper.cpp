@@ -24,6 +24,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../run/workflow.h"
 #include "../util/system/system.h"
 #include "../../search/search.h"
+#include "../clustering_file.h"
+#include "../../util/algo/MurmurHash3.h"
 
 using std::shared_ptr;
 using std::endl;
@@ -42,6 +44,7 @@ using std::back_inserter;
 using std::unique_ptr;
 using std::bind;
 using std::function;
+using std::to_string;
 using namespace Util::Tsv;
 
 namespace Cluster {
@@ -51,14 +54,23 @@ struct Config {
 		linclust(config.command == ::Config::LINCLUST),
 		message_stream(true),
 		verbosity(1),
-		sens(from_string<Sensitivity>(rstrip(cluster_steps(config.approx_min_id, linclust).back(), "_lin"))),
+		sens(step_sensitivity(cluster_steps(config.approx_min_id, linclust).back())),
 		output_format(init_output(-1)),
 		centroids(new FastaFile("", true, FastaFile::WriteAccess())),
 		seqs_processed(0),
 		letters_processed(0),
-		oid_to_centroid_oid(new File(Schema{ Type::INT64, Type::INT64 }, "", Flags::TEMP))
+		oid_to_centroid_oid(new File(Schema{ Type::INT64, Type::INT64 }, "", Flags::TEMP)),
+		checkpoint(!config.round_checkpoint.empty())
 	{
 	}
+	// Records the assignment of a member and keeps it for the checkpoint of the current super block.
+	void assign(OId centroid_oid, OId member_oid) {
+		oid_to_centroid_oid->write_record(centroid_oid, member_oid);
+		if (checkpoint) {
+			assignments.push_back(centroid_oid);
+			assignments.push_back(member_oid);
+		}
+	}
 	bool                                linclust;
 	MessageStream                       message_stream;
 	int                                 verbosity;
@@ -71,6 +83,8 @@ struct Config {
 	int64_t                             letters_processed;
 	std::vector<OId>                    centroid2oid;
 	std::unique_ptr<File>               oid_to_centroid_oid;
+	bool                                checkpoint;
+	std::vector<OId>                    assignments;
 };
 
 int64_t seq_mem_use(Loc len, Loc id_len, int c, int min) {
@@ -148,7 +162,7 @@ static vector<SuperBlockId> search_vs_centroids(shared_ptr<FastaFile>& super_blo
 		}
 		else {
 			const OId centroid_oid = cfg.centroid2oid[best_centroid->operator[](i)];
-			cfg.oid_to_centroid_oid->write_record(centroid_oid, oid);
+			cfg.assign(centroid_oid, oid);
 			++clustered;
 		}
 	}
@@ -158,25 +172,54 @@ static vector<SuperBlockId> search_vs_centroids(shared_ptr<FastaFile>& super_blo
 	return unaligned;
 }
 
+// Hashes a list of OIds in chunks, since the hash function takes a 32 bit length.
+static string oid_hash(const vector<OId>& oids) {
+	static const char SEED[16] = { 0 };
+	static const size_t CHUNK = 1 << 24;
+	uint64_t r = oids.size();
+	for (size_t i = 0; i < oids.size(); i += CHUNK) {
+		uint64_t h[2];
+		MurmurHash3_x64_128(oids.data() + i, (int)(std::min(CHUNK, oids.size() - i) * sizeof(OId)), SEED, h);
+		r = r * 31 + h[0];
+	}
+	return to_string(r);
+}
+
+// Parameters that determine the clustering of the super blocks. The options modified by the rounds
+// are read before the first super block is processed.
+static string super_block_parameters(SequenceFile& db, size_t super_block_count, bool linear) {
+	std::ostringstream ss;
+	ss << db_identity(db) << ' ' << db.sequence_count() << ' ' << super_block_count << ' ' << config.approx_min_id << ' ' << config.max_evalue;
+	for (const string& s : cluster_steps(config.approx_min_id, linear))
+		ss << ' ' << s;
+	for (const vector<string>* v : { &config.round_approx_id, &config.round_coverage, &config.connected_component_depth }) {
+		ss << ' ';
+		for (const string& s : *v)
+			ss << s << ',';
+	}
+	ss << ' ' << clustering_parameters();
+	return ss.str();
+}
+
 void Cascaded::run() {
 	config.database.require();
 	init_thresholds();
 	config.hamming_ext = config.approx_min_id >= 50.0;
 	TaskTimer total_time;
 	TaskTimer timer("Opening the input file");
-	shared_ptr<SequenceFile> db(SequenceFile::auto_create({ config.database }, SequenceFile::Flags::NEED_LETTER_COUNT | SequenceFile::Flags::OID_TO_ACC_MAPPING | SequenceFile::Flags::NEED_LENGTH_LOOKUP));
+	shared_ptr<SequenceFile> db(SequenceFile::auto_create({ config.database }, SequenceFile::Flags::NEED_LETTER_COUNT | SequenceFile::Flags::OID_TO_ACC_MAPPING | SequenceFile::Flags::NEED_LENGTH_LOOKUP | SequenceFile::Flags::CLUSTER_LAYOUT));
 	if (db->type() == SequenceFile::Type::BLAST)
 		throw std::runtime_error("Clustering is not supported for BLAST databases.");
 	timer.finish();
 	message_stream << "Input database: " << db->file_name() << " (" << db->sequence_count() << " sequences, " << db->letters() << " letters)" << endl;
 	const int64_t mem_limit = Util::String::interpret_number(config.memory_limit.get(DEFAULT_MEMORY_LIMIT));
 	const int64_t block_size = (int64_t)(::block_size(mem_limit, Sensitivity::FASTER, true).first * 1e9);
-	unique_ptr<Util::Tsv::File> out(open_out_tsv());
+	ClusteringOutput out;
 
 	if (block_size >= (double)db->letters() && db->sequence_count() < numeric_limits<SuperBlockId>::max()) {
-		const auto centroids = cascaded(db, config.command == ::Config::LINCLUST);
+		const auto centroids = cascaded(db, config.command == ::Config::LINCLUST, config.round_checkpoint.empty() ? string() : config.round_checkpoint + dir_separator + "round");
 		timer.go("Generating output");
-		output_mem<SuperBlockId>(*out, *db, centroids);
+		out.write(*db, centroids);
 	}
 	else {
 		timer.go("Length sorting the input file");
@@ -187,6 +230,11 @@ void Cascaded::run() {
 		vector<tuple<FastaFile*, vector<OId>, Util::Tsv::File*>> super_blocks = db->length_sort(mem_limit / 2, seq_size);
 		timer.finish();
 		config.freq_masking = true;
+		// Super blocks are fingerprinted by the input, their OIds and the parameters, so that finished ones can be skipped when resuming.
+		const string checkpoint = config.round_checkpoint.empty() ? string() : config.round_checkpoint + dir_separator + "super_block",
+			parameters = super_block_parameters(*db, super_blocks.size(), cfg.linclust);
+		uint64_t fingerprint = 0;
+		bool resuming = cfg.checkpoint;
 		int i = 0;
 		for (auto& b : super_blocks) {
 			message_stream << "Processing super block " << (i++) + 1 << '/' << super_blocks.size() << endl;
@@ -202,6 +250,24 @@ void Cascaded::run() {
 			oid_mapping->template read<int64_t>(back_inserter(super_block_id_to_oid));
 			timer.finish();
 			log_rss();
+			if (cfg.checkpoint)
+				fingerprint = RoundCheckpoint::fingerprint(fingerprint, to_string(i) + ' ' + oid_hash(super_block_id_to_oid) + ' ' + parameters);
+			if (resuming) {
+				vector<SuperBlockId> centroids;
+				if (SuperBlockCheckpoint::read(checkpoint, i - 1, fingerprint, centroids, cfg.assignments)) {
+					message_stream << "Resuming clustering after super block " << i << endl;
+					for (size_t j = 0; j < cfg.assignments.size(); j += 2)
+						cfg.oid_to_centroid_oid->write_record(cfg.assignments[j], cfg.assignments[j + 1]);
+					cfg.assignments.clear();
+					for (SuperBlockId c : centroids)
+						cfg.centroid2oid.push_back(super_block_id_to_oid[c]);
+					seqs->sub_db(centroids.cbegin(), centroids.cend(), cfg.centroids.get());
+					seqs->close();
+					delete oid_mapping;
+					continue;
+				}
+				resuming = false;
+			}
 			if (i == 1) {
 				unaligned_db = seqs;
 				unaligned.resize(seqs->sequence_count());
@@ -216,18 +282,30 @@ void Cascaded::run() {
 				seqs.reset();
 				timer.finish();
 			}
-			const vector<SuperBlockId> clustering = cascaded(unaligned_db, cfg.linclust);
+			// The rounds run on a temporary database, which is identified by the sequences it contains.
+			vector<OId> unaligned_oids;
+			if (cfg.checkpoint)
+				for (SuperBlockId j : unaligned)
+					unaligned_oids.push_back(super_block_id_to_oid[j]);
+			const vector<SuperBlockId> clustering = cascaded(unaligned_db, cfg.linclust,
+				cfg.checkpoint ? checkpoint + "_" + to_string(i) + "_round" : string(),
+				cfg.checkpoint ? to_string(fingerprint) + ' ' + oid_hash(unaligned_oids) : string());
 			timer.go("Updating clustering");
-			vector<SuperBlockId> centroids;
+			vector<SuperBlockId> centroids, super_block_centroids;
 			for (SuperBlockId i = 0; i < (SuperBlockId)unaligned.size(); ++i) {
 				const OId member_oid = super_block_id_to_oid[unaligned[i]], centroid_oid = super_block_id_to_oid[unaligned[clustering[i]]];
-				cfg.oid_to_centroid_oid->write_record(centroid_oid, member_oid);
+				cfg.assign(centroid_oid, member_oid);
 				if (member_oid == centroid_oid) {
 					cfg.centroid2oid.push_back(centroid_oid);
 					centroids.push_back(i);
+					super_block_centroids.push_back(unaligned[i]);
 				}
 			}
 			unaligned_db->sub_db(centroids.cbegin(), centroids.cend(), cfg.centroids.get());
+			if (cfg.checkpoint) {
+				SuperBlockCheckpoint::write(checkpoint, i - 1, fingerprint, super_block_centroids, cfg.assignments);
+				cfg.assignments.clear();
+			}
 			timer.go("Freeing memory");
 			unaligned_db->close();
 			unaligned_db.reset();
@@ -237,7 +315,7 @@ void Cascaded::run() {
 		message_stream << "Total clusters: " << cfg.centroid2oid.size() << endl;
 		message_stream << "Total time: " << total_time.seconds() << 's' << endl;
 		timer.go("Generating output");
-		output_mem(*out, *db, *cfg.oid_to_centroid_oid);
+		out.write(*db, *cfg.oid_to_centroid_oid);
 	}
 	db->close();
 }
@@ -45,8 +45,10 @@ void realign(const FlatArray<OId>& clusters, const std::vector<OId>& centroids,
 void realign(const std::vector<OId>& clustering, SequenceFile& db, std::function<void(const HspContext&)>& callback, HspValues hsp_values);
 template<typename Int>
 std::pair<FlatArray<Int>, std::vector<Int>> read(const std::string& file_name, const SequenceFile& db, CentroidSorted);
+// Reads a clustering as a member -> centroid mapping. If allow_incomplete is set, sequences
+// missing from the file are mapped to -1.
 template<typename Int>
-std::vector<Int> read(const std::string& file_name, const SequenceFile& db);
+std::vector<Int> read(const std::string& file_name, const SequenceFile& db, bool allow_incomplete = false);
 template<typename Int>
 std::vector<Int> member2centroid_mapping(const FlatArray<Int>& clusters, const std::vector<Int>& centroids);
 template<typename Int>
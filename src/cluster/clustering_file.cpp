@@ -0,0 +1,277 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2024 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <buchfink@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <string.h>
+#include "clustering_file.h"
+#include "cluster.h"
+#include "../basic/config.h"
+#include "../data/dmnd/dmnd.h"
+#include "../util/io/output_file.h"
+#include "../util/io/input_file.h"
+#include "../util/tsv/file.h"
+
+using std::string;
+using std::vector;
+using std::pair;
+using std::runtime_error;
+using std::back_inserter;
+
+namespace Cluster {
+
+const uint64_t ClusteringFile::MAGIC_NUMBER = 0x8e27c4a19d6b30f5llu;
+const uint32_t ClusteringFile::VERSION = 0;
+
+// Header: magic number, version, integer size (4 or 8), sequence count, database hash, flags
+static const uint32_t FLAG_CLUSTER_INDEX = 1;
+
+static void db_hash(const SequenceFile& db, char* hash) {
+	if (db.type() == SequenceFile::Type::DMND)
+		memcpy(hash, static_cast<const DatabaseFile&>(db).header2.hash, 16);
+	else
+		memset(hash, 0, 16);
+}
+
+bool ClusteringFile::is_binary(const string& file_name) {
+	std::ifstream in(file_name, std::ios::binary);
+	uint64_t magic = 0;
+	in.read((char*)&magic, sizeof(magic));
+	return in.good() && magic == MAGIC_NUMBER;
+}
+
+static bool binary_output() {
+	return config.clustering_format == "binary" || config.clustering_format == "binary-sorted";
+}
+
+SequenceFile::Flags ClusteringFile::accession_flags(const string& file_name, bool output) {
+	SequenceFile::Flags flags = SequenceFile::Flags::NONE;
+	if (!is_binary(file_name))
+		flags |= SequenceFile::Flags::ACC_TO_OID_MAPPING;
+	if (output && !binary_output())
+		flags |= SequenceFile::Flags::OID_TO_ACC_MAPPING;
+	return flags;
+}
+
+template<typename Stored, typename Int>
+static void write_array(OutputFile& out, const vector<Int>& v) {
+	vector<Stored> buf;
+	buf.reserve(MEGABYTES);
+	for (auto it = v.cbegin(); it != v.cend();) {
+		buf.clear();
+		for (; it != v.cend() && buf.size() < MEGABYTES; ++it)
+			buf.push_back((Stored)*it);
+		out.write(buf.data(), buf.size());
+	}
+}
+
+template<typename Stored, typename Int>
+static void read_array(InputFile& in, vector<Int>& v) {
+	vector<Stored> buf(MEGABYTES);
+	for (size_t i = 0; i < v.size();) {
+		const size_t n = std::min(v.size() - i, buf.size());
+		if (in.read(buf.data(), n) != n)
+			throw runtime_error("Clustering file is truncated: " + in.file_name);
+		std::copy(buf.begin(), buf.begin() + n, v.begin() + i);
+		i += n;
+	}
+}
+
+template<typename Int>
+void ClusteringFile::write(OutputFile& out, const SequenceFile& db, const vector<Int>& mapping, bool cluster_index) {
+	const uint32_t int_size = db.sequence_count() > (int64_t)std::numeric_limits<int32_t>::max() ? 8 : 4;
+	char hash[16];
+	db_hash(db, hash);
+	out.write(MAGIC_NUMBER);
+	out.write(VERSION);
+	out.write(int_size);
+	out.write((int64_t)mapping.size());
+	out.write(hash, 16);
+	out.write(cluster_index ? FLAG_CLUSTER_INDEX : 0u);
+	if (int_size == 8)
+		write_array<int64_t>(out, mapping);
+	else
+		write_array<int32_t>(out, mapping);
+	if (!cluster_index)
+		return;
+	FlatArray<Int> clusters;
+	vector<Int> centroids;
+	tie(clusters, centroids) = cluster_sorted(mapping);
+	if (!centroids.empty() && centroids.front() == -1) {
+		// Sequences missing from an incomplete clustering are not part of the index.
+		vector<Int> limits{ 0 }, members;
+		vector<Int> c;
+		for (Int i = 1; i < (Int)centroids.size(); ++i) {
+			c.push_back(centroids[i]);
+			members.insert(members.end(), clusters.cbegin(i), clusters.cend(i));
+			limits.push_back((Int)members.size());
+		}
+		clusters = FlatArray<Int>(vector<int64_t>(limits.begin(), limits.end()), std::move(members));
+		centroids = std::move(c);
+	}
+	out.write((int64_t)centroids.size());
+	if (int_size == 8)
+		write_array<int64_t>(out, centroids);
+	else
+		write_array<int32_t>(out, centroids);
+	vector<int64_t> limits(centroids.size() + 1);
+	for (Int i = 0; i < (Int)centroids.size(); ++i)
+		limits[i + 1] = limits[i] + clusters.count(i);
+	out.write(limits.data(), limits.size());
+	vector<Int> members;
+	members.reserve(limits.back());
+	for (Int i = 0; i < (Int)centroids.size(); ++i)
+		members.insert(members.end(), clusters.cbegin(i), clusters.cend(i));
+	if (int_size == 8)
+		write_array<int64_t>(out, members);
+	else
+		write_array<int32_t>(out, members);
+}
+
+template void ClusteringFile::write<int32_t>(OutputFile&, const SequenceFile&, const vector<int32_t>&, bool);
+template void ClusteringFile::write<int64_t>(OutputFile&, const SequenceFile&, const vector<int64_t>&, bool);
+
+// With allow_incomplete, the file may refer to a prefix of the database, which is the case after
+// sequences were appended to it. The hash of such an extended database necessarily differs, so it
+// is only compared if the sequence counts match.
+static uint32_t read_header(InputFile& in, const SequenceFile& db, bool allow_incomplete, uint32_t& flags, int64_t& count) {
+	uint64_t magic;
+	uint32_t version, int_size;
+	char hash[16], expected_hash[16], zero[16] = { 0 };
+	in.read(magic);
+	if (magic != ClusteringFile::MAGIC_NUMBER)
+		throw runtime_error("Invalid clustering file: " + in.file_name);
+	in.read(version);
+	if (version != ClusteringFile::VERSION)
+		throw runtime_error("Invalid clustering file version: " + in.file_name);
+	in.read(int_size);
+	in.read(count);
+	if (in.read(hash, 16) != 16)
+		throw runtime_error("Clustering file is truncated: " + in.file_name);
+	in.read(flags);
+	db_hash(db, expected_hash);
+	const bool hash_mismatch = memcmp(hash, zero, 16) != 0 && memcmp(expected_hash, zero, 16) != 0 && memcmp(hash, expected_hash, 16) != 0;
+	if (count > db.sequence_count() || (!allow_incomplete && count != db.sequence_count()) || (count == db.sequence_count() && hash_mismatch))
+		throw runtime_error("Clustering file " + in.file_name + " does not match the database.");
+	if (int_size != 4 && int_size != 8)
+		throw runtime_error("Invalid clustering file: " + in.file_name);
+	return int_size;
+}
+
+template<typename Int>
+vector<Int> ClusteringFile::read(const string& file_name, const SequenceFile& db, bool allow_incomplete) {
+	InputFile in(file_name);
+	uint32_t flags;
+	int64_t count;
+	const uint32_t int_size = read_header(in, db, allow_incomplete, flags, count);
+	vector<Int> v(count);
+	if (int_size == 8)
+		read_array<int64_t>(in, v);
+	else
+		read_array<int32_t>(in, v);
+	in.close();
+	if (!allow_incomplete && std::find(v.begin(), v.end(), -1) != v.end())
+		throw runtime_error("Invalid/incomplete clustering.");
+	v.resize(db.sequence_count(), -1);
+	return v;
+}
+
+template vector<int32_t> ClusteringFile::read<int32_t>(const string&, const SequenceFile&, bool);
+template vector<int64_t> ClusteringFile::read<int64_t>(const string&, const SequenceFile&, bool);
+
+template<typename Int>
+pair<FlatArray<Int>, vector<Int>> ClusteringFile::read_sorted(const string& file_name, const SequenceFile& db) {
+	InputFile in(file_name);
+	uint32_t flags;
+	int64_t count;
+	const uint32_t int_size = read_header(in, db, false, flags, count);
+	if (!(flags & FLAG_CLUSTER_INDEX)) {
+		in.close();
+		return cluster_sorted(read<Int>(file_name, db, false));
+	}
+	if (!in.seek_forward((size_t)(count * int_size)))
+		throw runtime_error("Clustering file is truncated: " + file_name);
+	int64_t centroid_count;
+	in.read(centroid_count);
+	vector<Int> centroids(centroid_count), members;
+	vector<int64_t> limits(centroid_count + 1);
+	if (int_size == 8)
+		read_array<int64_t>(in, centroids);
+	else
+		read_array<int32_t>(in, centroids);
+	if (in.read(limits.data(), limits.size()) != limits.size())
+		throw runtime_error("Clustering file is truncated: " + file_name);
+	members.resize(limits.back());
+	if (int_size == 8)
+		read_array<int64_t>(in, members);
+	else
+		read_array<int32_t>(in, members);
+	in.close();
+	return { FlatArray<Int>(std::move(limits), std::move(members)), std::move(centroids) };
+}
+
+template pair<FlatArray<int32_t>, vector<int32_t>> ClusteringFile::read_sorted<int32_t>(const string&, const SequenceFile&);
+template pair<FlatArray<int64_t>, vector<int64_t>> ClusteringFile::read_sorted<int64_t>(const string&, const SequenceFile&);
+
+ClusteringOutput::ClusteringOutput():
+	cluster_index_(config.clustering_format == "binary-sorted")
+{
+	if (binary_output()) {
+		if (config.output_file.empty())
+			throw runtime_error("Binary clustering output requires an output file (--out).");
+		binary_.reset(new OutputFile(config.output_file));
+	}
+	else if (config.clustering_format.empty() || config.clustering_format == "tsv")
+		tsv_.reset(open_out_tsv());
+	else
+		throw runtime_error("Invalid clustering format: " + config.clustering_format);
+}
+
+ClusteringOutput::~ClusteringOutput() {
+	if (binary_)
+		binary_->close();
+}
+
+template<typename Int>
+void ClusteringOutput::write(SequenceFile& db, const vector<Int>& mapping) {
+	if (tsv_)
+		output_mem(*tsv_, db, mapping);
+	else
+		ClusteringFile::write(*binary_, db, mapping, cluster_index_);
+}
+
+template void ClusteringOutput::write<int32_t>(SequenceFile&, const vector<int32_t>&);
+template void ClusteringOutput::write<int64_t>(SequenceFile&, const vector<int64_t>&);
+
+void ClusteringOutput::write(SequenceFile& db, Util::Tsv::File& oid_to_centroid_oid) {
+	if (tsv_) {
+		output_mem(*tsv_, db, oid_to_centroid_oid);
+		return;
+	}
+	vector<pair<int64_t, int64_t>> pairs;
+	oid_to_centroid_oid.template read<int64_t, int64_t>(back_inserter(pairs));
+	vector<int64_t> mapping(db.sequence_count(), -1);
+	for (const auto& p : pairs)
+		mapping[p.second] = p.first;
+	ClusteringFile::write(*binary_, db, mapping, cluster_index_);
+}
+
+}
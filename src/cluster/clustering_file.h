@@ -0,0 +1,80 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2024 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <buchfink@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#pragma once
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../basic/value.h"
+#include "../util/data_structures/flat_array.h"
+#include "../data/sequence_file.h"
+
+struct OutputFile;
+namespace Util { namespace Tsv { struct File; } }
+
+namespace Cluster {
+
+// Binary clustering file: the OId -> centroid OId array of a database, stored with the sequence
+// count and the hash of the database it refers to (zero for databases without a hash). The file
+// can optionally contain the clustering sorted by centroid (centroid OIds, cluster limits and
+// members) so that readers of clusters do not need to sort the mapping.
+
+struct ClusteringFile {
+
+	static bool is_binary(const std::string& file_name);
+	// Accession mappings the database needs to read the clustering file_name and, with output, to
+	// write a clustering in the format selected by --clustering-format.
+	static SequenceFile::Flags accession_flags(const std::string& file_name, bool output);
+
+	template<typename Int>
+	static void write(OutputFile& out, const SequenceFile& db, const std::vector<Int>& mapping, bool cluster_index);
+	template<typename Int>
+	static std::vector<Int> read(const std::string& file_name, const SequenceFile& db, bool allow_incomplete);
+	template<typename Int>
+	static std::pair<FlatArray<Int>, std::vector<Int>> read_sorted(const std::string& file_name, const SequenceFile& db);
+
+	static const uint64_t MAGIC_NUMBER;
+	static const uint32_t VERSION;
+
+};
+
+// Writes the final clustering of a workflow in the format selected by --clustering-format
+// (tsv, binary or binary-sorted). The output file is opened on construction.
+
+struct ClusteringOutput {
+
+	ClusteringOutput();
+	~ClusteringOutput();
+
+	template<typename Int>
+	void write(SequenceFile& db, const std::vector<Int>& mapping);
+	void write(SequenceFile& db, Util::Tsv::File& oid_to_centroid_oid);
+
+private:
+
+	std::unique_ptr<Util::Tsv::File> tsv_;
+	std::unique_ptr<OutputFile> binary_;
+	bool cluster_index_;
+
+};
+
+}
@@ -21,6 +21,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <fstream>
 #include <sstream>
 #include "cluster.h"
+#include "clustering_file.h"
 #include "../util/tsv/tsv.h"
 #include "../util/string/tokenizer.h"
 #include "../basic/config.h"
@@ -49,6 +50,8 @@ namespace Cluster {
 
 template<typename Int>
 pair<FlatArray<Int>, vector<Int>> read(const string& file_name, const SequenceFile& db, CentroidSorted) {
+	if (ClusteringFile::is_binary(file_name))
+		return ClusteringFile::read_sorted<Int>(file_name, db);
 	const int64_t lines = Util::Tsv::count_lines(file_name);
 	TextInputFile in(file_name);
 	string centroid, member;
@@ -77,11 +80,12 @@ template pair<FlatArray<int32_t>, vector<int32_t>> read(const string&, const Seq
 template pair<FlatArray<int64_t>, vector<int64_t>> read(const string&, const SequenceFile&, CentroidSorted);
 
 template<typename Int>
-vector<Int> read(const string& file_name, const SequenceFile& db) {
-	const int64_t lines = Util::Tsv::count_lines(file_name);
+vector<Int> read(const string& file_name, const SequenceFile& db, bool allow_incomplete) {
+	if (ClusteringFile::is_binary(file_name))
+		return ClusteringFile::read<Int>(file_name, db, allow_incomplete);
 	TextInputFile in(file_name);
 	string centroid, member;
-	vector<Int> v(db.sequence_count());
+	vector<Int> v(db.sequence_count(), -1);
 	int64_t mappings = 0;
 	if (Blast_tab_format::header_format(::Config::cluster) == Header::SIMPLE) {
 		in.getline();
@@ -98,13 +102,13 @@ vector<Int> read(const string& file_name, const SequenceFile& db) {
 			log_stream << "#Entries: " << mappings << endl;
 	}
 	in.close();
-	if (mappings != db.sequence_count())
+	if (mappings != db.sequence_count() && !(allow_incomplete && mappings < db.sequence_count()))
 		throw runtime_error("Invalid/incomplete clustering.");
 	return v;
 }
 
-template vector<int32_t> read(const string&, const SequenceFile&);
-template vector<int64_t> read(const string&, const SequenceFile&);
+template vector<int32_t> read(const string&, const SequenceFile&, bool);
+template vector<int64_t> read(const string&, const SequenceFile&, bool);
 
 template<typename Int>
 vector<Int> member2centroid_mapping(const FlatArray<Int>& clusters, const vector<Int>& centroids) {
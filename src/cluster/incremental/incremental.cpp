@@ -0,0 +1,107 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2024 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <buchfink@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#include "incremental.h"
+#include "../cascaded/cascaded.h"
+#include "../../basic/config.h"
+#include "../../util/log_stream.h"
+#include "../../data/sequence_file_view.h"
+#include "../clustering_file.h"
+
+using std::endl;
+using std::shared_ptr;
+using std::unique_ptr;
+using std::vector;
+
+namespace Cluster { namespace Incremental {
+
+std::string Algo::get_description() {
+	return "Incremental update of an existing clustering";
+}
+
+// Searches the new sequences against the existing centroids and assigns those that meet the
+// coverage cutoff. Returns the OIds of the sequences that remain unassigned.
+static vector<OId> assign_new_seqs(shared_ptr<SequenceFile>& db, vector<OId>& clustering, const vector<OId>& centroids, const vector<OId>& new_seqs) {
+	vector<OId> unassigned;
+	const int64_t n = assign_to_centroids(db, clustering, centroids, new_seqs, 0, true, &unassigned);
+	message_stream << "Assigned to existing clusters: " << n << '/' << new_seqs.size() << endl;
+	return unassigned;
+}
+
+void Algo::run() {
+	config.database.require();
+	config.clustering.require();
+	init_thresholds();
+	config.hamming_ext = config.approx_min_id >= 50.0;
+	TaskTimer total_time;
+	TaskTimer timer("Opening the database");
+	shared_ptr<SequenceFile> db(SequenceFile::auto_create({ config.database }, SequenceFile::Flags::NEED_LETTER_COUNT | ClusteringFile::accession_flags(config.clustering, true), SequenceFile::Metadata()));
+	if (db->type() == SequenceFile::Type::BLAST)
+		throw std::runtime_error("Clustering is not supported for BLAST databases.");
+	timer.finish();
+	message_stream << "#Database sequences: " << db->sequence_count() << ", #Letters: " << db->letters() << endl;
+	ClusteringOutput out;
+
+	timer.go("Reading the input file");
+	vector<OId> clustering = read<OId>(config.clustering, *db, true);
+
+	timer.go("Finding new sequences");
+	vector<OId> centroids, new_seqs;
+	for (OId i = 0; i < (OId)clustering.size(); ++i)
+		if (clustering[i] == i)
+			centroids.push_back(i);
+		else if (clustering[i] == -1)
+			new_seqs.push_back(i);
+	timer.finish();
+	message_stream << "#Existing clusters: " << centroids.size() << ", #New sequences: " << new_seqs.size() << endl;
+
+	if (!new_seqs.empty()) {
+		const vector<OId> unassigned = centroids.empty() ? new_seqs : assign_new_seqs(db, clustering, centroids, new_seqs);
+		if (!unassigned.empty()) {
+			message_stream << "Clustering unassigned sequences: " << unassigned.size() << endl;
+			timer.go("Creating subdatabase");
+			shared_ptr<SequenceFile> unassigned_db(sub_db_view(db, unassigned.cbegin(), unassigned.cend()));
+			timer.finish();
+			config.db_size = unassigned_db->letters();
+			const vector<SuperBlockId> c = cascaded(unassigned_db, false);
+			timer.go("Updating clustering");
+			int64_t n = 0;
+			for (size_t i = 0; i < unassigned.size(); ++i) {
+				clustering[unassigned[i]] = unassigned[c[i]];
+				if ((size_t)c[i] == i)
+					++n;
+			}
+			unassigned_db->close();
+			timer.finish();
+			message_stream << "New clusters: " << n << endl;
+		}
+	}
+	message_stream << "Total time: " << total_time.seconds() << 's' << endl;
+
+	timer.go("Generating output");
+	if (flag_any(db->format_flags(), SequenceFile::FormatFlags::TITLES_LAZY))
+		db->init_random_access(0, 0, false);
+	out.write(*db, clustering);
+
+	timer.go("Closing the database");
+	db.reset();
+}
+
+}}
@@ -0,0 +1,39 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2024 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <buchfink@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#pragma once
+#include "../cluster.h"
+
+namespace Cluster { namespace Incremental {
+
+// Extends an existing clustering (--clusters) to the sequences of the database that it does not
+// cover. The new sequences are searched against the existing centroids, and those that remain
+// unassigned are clustered among themselves using the cascaded workflow. Existing assignments
+// are not changed.
+struct Algo : public ClusteringAlgorithm {
+	~Algo() {};
+	void run();
+	std::string get_description();
+	static std::string get_key() {
+		return "incremental";
+	}
+};
+
+}}
@@ -64,55 +64,119 @@ struct Cfg {
 	shared_ptr<Block> centroid_block, member_block;
 };
 
-static void align_centroid(CentroidId centroid, ReorderQueue<TextBuffer*, OutputWriter>& out, Statistics& stats, ThreadPool& tp, Cfg& cfg) {
-	DP::Targets dp_targets;
-	const OId centroid_oid = cfg.centroids[centroid];
-	const BlockId centroid_id = cfg.centroid_block->oid2block_id(centroid_oid);
-	const Sequence centroid_seq = cfg.centroid_block->seqs()[centroid_id];
-	auto begin = lower_bound(cfg.clusters.cbegin(centroid), cfg.clusters.cend(centroid), cfg.member_block->oid_begin());
-	auto end = lower_bound(cfg.clusters.cbegin(centroid), cfg.clusters.cend(centroid), cfg.member_block->oid_end());
+// Centroid data shared by all batches that align members of the centroid.
+struct CentroidProfile {
+	CentroidProfile(CentroidId centroid, const Cfg& cfg) :
+		oid(cfg.centroids[centroid]),
+		block_id(cfg.centroid_block->oid2block_id(oid)),
+		seq(cfg.centroid_block->seqs()[block_id]),
+		cbs(seq),
+		seqid(cfg.lazy_titles ? cfg.db.seqid(oid) : cfg.centroid_block->ids()[block_id])
+	{}
+	const OId oid;
+	const BlockId block_id;
+	const Sequence seq;
+	const Bias_correction cbs;
+	const string seqid;
+};
+
+// Unit of work of the realignment. Small clusters are packed into one batch, the members of large
+// clusters are split over several batches. Batches are ordered by centroid.
+struct Batch {
+	struct Segment {
+		CentroidId centroid;
+		vector<OId>::const_iterator begin, end;
+		shared_ptr<const CentroidProfile> profile;
+	};
+	vector<Segment> segments;
+	int64_t cells = 0;
+};
 
-	for (auto it = begin; it != end; ++it) {
+static vector<Batch> make_batches(CentroidId begin, const Cfg& cfg) {
+	const int64_t max_cells = config.swipe_task_size;
+	vector<Batch> batches(1);
+	for (CentroidId i = begin; i < (CentroidId)cfg.centroids.size() && cfg.centroids[i] < cfg.centroid_block->oid_end(); ++i) {
+		auto it = lower_bound(cfg.clusters.cbegin(i), cfg.clusters.cend(i), cfg.member_block->oid_begin());
+		const auto end = lower_bound(cfg.clusters.cbegin(i), cfg.clusters.cend(i), cfg.member_block->oid_end());
+		if (it == end)
+			continue;
+		const int64_t centroid_len = cfg.centroid_block->seqs().length(cfg.centroid_block->oid2block_id(cfg.centroids[i]));
+		int64_t cells = 0;
+		for (auto j = it; j != end; ++j)
+			cells += centroid_len * cfg.member_block->seqs().length(cfg.member_block->oid2block_id(*j));
+		if (cells <= max_cells) {
+			batches.back().segments.push_back({ i, it, end, nullptr });
+			batches.back().cells += cells;
+		}
+		else {
+			shared_ptr<const CentroidProfile> profile(new CentroidProfile(i, cfg));
+			while (it != end) {
+				if (!batches.back().segments.empty())
+					batches.emplace_back();
+				auto j = it;
+				int64_t n = 0;
+				while (j != end && n < max_cells)
+					n += centroid_len * cfg.member_block->seqs().length(cfg.member_block->oid2block_id(*j++));
+				batches.back().segments.push_back({ i, it, j, profile });
+				batches.back().cells = n;
+				it = j;
+			}
+		}
+		if (batches.back().cells >= max_cells)
+			batches.emplace_back();
+	}
+	if (batches.back().segments.empty())
+		batches.pop_back();
+	return batches;
+}
+
+static void align_segment(const Batch::Segment& segment, TypeSerializer<HspContext>& out, Statistics& stats, ThreadPool& tp, Cfg& cfg) {
+	shared_ptr<const CentroidProfile> profile = segment.profile ? segment.profile : std::make_shared<const CentroidProfile>(segment.centroid, cfg);
+	const Sequence& centroid_seq = profile->seq;
+	DP::Targets dp_targets;
+	for (auto it = segment.begin; it != segment.end; ++it) {
 		const BlockId block_id = cfg.member_block->oid2block_id(*it);
 		const Sequence seq(cfg.member_block->seqs()[block_id]);
 		const int bin = DP::BandedSwipe::bin(cfg.hsp_values, centroid_seq.length(), 0, 0, (int64_t)seq.length() * (int64_t)centroid_seq.length(), 0, 0);
 		dp_targets[bin].emplace_back(seq, seq.length(), block_id);
 	}
 
-	const Bias_correction cbs(centroid_seq);
-	const string centroid_seqid = cfg.lazy_titles ? cfg.db.seqid(centroid_oid) : cfg.centroid_block->ids()[centroid_id];
-	DP::Params p{ centroid_seq, centroid_seqid.c_str(), Frame(0), centroid_seq.length(), config.comp_based_stats == 1 ? cbs.int8.data() : nullptr, DP::Flags::FULL_MATRIX, cfg.hsp_values, stats, &tp };
+	DP::Params p{ centroid_seq, profile->seqid.c_str(), Frame(0), centroid_seq.length(), config.comp_based_stats == 1 ? profile->cbs.int8.data() : nullptr, DP::Flags::FULL_MATRIX, cfg.hsp_values, stats, &tp };
 	list<Hsp> hsps = DP::BandedSwipe::swipe(dp_targets, p);
 
-	TextBuffer* buf = new TextBuffer;
-	TypeSerializer<HspContext> s(*buf);
 	for (Hsp& hsp : hsps) {
-		s << HspContext(hsp,
-			centroid_id,
-			centroid_oid,
+		const OId member_oid = cfg.member_block->block_id2oid(hsp.swipe_target);
+		out << HspContext(hsp,
+			profile->block_id,
+			profile->oid,
 			TranslatedSequence(centroid_seq),
-			centroid_seqid.c_str(),
-			cfg.member_block->block_id2oid(hsp.swipe_target),
+			profile->seqid.c_str(),
+			member_oid,
 			cfg.member_block->seqs().length(hsp.swipe_target),
-			cfg.lazy_titles ? cfg.db.seqid(cfg.member_block->block_id2oid(hsp.swipe_target)).c_str() : cfg.member_block->ids()[hsp.swipe_target],
+			cfg.lazy_titles ? cfg.db.seqid(member_oid).c_str() : cfg.member_block->ids()[hsp.swipe_target],
 			0,
 			0,
 			Sequence());
 	}
-	out.push(centroid, buf);
 }
 
 static InputFile* run_block_pair(CentroidId begin, Cfg& cfg) {
-	atomic<CentroidId> next(begin);
+	const vector<Batch> batches = make_batches(begin, cfg);
+	log_stream << "Realignment batches: " << batches.size() << endl;
+	atomic<size_t> next(0);
 	TempFile out;
 	OutputWriter writer{ &out };
-	output_sink.reset(new ReorderQueue<TextBuffer*, OutputWriter>(begin, writer));
+	output_sink.reset(new ReorderQueue<TextBuffer*, OutputWriter>(0, writer));
 	auto worker = [&](ThreadPool& tp) {
-		Statistics stats;
-		CentroidId i = next++;
-		if (i >= (CentroidId)cfg.centroids.size() || cfg.centroids[i] >= cfg.centroid_block->oid_end())
+		const size_t i = next++;
+		if (i >= batches.size())
 			return false;
-		align_centroid(i, *output_sink, stats, tp, cfg);
+		Statistics stats;
+		TextBuffer* buf = new TextBuffer;
+		TypeSerializer<HspContext> s(*buf);
+		for (const Batch::Segment& segment : batches[i].segments)
+			align_segment(segment, s, stats, tp, cfg);
+		output_sink->push(i, buf);
 		statistics += stats;
 		return true;
 	};
@@ -24,6 +24,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../util/log_stream.h"
 #include "../data/sequence_file.h"
 #include "cluster.h"
+#include "clustering_file.h"
 #include "../basic/match.h"
 #include "../output/output_format.h"
 
@@ -58,7 +59,7 @@ void realign() {
 		dynamic_cast<Blast_tab_format*>(output_format.get())->output_header(out, true);
 
 	timer.go("Opening the database");
-	unique_ptr<SequenceFile> db(SequenceFile::auto_create({ config.database }, SequenceFile::Flags::NEED_LETTER_COUNT | SequenceFile::Flags::ACC_TO_OID_MAPPING, SequenceFile::Metadata()));
+	unique_ptr<SequenceFile> db(SequenceFile::auto_create({ config.database }, SequenceFile::Flags::NEED_LETTER_COUNT | ClusteringFile::accession_flags(config.clustering, false), SequenceFile::Metadata()));
 	score_matrix.set_db_letters(config.db_size ? config.db_size : db->letters());
 	config.max_evalue = DBL_MAX;
 	timer.finish();
@@ -0,0 +1,274 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2024 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <buchfink@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#pragma once
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace Workflow { namespace Cluster {
+
+// Sparse matrix in compressed column format. The matrices of the Markov process are column
+// stochastic, so columns are the unit of work of the kernels below (equivalent to the rows of
+// a CSR representation of the transpose).
+struct CscMatrix {
+
+	CscMatrix() :
+		n(0)
+	{}
+
+	int64_t nnz() const {
+		return (int64_t)row.size();
+	}
+
+	int64_t n;
+	std::vector<int64_t> col_ptr;
+	std::vector<uint32_t> row;
+	std::vector<float> value;
+
+	// Builds the matrix from triplets, duplicate entries are summed up. If symmetric is set, the
+	// transposed entries are added for all off-diagonal triplets.
+	template<typename Triplet>
+	static CscMatrix from_triplets(int64_t n, const std::vector<Triplet>& triplets, bool symmetric) {
+		CscMatrix m;
+		m.n = n;
+		m.col_ptr.assign(n + 1, 0);
+		for (const Triplet& t : triplets) {
+			++m.col_ptr[t.col() + 1];
+			if (symmetric && t.row() != t.col())
+				++m.col_ptr[t.row() + 1];
+		}
+		for (int64_t i = 0; i < n; ++i)
+			m.col_ptr[i + 1] += m.col_ptr[i];
+		std::vector<int64_t> pos(m.col_ptr.begin(), m.col_ptr.end() - 1);
+		std::vector<std::pair<uint32_t, float>> entries(m.col_ptr[n]);
+		for (const Triplet& t : triplets) {
+			entries[pos[t.col()]++] = { (uint32_t)t.row(), t.value() };
+			if (symmetric && t.row() != t.col())
+				entries[pos[t.row()]++] = { (uint32_t)t.col(), t.value() };
+		}
+		m.row.reserve(entries.size());
+		m.value.reserve(entries.size());
+		for (int64_t j = 0; j < n; ++j) {
+			auto begin = entries.begin() + m.col_ptr[j], end = entries.begin() + m.col_ptr[j + 1];
+			std::sort(begin, end);
+			m.col_ptr[j] = m.nnz();
+			for (auto it = begin; it < end; ++it)
+				if (m.nnz() > m.col_ptr[j] && m.row.back() == it->first)
+					m.value.back() += it->second;
+				else {
+					m.row.push_back(it->first);
+					m.value.push_back(it->second);
+				}
+		}
+		m.col_ptr[n] = m.nnz();
+		return m;
+	}
+
+};
+
+// Accumulator for one output column of a sparse matrix product. Columns of matrices with up to
+// DENSE_LIMIT rows are accumulated in a dense array, larger ones in an open addressing hash table
+// sized by the upper bound of the column's entry count.
+struct ColumnAccumulator {
+
+	static constexpr int64_t DENSE_LIMIT = 1 << 20;
+	static constexpr uint32_t EMPTY = UINT32_MAX;
+
+	void init(int64_t n) {
+		dense_ = n <= DENSE_LIMIT;
+		if (dense_ && (int64_t)used_.size() < n) {
+			values_.resize(std::max(values_.size(), (size_t)n), 0.0f);
+			used_.resize(n, false);
+		}
+	}
+
+	void reserve(int64_t max_entries) {
+		if (dense_)
+			return;
+		size_t cap = 16;
+		while (cap < (size_t)max_entries * 2)
+			cap *= 2;
+		if (keys_.size() < cap) {
+			keys_.assign(cap, (uint32_t)EMPTY);
+			values_.assign(cap, 0.0f);
+		}
+		mask_ = (uint32_t)keys_.size() - 1;
+	}
+
+	void add(uint32_t row, float v) {
+		if (dense_) {
+			if (!used_[row]) {
+				used_[row] = true;
+				touched_.push_back(row);
+			}
+			values_[row] += v;
+			return;
+		}
+		uint32_t slot = (row * 0x9E3779B1u) & mask_;
+		while (keys_[slot] != row) {
+			if (keys_[slot] == EMPTY) {
+				keys_[slot] = row;
+				touched_.push_back(slot);
+				break;
+			}
+			slot = (slot + 1) & mask_;
+		}
+		values_[slot] += v;
+	}
+
+	// Moves the accumulated entries sorted by row into out and resets the accumulator.
+	void extract(std::vector<std::pair<uint32_t, float>>& out) {
+		out.clear();
+		for (uint32_t i : touched_) {
+			if (dense_) {
+				out.emplace_back(i, values_[i]);
+				values_[i] = 0.0f;
+				used_[i] = false;
+			}
+			else {
+				out.emplace_back(keys_[i], values_[i]);
+				keys_[i] = EMPTY;
+				values_[i] = 0.0f;
+			}
+		}
+		touched_.clear();
+		std::sort(out.begin(), out.end());
+	}
+
+private:
+
+	bool dense_ = true;
+	uint32_t mask_ = 0;
+	std::vector<uint32_t> keys_, touched_;
+	std::vector<float> values_;
+	std::vector<bool> used_;
+
+};
+
+// Buffers of the SpGEMM kernel that are reused across the iterations of the Markov process.
+struct SpGemmWorkspace {
+
+	static constexpr int64_t CHUNK_SIZE = 64;
+
+	struct Thread {
+		ColumnAccumulator acc;
+		std::vector<std::pair<uint32_t, float>> column;
+		std::vector<uint32_t> row;
+		std::vector<float> value;
+		// First column of each processed chunk and its offset in row/value.
+		std::vector<std::pair<int64_t, int64_t>> chunks;
+		double sum;
+	};
+
+	std::vector<Thread> threads;
+
+};
+
+// Computes out = a * b (or out = b if a is nullptr) in parallel over the columns of b. Each
+// output column is passed to finish(j, column, thread) sorted by row before it is stored, which
+// allows pruning, inflation and normalization to be fused into the product. out must not alias
+// a or b. Returns the sum of the Thread::sum fields set by finish.
+template<typename F>
+double spgemm(const CscMatrix* a, const CscMatrix& b, CscMatrix& out, SpGemmWorkspace& ws, uint32_t nThr, F finish) {
+	const int64_t n = b.n;
+	nThr = std::max(nThr, 1u);
+	if (ws.threads.size() < nThr)
+		ws.threads.resize(nThr);
+	out.n = n;
+	out.col_ptr.assign(n + 1, 0);
+	std::atomic<int64_t> next(0);
+
+	auto worker = [&](uint32_t thread_id) {
+		SpGemmWorkspace::Thread& t = ws.threads[thread_id];
+		t.row.clear();
+		t.value.clear();
+		t.chunks.clear();
+		t.sum = 0.0;
+		t.acc.init(a ? a->n : n);
+		int64_t begin;
+		while ((begin = next.fetch_add(SpGemmWorkspace::CHUNK_SIZE, std::memory_order_relaxed)) < n) {
+			t.chunks.emplace_back(begin, (int64_t)t.row.size());
+			const int64_t end = std::min(begin + SpGemmWorkspace::CHUNK_SIZE, n);
+			for (int64_t j = begin; j < end; ++j) {
+				if (a) {
+					int64_t bound = 0;
+					for (int64_t p = b.col_ptr[j]; p < b.col_ptr[j + 1]; ++p)
+						bound += a->col_ptr[b.row[p] + 1] - a->col_ptr[b.row[p]];
+					t.acc.reserve(std::min(bound, a->n));
+					for (int64_t p = b.col_ptr[j]; p < b.col_ptr[j + 1]; ++p) {
+						const uint32_t k = b.row[p];
+						const float y = b.value[p];
+						for (int64_t q = a->col_ptr[k]; q < a->col_ptr[k + 1]; ++q)
+							t.acc.add(a->row[q], a->value[q] * y);
+					}
+					t.acc.extract(t.column);
+				}
+				else {
+					t.column.clear();
+					for (int64_t p = b.col_ptr[j]; p < b.col_ptr[j + 1]; ++p)
+						t.column.emplace_back(b.row[p], b.value[p]);
+				}
+				finish(j, t.column, t);
+				out.col_ptr[j + 1] = (int64_t)t.column.size();
+				for (const auto& e : t.column) {
+					t.row.push_back(e.first);
+					t.value.push_back(e.second);
+				}
+			}
+		}
+	};
+
+	auto run = [nThr](const std::function<void(uint32_t)>& f) {
+		if (nThr == 1) {
+			f(0);
+			return;
+		}
+		std::vector<std::thread> threads;
+		for (uint32_t i = 0; i < nThr; ++i)
+			threads.emplace_back(f, i);
+		for (auto& t : threads)
+			t.join();
+	};
+
+	run(worker);
+	for (int64_t j = 0; j < n; ++j)
+		out.col_ptr[j + 1] += out.col_ptr[j];
+	out.row.resize(out.col_ptr[n]);
+	out.value.resize(out.col_ptr[n]);
+	run([&](uint32_t thread_id) {
+		const SpGemmWorkspace::Thread& t = ws.threads[thread_id];
+		for (const auto& c : t.chunks) {
+			const int64_t end = std::min(c.first + SpGemmWorkspace::CHUNK_SIZE, n), count = out.col_ptr[end] - out.col_ptr[c.first];
+			std::copy(t.row.begin() + c.second, t.row.begin() + c.second + count, out.row.begin() + out.col_ptr[c.first]);
+			std::copy(t.value.begin() + c.second, t.value.begin() + c.second + count, out.value.begin() + out.col_ptr[c.first]);
+		}
+	});
+	double sum = 0.0;
+	for (uint32_t i = 0; i < nThr; ++i)
+		sum += ws.threads[i].sum;
+	return sum;
+}
+
+}}
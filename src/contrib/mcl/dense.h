@@ -49,31 +49,6 @@ void MCL::get_exp(Eigen::MatrixXf* in, Eigen::MatrixXf* out, float r){
 	}
 }
 
-void MCL::get_gamma(Eigen::SparseMatrix<float>* in, Eigen::SparseMatrix<float>* out, float r, uint32_t nThr) {
-	high_resolution_clock::time_point t = high_resolution_clock::now();
-	vector<Eigen::Triplet<float>> data;
-	std::mutex m;
-	auto mult = [&](const uint32_t iThr) {
-		vector<Eigen::Triplet<float>> t_data = sparse_matrix_get_gamma(in, r, iThr, nThr);
-		m.lock();
-		data.insert(data.end(), t_data.begin(), t_data.end());
-		m.unlock();
-	};
-
-	vector<thread> threads;
-	for (uint32_t iThread = 0; iThread < nThr; iThread++) {
-		threads.emplace_back(mult, iThread);
-	}
-
-	for (uint32_t iThread = 0; iThread < nThr; iThread++) {
-		threads[iThread].join();
-	}
-	out->setZero();
-	out->setFromTriplets(data.begin(), data.end(), [](const float&, const float &b) { return b; });
-	*out = out->pruned(1.0, numeric_limits<float>::epsilon());
-	sparse_gamma_time += duration_cast<milliseconds>(high_resolution_clock::now() - t).count();
-}
-
 void MCL::get_gamma(Eigen::MatrixXf* in, Eigen::MatrixXf* out, float r) {
 	high_resolution_clock::time_point t = high_resolution_clock::now();
 	// Note that Eigen matrices are column-major, so this is the most efficient way
@@ -22,10 +22,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <numeric>
 #include <iomanip>
 #include <thread>
+#include <iostream>
+#include <fstream>
 #include "mcl.h"
 #include "sparse_matrix_stream.h"
-#include "../util/util.h"
-#include "../util/sequence/sequence.h"
+#include "../../util/util.h"
+#include "../../util/sequence/sequence.h"
 
 #define MASK_INVERSE        0xC000000000000000
 #define MASK_NORMAL_NODE    0x4000000000000000
@@ -63,7 +65,7 @@ string MCL::get_description() {
 }
 
 void MCL::print_stats(int64_t nElements, int64_t nComponents, int64_t nComponentsLt1, vector<int64_t>& sort_order, vector<vector<int64_t>>& indices, SparseMatrixStream<float>* ms){
-	task_timer timer;
+	TaskTimer timer;
 	timer.go("Collecting stats");
 	const uint32_t chunk_size = config.cluster_mcl_chunk_size;
 	const int nThreads = min(config.threads_, int(nComponents / chunk_size));
@@ -180,7 +182,7 @@ void MCL::print_stats(int64_t nElements, int64_t nComponents, int64_t nComponent
 shared_ptr<SparseMatrixStream<float>> get_graph_handle(shared_ptr<SequenceFile>& db){
 	const bool symmetric = !config.cluster_mcl_nonsymmetric;
 	if(config.cluster_restart){
-		task_timer timer;
+		TaskTimer timer;
 		timer.go("Reading cluster checkpoint file");
 		shared_ptr<SparseMatrixStream<float>> ms(SparseMatrixStream<float>::fromFile(symmetric, config.cluster_graph_file, (float)config.chunk_size));
 		timer.finish();
@@ -210,19 +212,10 @@ shared_ptr<SparseMatrixStream<float>> get_graph_handle(shared_ptr<SequenceFile>&
 	return ms;
 }
 
-Eigen::SparseMatrix<float> MCL::get_sparse_matrix_and_clear(vector<int64_t>* order, vector<Eigen::Triplet<float>>* m, bool symmetric){
-	Eigen::SparseMatrix<float> m_sparse(order->size(), order->size());
-	if(symmetric){
-		uint64_t oSize = m->size();
-		for(uint64_t i = 0; i<oSize; i++){
-			Eigen::Triplet<float>& t = m->at(i);
-			if(t.col() != t.row()){ 
-				m->emplace_back(t.col(), t.row(), t.value());
-			}
-		}
-	}
-	m_sparse.setFromTriplets(m->begin(), m->end());
+CscMatrix MCL::get_sparse_matrix_and_clear(vector<int64_t>* order, vector<Eigen::Triplet<float>>* m, bool symmetric){
+	CscMatrix m_sparse = CscMatrix::from_triplets(order->size(), *m, symmetric);
 	m->clear();
+	m->shrink_to_fit();
 	return m_sparse;
 }
 Eigen::MatrixXf MCL::get_dense_matrix_and_clear(vector<int64_t>* order, vector<Eigen::Triplet<float>>* m, bool symmetric){
@@ -364,7 +357,7 @@ void MCL::run(){
 	shared_ptr<SequenceFile> db(SequenceFile::auto_create({ config.database }));
 	statistics.reset();
 	shared_ptr<SparseMatrixStream<float>> ms(get_graph_handle(db));
-	task_timer timer;
+	TaskTimer timer;
 	timer.go("Computing independent components");
 	vector<vector<int64_t>> indices = ms->get_indices();
 	ms->clear_disjoint_set();
@@ -444,7 +437,7 @@ void MCL::run(){
 					//TODO: a size limit for the dense matrix should control this as well
 					if(sparsity >= config.cluster_mcl_sparsity_switch && expansion - (int) expansion == 0){ 
 						n_sparse++;
-						Eigen::SparseMatrix<float> m_sparse = get_sparse_matrix_and_clear(order, m, symmetric);
+						CscMatrix m_sparse = get_sparse_matrix_and_clear(order, m, symmetric);
 						sparse_create_time += duration_cast<milliseconds>(high_resolution_clock::now() - t).count();
 						auto getThreads = [&threads_done, &nThreads, &exessThreads, &iThr](){
 							uint32_t td=threads_done.load();
@@ -453,13 +446,13 @@ void MCL::run(){
 						};
 						markov_process(&m_sparse, inflation, expansion, max_iter, getThreads);
 						high_resolution_clock::time_point t = high_resolution_clock::now();
-						LazyDisjointIntegralSet<uint32_t> disjointSet(m_sparse.cols());
-						for (uint32_t k=0; k<m_sparse.outerSize(); ++k){
-							for (Eigen::SparseMatrix<float>::InnerIterator it(m_sparse, k); it; ++it){
-								assert(abs(it.value()) > numeric_limits<float>::epsilon());
-								disjointSet.merge(it.row(), it.col());
-								if(it.row() == it.col()){
-									attractors.emplace(it.row());
+						LazyDisjointIntegralSet<uint32_t> disjointSet(m_sparse.n);
+						for (uint32_t k=0; k<m_sparse.n; ++k){
+							for (int64_t p=m_sparse.col_ptr[k]; p<m_sparse.col_ptr[k+1]; ++p){
+								assert(abs(m_sparse.value[p]) > numeric_limits<float>::epsilon());
+								disjointSet.merge(m_sparse.row[p], k);
+								if(m_sparse.row[p] == k){
+									attractors.emplace(k);
 								}
 							}
 						}
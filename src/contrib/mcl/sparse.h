@@ -22,127 +22,83 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 using std::runtime_error;
 
 namespace Workflow { namespace Cluster{
-		
-vector<Eigen::Triplet<float>> MCL::sparse_matrix_multiply(Eigen::SparseMatrix<float>* a, Eigen::SparseMatrix<float>* b , uint32_t iThr, uint32_t nThr){
-	int64_t n_cols = b->cols();
-	int64_t n_rows = a->rows();
-	std::vector<float> result_col(n_rows, 0.0);
-	vector<Eigen::Triplet<float>> data;
-	for (uint32_t j=0; j<n_cols; ++j) {
-		if(j%nThr == iThr){
-			fill(result_col.begin(), result_col.end(), 0.0f);
-			for (Eigen::SparseMatrix<float>::InnerIterator  rhsIt(*b, j); rhsIt; ++rhsIt) {
-				const float y = rhsIt.value();
-				const int64_t k = rhsIt.row();
-				for (Eigen::SparseMatrix<float>::InnerIterator lhsIt(*a, k); lhsIt; ++lhsIt) {
-					const int64_t i = lhsIt.row();
-					const float x = lhsIt.value();
-					result_col[i] += x*y;
-				}
-			}
-			for (int64_t i=0; i<n_rows; ++i) {
-				if(abs(result_col[i]) > numeric_limits<float>::epsilon()) {
-					data.emplace_back(i, j, result_col[i]);
-				}
-			}
-		}
-	}
-	return data;
-}
-
-void MCL::get_exp(Eigen::SparseMatrix<float>* in, Eigen::SparseMatrix<float>* out, float r, uint32_t nThr){
-	high_resolution_clock::time_point t = high_resolution_clock::now();
-	if( r - (int) r == 0 ){
-		// TODO: at some r it may be more beneficial to diagnoalize in and only take the exponents of the eigenvalues
-		*out = *in;
-		for(uint32_t i=1; i<r; i++){ 
-			// Note: this is a workaround for a crash in Eigen
-			vector<Eigen::Triplet<float>> data;
-			std::mutex m;
-			auto mult = [&](const uint32_t iThr){
-				vector<Eigen::Triplet<float>> t_data = sparse_matrix_multiply(in, out, iThr, nThr);
-				m.lock();
-				data.insert(data.end(), t_data.begin(), t_data.end());
-				m.unlock();
-			};
 
-			vector<thread> threads;
-			for(uint32_t iThread = 0; iThread < nThr ; iThread++) {
-				threads.emplace_back(mult, iThread);
-			}
-
-			for(uint32_t iThread = 0; iThread < nThr ; iThread++) {
-				threads[iThread].join();
-			}
-			out->setZero();
-			out->setFromTriplets(data.begin(), data.end(), [] (const float&, const float &b) { return b; });
-			*out = out->pruned(1.0, numeric_limits<float>::epsilon());
-			//(*out) = (*out)*(*in);
+// Sum of squared differences between column j of m and the sorted column c.
+static double column_diff(const CscMatrix& m, int64_t j, const vector<std::pair<uint32_t, float>>& c) {
+	double d = 0.0;
+	int64_t p = m.col_ptr[j];
+	const int64_t end = m.col_ptr[j + 1];
+	auto it = c.begin();
+	while (p < end || it != c.end()) {
+		if (it == c.end() || (p < end && m.row[p] < it->first)) {
+			d += (double)m.value[p] * m.value[p];
+			++p;
 		}
-	}
-	else{ 
-		throw runtime_error("Eigen does not provide an eigenvalue solver for sparse matrices");
-	}
-	*out = out->pruned();
-	sparse_exp_time += duration_cast<milliseconds>(high_resolution_clock::now() - t).count();
-}
-
-vector<Eigen::Triplet<float>> MCL::sparse_matrix_get_gamma(Eigen::SparseMatrix<float>* in, float r, uint32_t iThr, uint32_t nThr) {
-	vector<Eigen::Triplet<float>> data;
-	for (uint32_t k = 0; k < in->outerSize(); ++k) {
-		if (k%nThr == iThr) {
-			float colSum = 0.0f;
-			for (Eigen::SparseMatrix<float>::InnerIterator it(*in, k); it; ++it) {
-				colSum += pow(it.value(), r);
-			}
-			for (Eigen::SparseMatrix<float>::InnerIterator it(*in, k); it; ++it) {
-				float val = pow(it.value(), r) / colSum;
-				if (abs(val) > numeric_limits<float>::epsilon()) {
-					data.emplace_back(it.row(), it.col(), val);
-				}
-			}
+		else if (p == end || it->first < m.row[p]) {
+			d += (double)it->second * it->second;
+			++it;
+		}
+		else {
+			const double x = m.value[p] - it->second;
+			d += x * x;
+			++p;
+			++it;
 		}
 	}
-	return data;
+	return d;
 }
 
-float MCL::sparse_matrix_get_norm(Eigen::SparseMatrix<float>* in, uint32_t nThr) {
-	vector<float> data(nThr);
-	fill(data.begin(), data.end(), 0.0);
-	auto norm = [&](const uint32_t iThr) {
-		for (uint32_t k = 0; k < in->outerSize(); ++k) {
-			if (k%nThr == iThr) {
-				for (Eigen::SparseMatrix<float>::InnerIterator it(*in, k); it; ++it) {
-					data[iThr] += pow(it.value(), 2.0f);
-				}
-			}
-		}
-	};
-
-	vector<thread> threads;
-	for (uint32_t iThread = 0; iThread < nThr; iThread++) {
-		threads.emplace_back(norm, iThread);
+// Raises the entries of the column to the power r, normalizes the column and prunes entries
+// that fall below epsilon.
+static void inflate_column(vector<std::pair<uint32_t, float>>& c, float r) {
+	float sum = 0.0f;
+	for (auto& e : c) {
+		e.second = r == 1.0f ? e.second : std::pow(e.second, r);
+		sum += e.second;
 	}
-
-	for (uint32_t iThread = 0; iThread < nThr; iThread++) {
-		threads[iThread].join();
+	size_t k = 0;
+	for (const auto& e : c) {
+		const float v = e.second / sum;
+		if (std::abs(v) > numeric_limits<float>::epsilon())
+			c[k++] = { e.first, v };
 	}
-	return pow(accumulate(data.begin(), data.end(), 0.0f), 0.5f);
+	c.resize(k);
+}
+
+static void prune_column(vector<std::pair<uint32_t, float>>& c) {
+	c.erase(std::remove_if(c.begin(), c.end(), [](const std::pair<uint32_t, float>& e) { return std::abs(e.second) <= numeric_limits<float>::epsilon(); }), c.end());
 }
 
-void MCL::markov_process(Eigen::SparseMatrix<float>* m, float inflation, float expansion, uint32_t max_iter, function<uint32_t()> getThreads) {
+void MCL::markov_process(CscMatrix* m, float inflation, float expansion, uint32_t max_iter, function<uint32_t()> getThreads) {
+	if (expansion - (int)expansion != 0)
+		throw runtime_error("Sparse MCL requires an integer expansion coefficient.");
+	const int n_mult = std::max((int)expansion - 1, 0);
 	uint32_t iteration = 0;
 	float diff_norm = numeric_limits<float>::max();
-	Eigen::SparseMatrix<float> msquared(m->rows(), m->cols());
-	Eigen::SparseMatrix<float> m_update(m->rows(), m->cols());
-	get_gamma(m, m, 1, getThreads()); // This is to get a matrix of random walks on the graph -> TODO: find out if something else is more suitable
+	SpGemmWorkspace ws;
+	CscMatrix tmp[2], m_update;
+	// This is to get a matrix of random walks on the graph -> TODO: find out if something else is more suitable
+	spgemm(nullptr, *m, m_update, ws, getThreads(), [](int64_t, vector<std::pair<uint32_t, float>>& c, SpGemmWorkspace::Thread&) { inflate_column(c, 1.0f); });
+	std::swap(*m, m_update);
 	while (iteration < max_iter && diff_norm > numeric_limits<float>::epsilon()) {
-		get_exp(m, &msquared, expansion, getThreads());
-		get_gamma(&msquared, &m_update, inflation, getThreads());
-		*m -= m_update;
-		diff_norm = sparse_matrix_get_norm(m, getThreads());
-		*m = m_update;
+		high_resolution_clock::time_point t = high_resolution_clock::now();
+		const uint32_t nThr = getThreads();
+		// Expansion: the last multiplication is fused with inflation, normalization and the
+		// difference to the previous iterate.
+		const CscMatrix* power = m;
+		for (int i = 0; i < n_mult - 1; ++i) {
+			spgemm(m, *power, tmp[i % 2], ws, nThr, [](int64_t, vector<std::pair<uint32_t, float>>& c, SpGemmWorkspace::Thread&) { prune_column(c); });
+			power = &tmp[i % 2];
+		}
+		const double diff = spgemm(n_mult > 0 ? m : nullptr, *power, m_update, ws, nThr, [m, inflation](int64_t j, vector<std::pair<uint32_t, float>>& c, SpGemmWorkspace::Thread& thread) {
+			prune_column(c);
+			inflate_column(c, inflation);
+			thread.sum += column_diff(*m, j, c);
+		});
+		diff_norm = (float)std::sqrt(diff);
+		std::swap(*m, m_update);
 		iteration++;
+		sparse_exp_time += duration_cast<milliseconds>(high_resolution_clock::now() - t).count();
 	}
 	if (iteration == max_iter) {
 		failed_to_converge++;
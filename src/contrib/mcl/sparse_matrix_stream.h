@@ -27,7 +27,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <fstream>
 // #include <iostream>
 #include "../../util/data_structures/lazy_disjoint_set.h"
-#include "../util/io/consumer.h"
+#include "../../util/io/consumer.h"
 #include "../../cluster/cluster.h"
 
 using std::vector;
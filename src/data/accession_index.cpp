@@ -0,0 +1,140 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2024 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <buchfink@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#define NOMINMAX
+#include "../lib/mio/mmap.hpp"
+#include <algorithm>
+#include <limits>
+#include "accession_index.h"
+#include "sequence_file.h"
+#include "../util/algo/MurmurHash3.h"
+#include "../util/algo/external_sort.h"
+#include "../util/io/output_file.h"
+#include "../util/io/input_file.h"
+#include "../util/sequence/sequence.h"
+#include "../util/log_stream.h"
+
+using std::vector;
+using std::string;
+using std::pair;
+using std::runtime_error;
+
+const char* AccessionIndex::FILE_EXTENSION = ".acc_idx";
+const uint64_t AccessionIndex::MAGIC_NUMBER = 0x5fc0b5e1d2a94c37llu;
+const uint32_t AccessionIndex::VERSION = 0;
+const int AccessionIndex::DIRECTORY_BITS = 16;
+// magic number, version, padding, entry count, database hash
+const size_t AccessionIndex::HEADER_SIZE = 8 + 4 + 4 + 8 + 16;
+
+static const char FINGERPRINT_SEED[16] = { 0 };
+
+uint64_t AccessionIndex::fingerprint(const string& acc) {
+	uint64_t h[2];
+	MurmurHash3_x64_128(acc.data(), (int)acc.length(), FINGERPRINT_SEED, h);
+	return h[0];
+}
+
+string AccessionIndex::file_name(const string& db_file) {
+	return db_file + FILE_EXTENSION;
+}
+
+AccessionIndex::AccessionIndex(const string& file_name):
+	mmap_(new mio::mmap_source(file_name))
+{
+	const size_t directory_size = ((size_t)1 << DIRECTORY_BITS) + 1;
+	if (mmap_->length() < HEADER_SIZE + directory_size * sizeof(uint64_t))
+		throw runtime_error("Invalid accession index file.");
+	const char* buf = mmap_->data();
+	if (*(const uint64_t*)buf != MAGIC_NUMBER)
+		throw runtime_error("Invalid accession index file.");
+	if (*(const uint32_t*)(buf + 8) != VERSION)
+		throw runtime_error("Invalid accession index file version.");
+	count_ = *(const int64_t*)(buf + 16);
+	db_hash_ = buf + 24;
+	directory_ = (const uint64_t*)(buf + HEADER_SIZE);
+	fingerprints_ = directory_ + directory_size;
+	oids_ = (const uint32_t*)(fingerprints_ + count_);
+	if (mmap_->length() != HEADER_SIZE + directory_size * sizeof(uint64_t) + count_ * (sizeof(uint64_t) + sizeof(uint32_t)))
+		throw runtime_error("Accession index file is truncated.");
+}
+
+AccessionIndex::~AccessionIndex() {
+}
+
+vector<OId> AccessionIndex::find(const string& acc) const {
+	const uint64_t f = fingerprint(acc);
+	const uint64_t b = f >> (64 - DIRECTORY_BITS);
+	const uint64_t* begin = fingerprints_ + directory_[b], * end = fingerprints_ + directory_[b + 1];
+	const auto r = std::equal_range(begin, end, f);
+	vector<OId> oids;
+	oids.reserve(r.second - r.first);
+	for (const uint64_t* i = r.first; i < r.second; ++i)
+		oids.push_back(oids_[i - fingerprints_]);
+	return oids;
+}
+
+void AccessionIndex::build(SequenceFile& db, const char* db_hash, const string& file_name) {
+	if (db.sequence_count() > (int64_t)std::numeric_limits<uint32_t>::max())
+		throw runtime_error("Accession index is not supported for databases of more than 2^32 sequences.");
+	TaskTimer timer("Reading accessions");
+	ExternalSorter<pair<uint64_t, uint32_t>> sorter;
+	vector<Letter> seq;
+	string id;
+	db.set_seqinfo_ptr(0);
+	db.init_seq_access();
+	for (OId i = 0; i < db.sequence_count(); ++i) {
+		db.read_seq(seq, id);
+		sorter.push({ fingerprint(Util::Seq::seqid(id.c_str(), false)), (uint32_t)i });
+	}
+
+	timer.go("Writing accession index");
+	const size_t directory_size = ((size_t)1 << DIRECTORY_BITS) + 1;
+	vector<uint64_t> directory(directory_size, 0);
+	OutputFile out(file_name);
+	TempFile oid_file;
+	out.write(MAGIC_NUMBER);
+	out.write(VERSION);
+	out.write((uint32_t)0);
+	out.write((int64_t)sorter.count());
+	out.write(db_hash, 16);
+	out.write(directory.data(), directory_size);
+	sorter.init_read();
+	while (sorter.good()) {
+		++directory[((*sorter).first >> (64 - DIRECTORY_BITS)) + 1];
+		out.write((*sorter).first);
+		oid_file.write((*sorter).second);
+		++sorter;
+	}
+	for (size_t i = 1; i < directory_size; ++i)
+		directory[i] += directory[i - 1];
+
+	InputFile oid_in(oid_file);
+	vector<uint32_t> buf(MEGABYTES);
+	size_t n;
+	while ((n = oid_in.read(buf.data(), buf.size())) > 0)
+		out.write(buf.data(), n);
+	oid_in.close_and_delete();
+
+	out.seek(HEADER_SIZE);
+	out.write(directory.data(), directory_size);
+	out.close();
+	timer.finish();
+	message_stream << "Accession index entries: " << sorter.count() << std::endl;
+}
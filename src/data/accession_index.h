@@ -0,0 +1,69 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2024 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <buchfink@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#pragma once
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../basic/value.h"
+#include "../lib/mio/forward.h"
+
+struct SequenceFile;
+
+// Persistent accession -> OId lookup table stored in a sidecar file next to the database.
+// Accessions are stored as sorted 64 bit fingerprints with a parallel array of 32 bit OIds
+// and a radix directory over the high fingerprint bits. The file is accessed through mmap
+// so that lookups do not require building an in-memory hash table. find() returns all OIds
+// with a matching fingerprint, which the caller has to verify against the sequence titles.
+
+struct AccessionIndex {
+
+	AccessionIndex(const std::string& file_name);
+	~AccessionIndex();
+
+	std::vector<OId> find(const std::string& acc) const;
+	int64_t size() const {
+		return count_;
+	}
+	const char* db_hash() const {
+		return db_hash_;
+	}
+
+	static uint64_t fingerprint(const std::string& acc);
+	static std::string file_name(const std::string& db_file);
+	static void build(SequenceFile& db, const char* db_hash, const std::string& file_name);
+
+	static const char* FILE_EXTENSION;
+	static const uint64_t MAGIC_NUMBER;
+	static const uint32_t VERSION;
+	static const int DIRECTORY_BITS;
+	static const size_t HEADER_SIZE;
+
+private:
+
+	std::unique_ptr<mio::mmap_source> mmap_;
+	int64_t count_;
+	const char* db_hash_;
+	const uint64_t* directory_;
+	const uint64_t* fingerprints_;
+	const uint32_t* oids_;
+
+};
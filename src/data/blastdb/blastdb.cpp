@@ -18,6 +18,11 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ****/
 
+#define NOMINMAX
+#include "../../lib/mio/mmap.hpp"
+#include <thread>
+#include <cstdio>
+#include <string.h>
 #include <objmgr/object_manager.hpp>
 #include <objmgr/scope.hpp>
 #include <objmgr/util/create_defline.hpp>
@@ -30,10 +35,13 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../../util/system/system.h"
 #include "../basic/config.h"
 #include "../../util/util.h"
+#include "../../util/algo/MurmurHash3.h"
+#include "../../util/io/output_file.h"
 
 using std::cout;
 using std::endl;
 using std::vector;
+using std::unique_ptr;
 using namespace ncbi;
 
 static string full_id(CBioseq& bioseq, CBioseq_Handle* bioseq_handle, bool long_ids, bool ctrl_a) {
@@ -94,7 +102,9 @@ BlastDB::BlastDB(const std::string& file_name, Metadata metadata, Flags flags, c
 	long_seqids_(false),
 	flags_(flags),
 	sequence_count_(db_->GetNumOIDs()),
-	sparse_sequence_count_(db_->GetNumSeqs())
+	sparse_sequence_count_(db_->GetNumSeqs()),
+	cache_offsets_(nullptr),
+	cache_data_(nullptr)
 {
 #ifndef EXTRA
 	if (flag_any(metadata, Metadata::TAXON_NODES | Metadata::TAXON_MAPPING | Metadata::TAXON_SCIENTIFIC_NAMES | Metadata::TAXON_RANKS))
@@ -119,6 +129,16 @@ BlastDB::BlastDB(const std::string& file_name, Metadata metadata, Flags flags, c
 			throw std::runtime_error("Taxonomy nodes file (nodes.dmp) was not found in the BLAST database directory.");
 		}
 	}
+
+	if (!config.blastdb_cache.empty()) {
+		const string cache_file = config.blastdb_cache + dir_separator + file_name.substr(file_name.find_last_of("/\\") + 1) + CACHE_EXTENSION;
+		// The cache is only built if there is no valid one, a stale or damaged cache is replaced.
+		if (!open_cache(cache_file)) {
+			build_cache(cache_file);
+			if (!open_cache(cache_file))
+				throw std::runtime_error("Error opening sequence cache: " + cache_file);
+		}
+	}
 }
 
 int64_t BlastDB::file_count() const {
@@ -132,6 +152,7 @@ void BlastDB::init_seqinfo_access()
 void BlastDB::init_seq_access()
 {
 	oid_ = 0;
+	pending_oids_.clear();
 }
 
 void BlastDB::seek_chunk(const Chunk& chunk)
@@ -182,11 +203,50 @@ void BlastDB::read_seq_data(Letter* dst, size_t len, size_t& pos, bool seek)
 {
 	*(dst - 1) = Sequence::DELIMITER;
 	*(dst + len) = Sequence::DELIMITER;
-	const char* buf;
-	const int db_len = db_->GetSequence((int)pos, &buf);
-	std::copy(buf, buf + len, dst);
+	if (cache_)
+		std::copy(cache_data_ + cache_offsets_[pos], cache_data_ + cache_offsets_[pos] + len, dst);
+	else
+		pending_oids_.push_back((BlastOid)pos);
 	++pos;
-	db_->RetSequence(&buf);
+}
+
+void BlastDB::decode_seq_data(SequenceSet& seqs)
+{
+	if (pending_oids_.empty())
+		return;
+	// Taken over first so that a failed load does not leave OIds behind for the next block.
+	vector<BlastOid> oids;
+	oids.swap(pending_oids_);
+	if ((BlockId)oids.size() != seqs.size())
+		throw std::runtime_error("Inconsistent sequence count in BLAST database block.");
+	vector<Letter*> dst;
+	dst.reserve(seqs.size());
+	for (BlockId i = 0; i < seqs.size(); ++i)
+		dst.push_back(seqs.ptr(i));
+	load_parallel(oids, dst);
+}
+
+void BlastDB::load_parallel(const vector<BlastOid>& oids, const vector<Letter*>& dst)
+{
+	static const size_t MIN_SEQS_PER_THREAD = 1024;
+	const size_t n = oids.size();
+	const size_t threads = std::max(std::min((size_t)config.threads_, n / MIN_SEQS_PER_THREAD), (size_t)1);
+	while (handles_.size() < threads)
+		handles_.emplace_back(new CSeqDBExpert(file_name_, CSeqDB::eProtein));
+	auto worker = [this, &oids, &dst, n, threads](size_t thread_id) {
+		CSeqDBExpert& db = *handles_[thread_id];
+		const char* buf;
+		for (size_t i = n * thread_id / threads; i < n * (thread_id + 1) / threads; ++i) {
+			const int len = db.GetSequence(oids[i], &buf);
+			std::copy(buf, buf + len, dst[i]);
+			db.RetSequence(&buf);
+		}
+	};
+	vector<std::thread> t;
+	for (size_t i = 0; i < threads; ++i)
+		t.emplace_back(worker, i);
+	for (auto& i : t)
+		i.join();
 }
 
 void BlastDB::read_id_data(const int64_t oid, char* dst, size_t len)
@@ -313,6 +373,7 @@ int BlastDB::get_n_partition_chunks()
 void BlastDB::set_seqinfo_ptr(int64_t i)
 {
 	oid_ = (int)i;
+	pending_oids_.clear();
 }
 
 void BlastDB::close()
@@ -322,6 +383,7 @@ void BlastDB::close()
 void BlastDB::close_weakly()
 {
 	db_.reset();
+	handles_.clear();
 }
 
 void BlastDB::reopen()
@@ -383,6 +445,10 @@ string BlastDB::taxon_scientific_name(TaxId taxid) const {
 
 void BlastDB::seq_data(size_t oid, std::vector<Letter>& dst) const
 {
+	if (cache_) {
+		dst.assign(cache_data_ + cache_offsets_[oid], cache_data_ + cache_offsets_[oid + 1]);
+		return;
+	}
 	const char* buf;
 	const int db_len = db_->GetSequence((int)oid, &buf);
 	dst.clear();
@@ -397,6 +463,90 @@ size_t BlastDB::seq_length(size_t oid) const
 }
 
 const char* BlastDB::ACCESSION_FIELD = "#accession*";
+const char* BlastDB::CACHE_EXTENSION = ".seq_cache";
+const uint64_t BlastDB::CACHE_MAGIC_NUMBER = 0x7b0c29e5a1f4d863llu;
+const uint32_t BlastDB::CACHE_VERSION = 0;
+// magic number, version, padding, sequence count, letters, database hash
+const size_t BlastDB::CACHE_HEADER_SIZE = 8 + 4 + 4 + 8 + 8 + 16;
+
+void BlastDB::cache_hash(char* hash) const
+{
+	static const char SEED[16] = { 0 };
+	// The database is identified by its name without the directory, so that the cache stays valid when the same
+	// database is given by a different path.
+	const string key = file_name_.substr(file_name_.find_last_of("/\\") + 1) + '\t' + db_->GetDate() + '\t' + std::to_string(sequence_count_) + '\t' + std::to_string(db_->GetTotalLength());
+	MurmurHash3_x64_128(key.data(), (int)key.length(), SEED, hash);
+}
+
+bool BlastDB::open_cache(const string& file_name)
+{
+	if (!exists(file_name))
+		return false;
+	unique_ptr<mio::mmap_source> cache(new mio::mmap_source(file_name));
+	char hash[16];
+	cache_hash(hash);
+	const char* buf = cache->data();
+	if (cache->length() < CACHE_HEADER_SIZE
+		|| *(const uint64_t*)buf != CACHE_MAGIC_NUMBER
+		|| *(const uint32_t*)(buf + 8) != CACHE_VERSION
+		|| *(const int64_t*)(buf + 16) != sequence_count_
+		|| memcmp(buf + 32, hash, sizeof(hash)) != 0) {
+		message_stream << "Sequence cache does not match the database and will be rebuilt: " << file_name << endl;
+		return false;
+	}
+	const uint64_t letters = *(const uint64_t*)(buf + 24);
+	if (cache->length() != CACHE_HEADER_SIZE + (sequence_count_ + 1) * sizeof(uint64_t) + letters) {
+		message_stream << "Sequence cache is truncated and will be rebuilt: " << file_name << endl;
+		return false;
+	}
+	cache_offsets_ = (const uint64_t*)(buf + CACHE_HEADER_SIZE);
+	cache_data_ = (const char*)(cache_offsets_ + sequence_count_ + 1);
+	cache_ = std::move(cache);
+	return true;
+}
+
+void BlastDB::build_cache(const string& file_name)
+{
+	static const size_t CHUNK_SIZE = 1 << 20;
+	TaskTimer timer("Building sequence cache");
+	vector<uint64_t> offsets;
+	offsets.reserve(sequence_count_ + 1);
+	offsets.push_back(0);
+	for (BlastOid i = 0; i < (BlastOid)sequence_count_; ++i)
+		offsets.push_back(offsets.back() + db_->GetSeqLength(i));
+	char hash[16];
+	cache_hash(hash);
+	const string tmp_name = file_name + ".tmp";
+	OutputFile out(tmp_name);
+	out.write(CACHE_MAGIC_NUMBER);
+	out.write(CACHE_VERSION);
+	out.write((uint32_t)0);
+	out.write(sequence_count_);
+	out.write(offsets.back());
+	out.write(hash, sizeof(hash));
+	out.write(offsets.data(), offsets.size());
+	vector<Letter> buf;
+	vector<BlastOid> oids;
+	vector<Letter*> dst;
+	for (BlastOid begin = 0; begin < (BlastOid)sequence_count_; begin += (BlastOid)CHUNK_SIZE) {
+		const BlastOid end = (BlastOid)std::min((int64_t)begin + (int64_t)CHUNK_SIZE, sequence_count_);
+		buf.resize(offsets[end] - offsets[begin]);
+		oids.clear();
+		dst.clear();
+		for (BlastOid i = begin; i < end; ++i) {
+			oids.push_back(i);
+			dst.push_back(buf.data() + offsets[i] - offsets[begin]);
+		}
+		load_parallel(oids, dst);
+		out.write(buf.data(), buf.size());
+	}
+	out.close();
+	// The cache is only visible under its final name once it is complete.
+	if (std::rename(tmp_name.c_str(), file_name.c_str()) != 0)
+		throw std::runtime_error("Error renaming sequence cache file " + tmp_name);
+	timer.finish();
+	message_stream << "Sequence cache written to: " << file_name << endl;
+}
 
 void BlastDB::init_random_access(const size_t query_block, const size_t ref_block, bool dictionary)
 {
@@ -3,6 +3,7 @@
 #include <memory>
 #include "../sequence_file.h"
 #include "../string_set.h"
+#include "../../lib/mio/forward.h"
 
 using BlastOid = int;
 
@@ -21,6 +22,7 @@ struct BlastDB : public SequenceFile {
 	virtual size_t id_len(const SeqInfo& seq_info, const SeqInfo& seq_info_next) override;
 	virtual void seek_offset(size_t p) override;
 	virtual void read_seq_data(Letter* dst, size_t len, size_t& pos, bool seek) override;
+	virtual void decode_seq_data(SequenceSet& seqs) override;
 	virtual void read_id_data(const int64_t oid, char* dst, size_t len) override;
 	virtual void skip_id_data() override;
 	virtual std::string seqid(OId oid) const override;
@@ -59,9 +61,18 @@ struct BlastDB : public SequenceFile {
 	static void prep_blast_db(const std::string& path);
 
 	static const char* ACCESSION_FIELD;
+	static const char* CACHE_EXTENSION;
+	static const uint64_t CACHE_MAGIC_NUMBER;
+	static const uint32_t CACHE_VERSION;
+	static const size_t CACHE_HEADER_SIZE;
 	
 private:
 
+	void load_parallel(const std::vector<BlastOid>& oids, const std::vector<Letter*>& dst);
+	void cache_hash(char* hash) const;
+	bool open_cache(const std::string& file_name);
+	void build_cache(const std::string& file_name);
+
 	const std::string file_name_;
 	std::unique_ptr<ncbi::CSeqDBExpert> db_;
 	int oid_;
@@ -69,6 +80,13 @@ private:
 	const Flags flags_;
 	int64_t sequence_count_, sparse_sequence_count_;
 	BitVector oid_filter_;
+	// Additional handles used to read disjoint OId ranges in parallel.
+	std::vector<std::unique_ptr<ncbi::CSeqDBExpert>> handles_;
+	// OIds of sequences whose data is fetched in decode_seq_data.
+	std::vector<BlastOid> pending_oids_;
+	std::unique_ptr<mio::mmap_source> cache_;
+	const uint64_t* cache_offsets_;
+	const char* cache_data_;
 
 	friend void load_blast_seqid();
 	friend void load_blast_seqid_lin();
@@ -49,6 +49,7 @@ Block::Block(Alphabet alphabet):
 	seqs_(alphabet),
 	source_seqs_(Alphabet::STD),
 	unmasked_seqs_(alphabet),
+	self_aln_masking_(MaskingAlgo::NONE),
 	soft_masked_(false)
 {
 }
@@ -139,18 +140,21 @@ void Block::write_masked_seq(size_t block_id, const std::vector<Letter>& seq) {
 	masked_[block_id] = true;
 }
 
+std::string Block::dict_title(const char* title)
+{
+	if (config.salltitles)
+		return title;
+	else if (config.sallseqid)
+		return Util::Seq::all_seqids(title);
+	else
+		return Util::Seq::seqid(title, config.short_seqids);
+}
+
 DictId Block::dict_id(size_t block, BlockId block_id, SequenceFile& db) const
 {
 	string t;
-	if (has_ids()) {
-		const char* title = ids()[block_id];
-		if (config.salltitles)
-			t = title;
-		else if (config.sallseqid)
-			t = Util::Seq::all_seqids(title);
-		else
-			t = Util::Seq::seqid(title, config.short_seqids);
-	}
+	if (has_ids())
+		t = dict_title(ids()[block_id]);
 	const Letter* seq = unmasked_seqs().empty() ? nullptr : unmasked_seqs()[block_id].data();
 	double self_aln_score = 0.0;
 	if (flag_any(db.flags(), SequenceFile::Flags::SELF_ALN_SCORES)) {
@@ -186,8 +190,13 @@ size_t Block::soft_masked_letters() const {
 	return soft_masking_table_.masked_letters();
 }
 
-void Block::compute_self_aln() {
+void Block::compute_self_aln(const MaskingAlgo masking) {
+	if (has_self_aln() && self_aln_masking_ == masking) {
+		seqs_.convert_all_to_std_alph(config.threads_);
+		return;
+	}
 	self_aln_score_.resize(seqs_.size());
+	self_aln_masking_ = masking;
 	std::atomic_size_t next(0);
 	auto worker = [this, &next] {
 		const size_t n = this->seqs_.size();
@@ -228,29 +237,48 @@ SeqInfo Block::seq_info(const BlockId id) const {
 
 Block* Block::length_sorted(int threads) const {
 	const BlockId n = seqs_.size();
-	vector<pair<Loc, BlockId>> lengths = seqs_.lengths();
+	vector<pair<Loc, BlockId>> lengths;
+	if ((BlockId)length_order_.size() == n) {
+		lengths.reserve(n);
+		for (BlockId j : length_order_)
+			lengths.emplace_back(seqs_.length(j), j);
+	}
+	else {
+		lengths = seqs_.lengths();
 #if _MSC_FULL_VER == 191627045 || !defined(NDEBUG)
-	std::sort(lengths.begin(), lengths.end(), greater<pair<Loc, BlockId>>());
+		std::sort(lengths.begin(), lengths.end(), greater<pair<Loc, BlockId>>());
 #else
-	ips4o::parallel::sort(lengths.begin(), lengths.end(), greater<pair<Loc, BlockId>>(), threads);
+		ips4o::parallel::sort(lengths.begin(), lengths.end(), greater<pair<Loc, BlockId>>(), threads);
 #endif
+	}
+	// Blocks of databases with lazily loaded titles carry no ids.
+	const bool ids = has_ids();
 	Block *b = new Block();
 	for (BlockId i = 0; i < n; ++i) {
 		const BlockId j = lengths[i].second;
 		b->seqs_.reserve(seqs_.length(j));
-		b->ids_.reserve(ids_.length(j));
+		if (ids)
+			b->ids_.reserve(ids_.length(j));
 	}
 	b->seqs_.finish_reserve();
-	b->ids_.finish_reserve();
+	if (ids)
+		b->ids_.finish_reserve();
 	b->block2oid_.reserve(n);
 	for (BlockId i = 0; i < n; ++i) {
 		const BlockId j = lengths[i].second;
 		b->seqs_.assign(i, seqs_.ptr(j), seqs_.end(j));
-		b->ids_.assign(i, ids_.ptr(j), ids_.end(j));
+		if (ids)
+			b->ids_.assign(i, ids_.ptr(j), ids_.end(j));
 		b->block2oid_.push_back(block2oid_.at(j));
 	}
 	if (masked_.size() > 0)
 		b->masked_.resize(masked_.size(), false);
+	if (has_self_aln()) {
+		b->self_aln_score_.reserve(n);
+		for (BlockId i = 0; i < n; ++i)
+			b->self_aln_score_.push_back(self_aln_score_[lengths[i].second]);
+		b->self_aln_masking_ = self_aln_masking_;
+	}
 	return b;
 }
 
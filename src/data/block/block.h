@@ -89,11 +89,14 @@ struct Block {
 	bool fetch_seq_if_unmasked(size_t block_id, std::vector<Letter>& seq);
 	void write_masked_seq(size_t block_id, const std::vector<Letter>& seq);
 	DictId dict_id(size_t block, BlockId block_id, SequenceFile& db) const;
+	static std::string dict_title(const char* title);
 	void soft_mask(const MaskingAlgo algo);
 	void remove_soft_masking(const int template_len, const bool add_bit_mask);
 	bool soft_masked() const;
 	size_t soft_masked_letters() const;
-	void compute_self_aln();
+	// Computes self alignment scores for sequences masked using the given algorithm. Scores
+	// attached at load time are kept if they were computed with the same masking.
+	void compute_self_aln(const MaskingAlgo masking);
 	double self_aln_score(const int64_t block_id) const;
 	bool has_self_aln() const {
 		return (BlockId)self_aln_score_.size() == seqs_.size();
@@ -115,10 +118,14 @@ private:
 	std::vector<OId> block2oid_;
 	std::vector<bool> masked_;
 	std::vector<double> self_aln_score_;
+	MaskingAlgo self_aln_masking_;
+	std::vector<BlockId> length_order_;
 	std::mutex mask_lock_;
 	MaskingTable soft_masking_table_;
 	bool soft_masked_;
 
 	friend struct SequenceFile;
+	friend struct ClusterLayout;
+	friend struct Replay;
 
 };
\ No newline at end of file
@@ -0,0 +1,182 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2024 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <buchfink@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#define NOMINMAX
+#include "../lib/mio/mmap.hpp"
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <sstream>
+#include <vector>
+#include "cluster_layout.h"
+#include "sequence_file.h"
+#include "block/block.h"
+#include "../basic/config.h"
+#include "../stats/score_matrix.h"
+#include "../stats/cbs.h"
+#include "../util/io/output_file.h"
+#include "../util/log_stream.h"
+#define _REENTRANT
+#include "../lib/ips4o/ips4o.hpp"
+
+using std::vector;
+using std::string;
+using std::pair;
+using std::unique_ptr;
+using std::runtime_error;
+
+const char* ClusterLayout::FILE_EXTENSION = ".clust_layout";
+const uint64_t ClusterLayout::MAGIC_NUMBER = 0x3e4a1f07c96b52d8llu;
+const uint32_t ClusterLayout::VERSION = 2;
+// magic number, version, masking algorithm, entry count, database hash, scoring tag length, padding
+const size_t ClusterLayout::HEADER_SIZE = 8 + 4 + 4 + 8 + 16 + 4 + 4;
+
+string ClusterLayout::file_name(const string& db_file) {
+	return db_file + FILE_EXTENSION;
+}
+
+string ClusterLayout::scoring_tag() {
+	std::ostringstream s;
+	s << score_matrix << " cbs=" << Stats::CBS::hauser(config.comp_based_stats);
+	return s.str();
+}
+
+ClusterLayout::ClusterLayout(const string& file_name):
+	mmap_(new mio::mmap_source(file_name))
+{
+	if (mmap_->length() < HEADER_SIZE)
+		throw runtime_error("Invalid cluster layout file.");
+	const char* buf = mmap_->data();
+	if (*(const uint64_t*)buf != MAGIC_NUMBER)
+		throw runtime_error("Invalid cluster layout file.");
+	if (*(const uint32_t*)(buf + 8) != VERSION)
+		throw runtime_error("Invalid cluster layout file version.");
+	masking_ = (MaskingAlgo)*(const int32_t*)(buf + 12);
+	count_ = *(const int64_t*)(buf + 16);
+	db_hash_ = buf + 24;
+	const uint32_t tag_len = *(const uint32_t*)(buf + 40);
+	if (mmap_->length() != HEADER_SIZE + tag_len + count_ * (2 * sizeof(uint32_t) + sizeof(double)))
+		throw runtime_error("Cluster layout file is truncated.");
+	scoring_tag_ = string(buf + HEADER_SIZE);
+	length_order_ = (const uint32_t*)(buf + HEADER_SIZE + tag_len);
+	length_rank_ = length_order_ + count_;
+	self_aln_scores_ = (const double*)(length_rank_ + count_);
+}
+
+ClusterLayout::~ClusterLayout() {
+}
+
+void ClusterLayout::annotate(Block& block) const {
+	const BlockId n = block.seqs_.size();
+	if (n == 0)
+		return;
+	const OId begin = block.block2oid_.front(), end = block.block2oid_.back() + 1;
+	if (end - begin == (OId)n) {
+		block.length_order_.clear();
+		if ((int64_t)n == count_)
+			block.length_order_.assign(length_order_, length_order_ + n);
+		else {
+			vector<pair<uint32_t, BlockId>> ranks;
+			ranks.reserve(n);
+			for (BlockId i = 0; i < n; ++i)
+				ranks.emplace_back(length_rank_[begin + i], i);
+			std::sort(ranks.begin(), ranks.end());
+			block.length_order_.reserve(n);
+			for (const auto& r : ranks)
+				block.length_order_.push_back(r.second);
+		}
+	}
+	if (scoring_tag_ == scoring_tag()) {
+		block.self_aln_score_.resize(n);
+		for (BlockId i = 0; i < n; ++i)
+			block.self_aln_score_[i] = self_aln_scores_[block.block2oid_[i]];
+		block.self_aln_masking_ = masking_;
+	}
+}
+
+void ClusterLayout::build(SequenceFile& db, const char* db_hash, const string& file_name) {
+	if (db.sequence_count() > (int64_t)std::numeric_limits<uint32_t>::max())
+		throw runtime_error("Cluster layout is not supported for databases of more than 2^32 sequences.");
+	MaskingAlgo masking = MaskingAlgo::NONE;
+	switch (from_string<MaskingMode>(config.masking_.get("tantan"))) {
+	case MaskingMode::BLAST_SEG:
+		masking = MaskingAlgo::SEG;
+		break;
+	case MaskingMode::TANTAN:
+		masking = MaskingAlgo::TANTAN;
+		break;
+	default:;
+	}
+
+	TaskTimer timer;
+	vector<pair<Loc, uint32_t>> lengths;
+	vector<double> scores;
+	lengths.reserve(db.sequence_count());
+	scores.reserve(db.sequence_count());
+	db.set_seqinfo_ptr(0);
+	for (;;) {
+		timer.go("Loading sequences");
+		unique_ptr<Block> block(db.load_seqs((int64_t)1e9, nullptr, SequenceFile::LoadFlags::SEQS));
+		if (block->empty())
+			break;
+		if (masking != MaskingAlgo::NONE) {
+			timer.go("Masking sequences");
+			mask_seqs(block->seqs(), Masking::get(), true, masking);
+		}
+		timer.go("Computing self alignment scores");
+		block->compute_self_aln(masking);
+		for (BlockId i = 0; i < block->seqs().size(); ++i) {
+			lengths.emplace_back(block->seqs().length(i), (uint32_t)block->block_id2oid(i));
+			scores.push_back(block->self_aln_score(i));
+		}
+	}
+	if ((int64_t)lengths.size() != db.sequence_count())
+		throw runtime_error("Inconsistent sequence count in database.");
+
+	timer.go("Length sorting sequences");
+#if _MSC_FULL_VER == 191627045 || !defined(NDEBUG)
+	std::sort(lengths.begin(), lengths.end(), std::greater<pair<Loc, uint32_t>>());
+#else
+	ips4o::parallel::sort(lengths.begin(), lengths.end(), std::greater<pair<Loc, uint32_t>>(), config.threads_);
+#endif
+
+	timer.go("Writing cluster layout");
+	string tag = scoring_tag();
+	tag.resize((tag.length() + 8) / 8 * 8, '\0');
+	OutputFile out(file_name);
+	out.write(MAGIC_NUMBER);
+	out.write(VERSION);
+	out.write((int32_t)masking);
+	out.write((int64_t)lengths.size());
+	out.write(db_hash, 16);
+	out.write((uint32_t)tag.length());
+	out.write((uint32_t)0);
+	out.write(tag.data(), tag.length());
+	vector<uint32_t> ranks(lengths.size());
+	for (size_t i = 0; i < lengths.size(); ++i) {
+		out.write(lengths[i].second);
+		ranks[lengths[i].second] = (uint32_t)i;
+	}
+	out.write(ranks.data(), ranks.size());
+	out.write(scores.data(), scores.size());
+	out.close();
+	timer.finish();
+	message_stream << "Self alignment scores computed with: " << scoring_tag() << ", masking=" << to_string(masking) << std::endl;
+}
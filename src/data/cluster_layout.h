@@ -0,0 +1,72 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2024 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <buchfink@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#pragma once
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include "../basic/value.h"
+#include "../masking/masking.h"
+#include "../lib/mio/forward.h"
+
+struct SequenceFile;
+struct Block;
+
+// Precomputed per-sequence data used by the clustering workflows, stored in a sidecar file
+// next to the database: the OIds sorted by decreasing length (the order produced by
+// Block::length_sorted), the inverse of this permutation and the self alignment bit scores. The scores are only valid for the
+// scoring parameters and masking algorithm they were computed with, which are recorded in
+// the file header.
+
+struct ClusterLayout {
+
+	ClusterLayout(const std::string& file_name);
+	~ClusterLayout();
+
+	int64_t size() const {
+		return count_;
+	}
+	const char* db_hash() const {
+		return db_hash_;
+	}
+	// Attaches the stored length order and self alignment scores to a freshly loaded block.
+	void annotate(Block& block) const;
+
+	static std::string file_name(const std::string& db_file);
+	static std::string scoring_tag();
+	static void build(SequenceFile& db, const char* db_hash, const std::string& file_name);
+
+	static const char* FILE_EXTENSION;
+	static const uint64_t MAGIC_NUMBER;
+	static const uint32_t VERSION;
+	static const size_t HEADER_SIZE;
+
+private:
+
+	std::unique_ptr<mio::mmap_source> mmap_;
+	int64_t count_;
+	MaskingAlgo masking_;
+	const char* db_hash_;
+	std::string scoring_tag_;
+	const uint32_t* length_order_;
+	const uint32_t* length_rank_;
+	const double* self_aln_scores_;
+
+};
@@ -20,8 +20,11 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ****/
 
+#define NOMINMAX
+#include "../../lib/mio/mmap.hpp"
 #include <limits>
 #include <fstream>
+#include <atomic>
 #include "../basic/config.h"
 #include "../util/seq_file_format.h"
 #include "../util/log_stream.h"
@@ -32,6 +35,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../util/algo/MurmurHash3.h"
 #include "../util/io/record_reader.h"
 #include "../util/parallel/multiprocessing.h"
+#include "../util/parallel/thread_pool.h"
 #include "dmnd.h"
 #include "../reference.h"
 #include "../taxonomy.h"
@@ -40,6 +44,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../../util/util.h"
 #include "../fasta/fasta_file.h"
 #include "../../util/sequence/sequence.h"
+#include "../accession_index.h"
+#include "../cluster_layout.h"
 
 using std::tuple;
 using std::string;
@@ -52,6 +58,7 @@ using std::runtime_error;
 const char* DatabaseFile::FILE_EXTENSION = ".dmnd";
 const uint32_t ReferenceHeader::current_db_version_prot = 3;
 const uint32_t ReferenceHeader::current_db_version_nucl = 4;
+const uint32_t ReferenceHeader::db_version_packed_prot = 5;
 
 Serializer& operator<<(Serializer &s, const ReferenceHeader2 &h)
 {
@@ -128,7 +135,7 @@ void DatabaseFile::init(Flags flags)
 		return;
 	if (ref_header.build < min_build_required || ref_header.db_version < MIN_DB_VERSION)
 		throw std::runtime_error("Database was built with an older version of Diamond and is incompatible.");
-	if (ref_header.db_version > std::max(ReferenceHeader::current_db_version_prot , ReferenceHeader::current_db_version_nucl))
+	if (ref_header.db_version > std::max({ ReferenceHeader::current_db_version_prot, ReferenceHeader::current_db_version_nucl, ReferenceHeader::db_version_packed_prot }))
 		throw std::runtime_error("Database was built with a newer version of Diamond and is incompatible.");
 	if (ref_header.sequences == 0)
 		throw std::runtime_error("Incomplete database file. Database building did not complete successfully.");
@@ -137,7 +144,7 @@ void DatabaseFile::init(Flags flags)
 }
 
 DatabaseFile::DatabaseFile(const string &input_file, Metadata metadata, Flags flags, const ValueTraits& value_traits):
-	SequenceFile(SequenceFile::Type::DMND, Alphabet::STD, flags, FormatFlags::DICT_LENGTHS | FormatFlags::DICT_SEQIDS | FormatFlags::SEEKABLE | FormatFlags::LENGTH_LOOKUP, value_traits),
+	SequenceFile(SequenceFile::Type::DMND, Alphabet::STD, flags, FormatFlags::TITLES_LAZY | FormatFlags::DICT_LENGTHS | FormatFlags::SEEKABLE | FormatFlags::LENGTH_LOOKUP, value_traits),
 	InputFile(auto_append_extension_if_exists(input_file, FILE_EXTENSION), InputFile::BUFFERED),
 	temporary(false)
 {
@@ -167,7 +174,12 @@ DatabaseFile::DatabaseFile(const string &input_file, Metadata metadata, Flags fl
 	if (flag_any(metadata, Metadata::TAXON_NODES))
 		taxon_nodes_.reset(new TaxonomyNodes(seek(header2.taxon_nodes_offset), ref_header.build));
 
-	if (flag_any(flags, Flags::ACC_TO_OID_MAPPING | Flags::OID_TO_ACC_MAPPING | Flags::NEED_LENGTH_LOOKUP))
+	if (flag_any(flags, Flags::ACC_TO_OID_MAPPING))
+		open_accession_index();
+	if (flag_any(flags, Flags::CLUSTER_LAYOUT))
+		open_cluster_layout();
+
+	if (flag_any(flags, Flags::OID_TO_ACC_MAPPING | Flags::NEED_LENGTH_LOOKUP) || (flag_any(flags, Flags::ACC_TO_OID_MAPPING) && !acc_index_))
 		read_seqid_list();
 }
 
@@ -184,6 +196,7 @@ int64_t DatabaseFile::file_count() const {
 }
 
 void DatabaseFile::close() {
+	title_map_.reset();
 	if (temporary)
 		InputFile::close_and_delete();
 	else
@@ -211,16 +224,77 @@ bool DatabaseFile::has_taxon_scientific_names() const {
 	return header2.taxon_names_offset != 0;
 }
 
-static void push_seq(const Sequence &seq, const char *id, size_t id_len, uint64_t &offset, vector<SequenceFile::SeqInfo> &pos_array, OutputFile &out, size_t &letters, size_t &n_seqs)
+bool DatabaseFile::packed_seqs() const {
+	return ref_header.db_version == ReferenceHeader::db_version_packed_prot;
+}
+
+// Packed sequence records store 4 residues in 3 bytes. Each 6 bit code holds the
+// letter in the low 5 bits and the masking bit in bit 5.
+
+static size_t packed_len(size_t len) {
+	return (len * 6 + 7) / 8;
+}
+
+static unsigned pack_code(Letter l) {
+	return (l & 31) | ((l & Masking::bit_mask) ? 32 : 0);
+}
+
+static Letter unpack_code(unsigned c) {
+	return Letter((c & 31) | ((c & 32) ? Masking::bit_mask : 0));
+}
+
+static void pack_seq(const Letter* seq, size_t len, vector<char>& dst) {
+	dst.assign(packed_len(len), 0);
+	for (size_t i = 0; i < len; ++i) {
+		const size_t bit = i * 6;
+		const unsigned c = pack_code(seq[i]) << (bit & 7);
+		dst[bit / 8] |= char(c & 0xff);
+		if (c > 0xff)
+			dst[bit / 8 + 1] |= char(c >> 8);
+	}
+}
+
+// Unpacks in place. Groups are processed back to front, so the output of a group never
+// overlaps input bytes that are still to be read.
+static void unpack_seq(Letter* seq, size_t len) {
+	const unsigned char* src = (const unsigned char*)seq;
+	const size_t groups = len / 4, r = len % 4;
+	if (r) {
+		uint32_t w = 0;
+		for (size_t i = 0; i < packed_len(r); ++i)
+			w |= (uint32_t)src[groups * 3 + i] << (i * 8);
+		for (size_t k = 0; k < r; ++k)
+			seq[groups * 4 + k] = unpack_code((w >> (k * 6)) & 63);
+	}
+	for (size_t g = groups; g-- > 0;) {
+		const uint32_t w = (uint32_t)src[g * 3] | ((uint32_t)src[g * 3 + 1] << 8) | ((uint32_t)src[g * 3 + 2] << 16);
+		Letter* dst = seq + g * 4;
+		dst[0] = unpack_code(w & 63);
+		dst[1] = unpack_code((w >> 6) & 63);
+		dst[2] = unpack_code((w >> 12) & 63);
+		dst[3] = unpack_code((w >> 18) & 63);
+	}
+}
+
+static void push_seq(const Sequence &seq, const char *id, size_t id_len, uint64_t &offset, vector<SequenceFile::SeqInfo> &pos_array, OutputFile &out, size_t &letters, size_t &n_seqs, vector<char>* pack_buf)
 {
 	pos_array.emplace_back(offset, seq.length());
-	out.write("\xff", 1);
-	out.write(seq.data(), seq.length());
-	out.write("\xff", 1);
-	out.write(id, id_len + 1);
+	if (pack_buf) {
+		pack_seq(seq.data(), seq.length(), *pack_buf);
+		out.write((uint32_t)seq.length());
+		out.write(pack_buf->data(), pack_buf->size());
+		out.write(id, id_len + 1);
+		offset += 4 + pack_buf->size() + id_len + 1;
+	}
+	else {
+		out.write("\xff", 1);
+		out.write(seq.data(), seq.length());
+		out.write("\xff", 1);
+		out.write(id, id_len + 1);
+		offset += seq.length() + id_len + 3;
+	}
 	letters += seq.length();
 	++n_seqs;
-	offset += seq.length() + id_len + 3;
 }
 
 void DatabaseFile::make_db()
@@ -255,6 +329,12 @@ void DatabaseFile::make_db()
         header.db_version = ReferenceHeader::current_db_version_nucl;
         flags |= SequenceFile::LoadFlags::DNA_PRESERVATION;
     }
+	vector<char> pack_buf;
+	if (config.pack_seqs) {
+		if (config.dbtype == SequenceType::nucleotide)
+			throw std::runtime_error("Option --pack-seqs is only supported for protein databases.");
+		header.db_version = ReferenceHeader::db_version_packed_prot;
+	}
 
     Block* block;
 	const FASTA_format format;
@@ -281,7 +361,7 @@ void DatabaseFile::make_db()
 				Sequence seq = block->seqs()[i];
 				if (seq.length() == 0)
 					throw std::runtime_error("File format error: sequence of length 0 at line " + std::to_string(db_file.line_count()));
-				push_seq(seq, block->ids()[i], block->ids().length(i), offset, pos_array, *out, letters, n_seqs);
+				push_seq(seq, block->ids()[i], block->ids().length(i), offset, pos_array, *out, letters, n_seqs, config.pack_seqs ? &pack_buf : nullptr);
 			}
 			if (!config.prot_accession2taxid.empty()) {
 				timer.go("Writing accessions");
@@ -381,22 +461,40 @@ void DatabaseFile::init_seq_access() {
 
 bool DatabaseFile::read_seq(vector<Letter>& seq, string &id, std::vector<char>* quals)
 {
-	char c;
-	read(&c, 1);
 	seq.clear();
 	id.clear();
-	read_to(std::back_inserter(seq), '\xff');
+	if (packed_seqs()) {
+		uint32_t len;
+		read(len);
+		seq.resize(len);
+		if (read(seq.data(), packed_len(len)) != packed_len(len))
+			throw std::runtime_error("Unexpected end of file.");
+		unpack_seq(seq.data(), len);
+	}
+	else {
+		char c;
+		read(&c, 1);
+		read_to(std::back_inserter(seq), '\xff');
+	}
 	read_to(std::back_inserter(id), '\0');
 	return false;
 }
 
 void DatabaseFile::skip_seq()
 {
-	char c;
-	if(read(&c, 1) != 1)
-		throw std::runtime_error("Unexpected end of file.");
-	if(!seek_forward('\xff'))
-		throw std::runtime_error("Unexpected end of file.");
+	if (packed_seqs()) {
+		uint32_t len;
+		read(len);
+		if (!seek_forward(packed_len(len)))
+			throw std::runtime_error("Unexpected end of file.");
+	}
+	else {
+		char c;
+		if (read(&c, 1) != 1)
+			throw std::runtime_error("Unexpected end of file.");
+		if (!seek_forward('\xff'))
+			throw std::runtime_error("Unexpected end of file.");
+	}
 	if(!seek_forward('\0'))
 		throw std::runtime_error("Unexpected end of file.");
 }
@@ -517,6 +615,8 @@ void DatabaseFile::seek_chunk(const Chunk& chunk) {
 }
 
 size_t DatabaseFile::id_len(const SeqInfo& seq_info, const SeqInfo& seq_info_next) {
+	if (packed_seqs())
+		return seq_info_next.pos - seq_info.pos - packed_len(seq_info.seq_len) - 5;
 	return seq_info_next.pos - seq_info.pos - seq_info.seq_len - 3;
 }
 
@@ -527,11 +627,37 @@ void DatabaseFile::seek_offset(size_t p) {
 void DatabaseFile::read_seq_data(Letter* dst, size_t len, size_t& pos, bool seek) {
 	if (seek)
 		this->seek(pos);
-	read(dst - 1, len + 2);
+	if (packed_seqs()) {
+		uint32_t l;
+		read(l);
+		if (l != len)
+			throw std::runtime_error("Inconsistent sequence length in database file.");
+		read(dst, packed_len(len));
+	}
+	else
+		read(dst - 1, len + 2);
 	*(dst - 1) = Sequence::DELIMITER;
 	*(dst + len) = Sequence::DELIMITER;
 }
 
+void DatabaseFile::decode_seq_data(SequenceSet& seqs) {
+	const bool packed = packed_seqs();
+	const BlockId n = seqs.size(), STEP = 256;
+	std::atomic<BlockId> next(0);
+	auto worker = [&seqs, &next, packed, n, STEP](ThreadPool&) {
+		const BlockId begin = next.fetch_add(STEP), end = std::min(begin + STEP, n);
+		for (BlockId i = begin; i < end; ++i) {
+			if (packed)
+				unpack_seq(seqs.ptr(i), seqs.length(i));
+			Masking::get().remove_bit_mask(seqs.ptr(i), seqs.length(i));
+		}
+		return end < n;
+	};
+	ThreadPool tp(worker);
+	tp.run(config.threads_);
+	tp.join();
+}
+
 void DatabaseFile::read_id_data(const int64_t oid, char* dst, size_t len) {
 	read(dst, len + 1);
 }
@@ -584,10 +710,80 @@ void DatabaseFile::reopen()
 {
 }
 
+bool DatabaseFile::open_accession_index() {
+	const string index_file = AccessionIndex::file_name(file_name());
+	if (!exists(index_file))
+		return false;
+	unique_ptr<AccessionIndex> index(new AccessionIndex(index_file));
+	if (memcmp(index->db_hash(), header2.hash, sizeof(header2.hash)) != 0 || index->size() != sequence_count()) {
+		message_stream << "Warning: Accession index does not match the database and will be ignored: " << index_file << endl;
+		return false;
+	}
+	acc_index_ = std::move(index);
+	if (!title_map_)
+		title_map_.reset(new mio::mmap_source(file_name()));
+	return true;
+}
+
+bool DatabaseFile::open_cluster_layout() {
+	const string layout_file = ClusterLayout::file_name(file_name());
+	if (!exists(layout_file))
+		return false;
+	unique_ptr<ClusterLayout> layout(new ClusterLayout(layout_file));
+	if (memcmp(layout->db_hash(), header2.hash, sizeof(header2.hash)) != 0 || layout->size() != sequence_count()) {
+		message_stream << "Warning: Cluster layout does not match the database and will be ignored: " << layout_file << endl;
+		return false;
+	}
+	cluster_layout_ = std::move(layout);
+	return true;
+}
+
 BitVector* DatabaseFile::filter_by_accession(const std::string& file_name)
 {
-	throw std::runtime_error("The .dmnd database format does not support filtering by accession.");
-	return nullptr;
+	BitVector* v = new BitVector(sequence_count());
+	TextInputFile in(file_name);
+	vector<string> accs;
+	while (in.getline(), (!in.line.empty() || !in.eof()))
+		accs.push_back(in.line);
+	in.close();
+
+	auto missing = [](const string& acc) {
+		if (config.skip_missing_seqids)
+			message_stream << "WARNING: Accession not found in database : " + acc << endl;
+		else
+			throw std::runtime_error("Accession not found in database: " + acc + ". Use --skip-missing-seqids to ignore.");
+	};
+
+	if (acc_index_ || open_accession_index()) {
+		for (const string& acc : accs) {
+			const vector<OId> oids = find_indexed_accession(acc);
+			if (oids.empty())
+				missing(acc);
+			for (OId i : oids)
+				v->set(i);
+		}
+		return v;
+	}
+
+	std::unordered_map<string, bool> acc_set;
+	acc_set.reserve(accs.size());
+	for (const string& acc : accs)
+		acc_set.emplace(acc, false);
+	vector<Letter> seq;
+	string id;
+	init_seq_access();
+	for (OId i = 0; i < sequence_count(); ++i) {
+		read_seq(seq, id);
+		auto it = acc_set.find(Util::Seq::seqid(id.c_str(), false));
+		if (it != acc_set.end()) {
+			v->set(i);
+			it->second = true;
+		}
+	}
+	for (const string& acc : accs)
+		if (!acc_set[acc])
+			missing(acc);
+	return v;
 }
 
 const BitVector* DatabaseFile::builtin_filter()
@@ -612,7 +808,26 @@ std::vector<TaxId> DatabaseFile::taxids(size_t oid) const
 
 void DatabaseFile::seq_data(size_t oid, std::vector<Letter>& dst) const
 {
-	throw OperationNotSupported();
+	if (!title_map_)
+		throw std::runtime_error("Database file is not mapped.");
+	if (oid >= (size_t)sequence_count())
+		throw std::out_of_range("DatabaseFile::seq_data");
+	const char* p = title_map_->data() + ref_header.pos_array_offset + SeqInfo::SIZE * oid;
+	uint64_t pos;
+	uint32_t len;
+	memcpy(&pos, p, sizeof(pos));
+	memcpy(&len, p + sizeof(pos), sizeof(len));
+	const size_t n = packed_seqs() ? packed_len(len) + 4 : len + 2;
+	if (pos + n > title_map_->size())
+		throw std::runtime_error("Unexpected end of file.");
+	dst.resize(len);
+	if (packed_seqs()) {
+		std::copy(title_map_->data() + pos + 4, title_map_->data() + pos + n, (char*)dst.data());
+		unpack_seq(dst.data(), len);
+	}
+	else
+		std::copy(title_map_->data() + pos + 1, title_map_->data() + pos + 1 + len, (char*)dst.data());
+	Masking::get().remove_bit_mask(dst.data(), len);
 }
 
 size_t DatabaseFile::seq_length(size_t oid) const
@@ -624,6 +839,8 @@ size_t DatabaseFile::seq_length(size_t oid) const
 
 void DatabaseFile::init_random_access(const size_t query_block, const size_t ref_blocks, bool dictionary)
 {
+	if (!title_map_ && flag_any(format_flags_, FormatFlags::TITLES_LAZY))
+		title_map_.reset(new mio::mmap_source(file_name()));
 	if(dictionary)
 		load_dictionary(query_block, ref_blocks);
 }
@@ -635,6 +852,28 @@ void DatabaseFile::end_random_access(bool dictionary)
 	free_dictionary();
 }
 
+std::string DatabaseFile::seqid(OId oid) const
+{
+	if (!title_map_)
+		throw std::runtime_error("Database titles are not mapped.");
+	if (oid < 0 || oid >= sequence_count())
+		throw std::out_of_range("DatabaseFile::seqid");
+	const char* p = title_map_->data() + ref_header.pos_array_offset + SeqInfo::SIZE * oid;
+	uint64_t pos;
+	uint32_t len;
+	memcpy(&pos, p, sizeof(pos));
+	memcpy(&len, p + sizeof(pos), sizeof(len));
+	return string(title_map_->data() + pos + (packed_seqs() ? packed_len(len) + 4 : len + 2));
+}
+
+std::string DatabaseFile::dict_title(DictId dict_id, const size_t ref_block) const
+{
+	const size_t b = dict_block(ref_block);
+	if (b >= dict_oid_.size() || dict_id >= (DictId)dict_oid_[b].size())
+		throw std::runtime_error("Dictionary not loaded.");
+	return Block::dict_title(seqid(dict_oid_[b][dict_id]).c_str());
+}
+
 void DatabaseFile::init_write() {
 	throw OperationNotSupported();
 }
@@ -664,7 +903,7 @@ void DatabaseFile::prep_db() {
 #endif
 
 void DatabaseFile::read_seqid_list() {
-	if (flag_any(flags_, Flags::ACC_TO_OID_MAPPING))
+	if (flag_any(flags_, Flags::ACC_TO_OID_MAPPING) && !acc_index_)
 		acc2oid_.reserve(sequence_count());
 	if (flag_any(flags_, Flags::NEED_LENGTH_LOOKUP))
 		seq_length_.reserve(sequence_count());
@@ -29,6 +29,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../util/io/input_file.h"
 #include "../sequence_file.h"
 #include "../taxon_list.h"
+#include "../../lib/mio/forward.h"
 
 struct ReferenceHeader
 {
@@ -44,6 +45,7 @@ struct ReferenceHeader
 	uint64_t sequences, letters, pos_array_offset;
 	static const uint32_t current_db_version_prot;
 	static const uint32_t current_db_version_nucl;
+	static const uint32_t db_version_packed_prot;
 	static constexpr uint64_t MAGIC_NUMBER = 0x24af8a415ee186dllu;
 	friend InputFile& operator>>(InputFile& file, ReferenceHeader& h);
 };
@@ -97,6 +99,7 @@ struct DatabaseFile : public SequenceFile, public InputFile
 	bool has_taxon_id_lists() const;
 	bool has_taxon_nodes() const;
 	bool has_taxon_scientific_names() const;
+	bool packed_seqs() const;
 	virtual void close() override;
 	virtual void set_seqinfo_ptr(OId i) override;
 	virtual OId tell_seq() const override;
@@ -133,6 +136,7 @@ struct DatabaseFile : public SequenceFile, public InputFile
 	virtual size_t id_len(const SeqInfo& seq_info, const SeqInfo& seq_info_next) override;
 	virtual void seek_offset(size_t p) override;
 	virtual void read_seq_data(Letter* dst, size_t len, size_t& pos, bool seek) override;
+	virtual void decode_seq_data(SequenceSet& seqs) override;
 	virtual void read_id_data(const int64_t oid, char* dst, size_t len) override;
 	virtual void skip_id_data() override;
 	virtual int64_t sequence_count() const override;
@@ -155,6 +159,8 @@ struct DatabaseFile : public SequenceFile, public InputFile
 	virtual size_t seq_length(size_t oid) const override;
 	virtual void init_random_access(const size_t query_block, const size_t ref_blocks, bool dictionary = true) override;
 	virtual void end_random_access(bool dictionary = true) override;
+	virtual std::string seqid(OId oid) const override;
+	virtual std::string dict_title(DictId dict_id, const size_t ref_block) const override;
 	virtual void init_write() override;
 	virtual void write_seq(const Sequence& seq, const std::string& id) override;
 
@@ -164,8 +170,11 @@ private:
 
 	void init(Flags flags = Flags::NONE);
 	void read_seqid_list();
+	bool open_accession_index();
+	bool open_cluster_layout();
 
 	std::unique_ptr<TaxonList> taxon_list_;
 	std::vector<std::string> taxon_scientific_names_;
+	std::unique_ptr<mio::mmap_source> title_map_;
 
 };
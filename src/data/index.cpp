@@ -4,12 +4,26 @@
 #include "../search/search.h"
 #include "seed_set.h"
 #include "dmnd/dmnd.h"
+#include "accession_index.h"
+#include "cluster_layout.h"
 
 void makeindex() {
 	static const size_t MAX_LETTERS = 100000000;
 	if (config.database.empty())
 		throw std::runtime_error("Missing parameter: database file (--db/-d).");
 	DatabaseFile db(config.database);
+	if (config.accession_index) {
+		AccessionIndex::build(db, db.header2.hash, AccessionIndex::file_name(db.file_name()));
+		db.close();
+		return;
+	}
+	if (config.cluster_layout) {
+		if (db.ref_header.db_version == ReferenceHeader::current_db_version_nucl)
+			throw std::runtime_error("Cluster layout is only supported for protein databases.");
+		ClusterLayout::build(db, db.header2.hash, ClusterLayout::file_name(db.file_name()));
+		db.close();
+		return;
+	}
 	if (db.ref_header.letters > MAX_LETTERS)
 		throw std::runtime_error("Indexing is only supported for databases of < 100000000 letters.");
 
@@ -26,6 +26,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "enum_seeds.h"
 #include "../util/data_structures/deque.h"
 #include "../search/seed_complexity.h"
+#include "../util/memory/memory_tracker.h"
 
 using std::array;
 using std::vector;
@@ -35,7 +36,7 @@ template<typename SeedLoc> using PtrSet = vector<array<typename SeedArray<SeedLo
 template<typename SeedLoc>
 char* SeedArray<SeedLoc>::alloc_buffer(const SeedHistogram &hst, int index_chunks)
 {
-	return new char[sizeof(Entry) * hst.max_chunk_size(index_chunks)];
+	return (char*)Util::Memory::allocate(Util::Memory::Tag::SEED_ARRAYS, sizeof(Entry) * hst.max_chunk_size(index_chunks));
 }
 
 template char* SeedArray<PackedLoc>::alloc_buffer(const SeedHistogram&, int);
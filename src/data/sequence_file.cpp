@@ -20,6 +20,7 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ****/
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <thread>
@@ -34,6 +35,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../util/parallel/multiprocessing.h"
 #include "../basic/config.h"
 #include "fasta/fasta_file.h"
+#include "accession_index.h"
+#include "cluster_layout.h"
 #include "../util/string/tokenizer.h"
 #include "../util/tsv/file.h"
 #define _REENTRANT
@@ -66,7 +69,8 @@ const EMap<SequenceFile::Type> EnumTraits<SequenceFile::Type>::to_string = {
 	{SequenceFile::Type::DMND, "Diamond database" },
 	{SequenceFile::Type::BLAST, "BLAST database"},
 	{SequenceFile::Type::FASTA, "FASTA file"},
-	{SequenceFile::Type::BLOCK, ""}
+	{SequenceFile::Type::BLOCK, ""},
+	{SequenceFile::Type::VIEW, "Database view"}
 };
 
 static string dict_file_name(const size_t query_block, const size_t target_block) {
@@ -99,6 +103,9 @@ std::string SequenceFile::taxon_scientific_name(TaxId taxid) const {
 	throw OperationNotSupported();
 }
 
+void SequenceFile::decode_seq_data(SequenceSet& seqs) {
+}
+
 pair<Block*, int64_t> SequenceFile::load_twopass(const int64_t max_letters, const BitVector* filter, LoadFlags flags, const Chunk& chunk) {
 	init_seqinfo_access();
 
@@ -180,15 +187,13 @@ pair<Block*, int64_t> SequenceFile::load_twopass(const int64_t max_letters, cons
 				read_id_data(block->block2oid_[i], block->ids_.ptr(i), block->ids_.length(i));
 			else
 				skip_id_data();
-			if (type_ == Type::DMND)
-				Masking::get().remove_bit_mask(block->seqs_.ptr(i), block->seqs_.length(i));
 			if (load_size > MAX_LOAD_SIZE) {
 				close_weakly();
 				reopen();
 				load_size = 0;
 			}
 		}
-		
+		decode_seq_data(block->seqs_);
 	}
 	return { block, seqs_processed };
 }
@@ -275,6 +280,9 @@ Block* SequenceFile::load_seqs(const int64_t max_letters, const BitVector* filte
 	if (flag_any(flags, LoadFlags::CONVERT_ALPHABET))
 		block->seqs_.convert_all_to_std_alph(config.threads_);
 
+	if (cluster_layout_ && flag_any(flags, LoadFlags::SEQS))
+		cluster_layout_->annotate(*block);
+
 	block->seqs_.print_stats();
 	return block;
 }
@@ -703,7 +711,21 @@ void SequenceFile::build_acc_to_oid() {
 	}
 }
 
+// Looks up an accession in the accession index. Fingerprints may collide, so the candidates are checked against the stored accessions.
+vector<OId> SequenceFile::find_indexed_accession(const string& accession) const {
+	vector<OId> oids = acc_index_->find(accession);
+	oids.erase(std::remove_if(oids.begin(), oids.end(), [this, &accession](OId oid) { return Util::Seq::seqid(seqid(oid).c_str(), false) != accession; }),
+		oids.end());
+	return oids;
+}
+
 vector<OId> SequenceFile::accession_to_oid(const string& accession) const {
+	if (acc_index_) {
+		const vector<OId> oids = find_indexed_accession(accession);
+		if (oids.empty())
+			throw runtime_error("Accession not found in database: " + accession);
+		return oids;
+	}
 	try {
 		return { acc2oid_.at(accession) };
 	}
@@ -850,7 +872,7 @@ void prep_db() {
 
 void SequenceFile::add_seqid_mapping(const std::string& id, OId oid) {
 	const string acc = Util::Seq::seqid(id.c_str(), false);
-	if (flag_any(flags_, Flags::ACC_TO_OID_MAPPING)) {
+	if (flag_any(flags_, Flags::ACC_TO_OID_MAPPING) && !acc_index_) {
 		if (oid != (OId)acc2oid_.size())
 			throw runtime_error("add_seqid_mapping");
 		auto r = acc2oid_.emplace(acc, oid);
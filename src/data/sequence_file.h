@@ -50,10 +50,12 @@ struct OperationNotSupported : public std::exception {
 };
 
 struct FastaFile;
+struct AccessionIndex;
+struct ClusterLayout;
 
 struct SequenceFile {
 
-	enum class Type { DMND = 0, BLAST = 1, FASTA = 2, BLOCK = 3 };
+	enum class Type { DMND = 0, BLAST = 1, FASTA = 2, BLOCK = 3, VIEW = 4 };
 
 	enum class Metadata : int {
 		TAXON_MAPPING = 1,
@@ -73,7 +75,8 @@ struct SequenceFile {
 		NEED_LETTER_COUNT = 1 << 6,
 		ACC_TO_OID_MAPPING = 1 << 7,
 		OID_TO_ACC_MAPPING = 1 << 8,
-		NEED_LENGTH_LOOKUP = 1 << 9
+		NEED_LENGTH_LOOKUP = 1 << 9,
+		CLUSTER_LAYOUT = 1 << 10
 	};
 
 	enum class FormatFlags {
@@ -122,6 +125,7 @@ struct SequenceFile {
 	virtual size_t id_len(const SeqInfo& seq_info, const SeqInfo& seq_info_next) = 0;
 	virtual void seek_offset(size_t p) = 0;
 	virtual void read_seq_data(Letter* dst, size_t len, size_t& pos, bool seek) = 0;
+	virtual void decode_seq_data(SequenceSet& seqs);
 	virtual void read_id_data(const int64_t oid, char* dst, size_t len) = 0;
 	virtual void skip_id_data() = 0;
 	virtual std::string seqid(OId oid) const;
@@ -198,6 +202,12 @@ struct SequenceFile {
 	static SequenceFile* auto_create(const std::vector<std::string>& path, Flags flags = Flags::NONE, Metadata metadata = Metadata(), const ValueTraits& value_traits = amino_acid_traits);
 
 	size_t mem_size() const {
+		if (!acc2oid_.empty() || !block_to_dict_id_.empty())
+			std::terminate();
+		return dict_mem_size();
+	}
+
+	size_t dict_mem_size() const {
 		size_t n = 0;
 		for (auto& v : dict_oid_)
 			n += v.size() * sizeof(OId);
@@ -209,8 +219,6 @@ struct SequenceFile {
 			n += v.raw_len();
 		for (auto& v : dict_self_aln_score_)
 			n += v.size() * sizeof(double);
-		if (!acc2oid_.empty() || !block_to_dict_id_.empty())
-			std::terminate();
 		return n;
 	}
 
@@ -222,6 +230,7 @@ protected:
 	void free_dictionary();
 	static size_t dict_block(const size_t ref_block);
 	void build_acc_to_oid();
+	std::vector<OId> find_indexed_accession(const std::string& accession) const;
 	std::pair<int64_t, int64_t> read_fai_file(const std::string& file_name, int64_t seqs, int64_t letters);
 	void add_seqid_mapping(const std::string& id, OId oid);
 
@@ -238,6 +247,8 @@ protected:
 	std::vector<std::vector<double>> dict_self_aln_score_;
 	std::unique_ptr<TaxonomyNodes> taxon_nodes_;
 	std::unordered_map<std::string, OId> acc2oid_;
+	std::unique_ptr<AccessionIndex> acc_index_;
+	std::unique_ptr<ClusterLayout> cluster_layout_;
 	std::unique_ptr<Util::Tsv::File> seqid_file_;
 	std::vector<Loc> seq_length_;
 	StringSet acc_;
@@ -0,0 +1,288 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2024 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <buchfink@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#include <algorithm>
+#include "sequence_file_view.h"
+
+using std::vector;
+using std::string;
+using std::pair;
+using std::shared_ptr;
+using std::runtime_error;
+
+// Maximum distance between requested OIds up to which the position array of the parent is read
+// sequentially instead of seeking.
+static const OId MAX_SCAN_DISTANCE = 256;
+
+static vector<OId> oid_list(const BitVector& filter) {
+	vector<OId> v;
+	v.reserve(filter.one_count());
+	for (OId i = 0; i < (OId)filter.size(); ++i)
+		if (filter.get(i))
+			v.push_back(i);
+	return v;
+}
+
+SequenceFileView::SequenceFileView(const shared_ptr<SequenceFile>& parent, vector<OId>&& oids) :
+	SequenceFile(SequenceFile::Type::VIEW, Alphabet::STD, Flags::NONE, FormatFlags::TITLES_LAZY | FormatFlags::DICT_LENGTHS | FormatFlags::SEEKABLE | FormatFlags::LENGTH_LOOKUP),
+	parent_(parent),
+	oids_(std::move(oids)),
+	letters_(0),
+	oid_(0)
+{
+	init();
+}
+
+SequenceFileView::SequenceFileView(const shared_ptr<SequenceFile>& parent, const BitVector& filter) :
+	SequenceFileView(parent, oid_list(filter))
+{
+}
+
+bool SequenceFileView::supported(const SequenceFile& parent) {
+	return parent.type() == Type::DMND || parent.type() == Type::VIEW;
+}
+
+void SequenceFileView::init() {
+	if (!supported(*parent_))
+		throw OperationNotSupported();
+	vector<pair<OId, OId>> sorted;
+	sorted.reserve(oids_.size());
+	for (OId i = 0; i < (OId)oids_.size(); ++i) {
+		if (oids_[i] < 0 || oids_[i] >= parent_->sequence_count())
+			throw runtime_error("OId out of bounds.");
+		sorted.emplace_back(oids_[i], i);
+	}
+	std::sort(sorted.begin(), sorted.end());
+	entries_.resize(oids_.size());
+	OId next = -1;
+	SeqInfo r;
+	for (const auto& p : sorted) {
+		if (next < 0 || p.first < next || p.first - next > MAX_SCAN_DISTANCE) {
+			parent_->set_seqinfo_ptr(p.first);
+			parent_->init_seqinfo_access();
+			r = parent_->read_seqinfo();
+			next = p.first;
+		}
+		while (next < p.first) {
+			r = parent_->read_seqinfo();
+			++next;
+		}
+		const SeqInfo r_next = parent_->read_seqinfo();
+		entries_[p.second] = { r.pos, r.seq_len, (uint32_t)parent_->id_len(r, r_next) };
+		letters_ += r.seq_len;
+		r = r_next;
+		++next;
+	}
+	parent_->set_seqinfo_ptr(0);
+}
+
+int64_t SequenceFileView::file_count() const {
+	return 1;
+}
+
+bool SequenceFileView::files_synced() {
+	return true;
+}
+
+SequenceFile::SeqInfo SequenceFileView::read_seqinfo() {
+	if (oid_ >= (OId)oids_.size()) {
+		++oid_;
+		return SeqInfo(0, 0);
+	}
+	const OId i = oid_++;
+	return SeqInfo(i, entries_[i].len);
+}
+
+void SequenceFileView::putback_seqinfo() {
+	--oid_;
+}
+
+void SequenceFileView::close() {
+}
+
+void SequenceFileView::set_seqinfo_ptr(OId i) {
+	oid_ = i;
+}
+
+OId SequenceFileView::tell_seq() const {
+	return oid_;
+}
+
+bool SequenceFileView::eof() const {
+	return oid_ >= (OId)oids_.size();
+}
+
+void SequenceFileView::init_seq_access() {
+	set_seqinfo_ptr(0);
+}
+
+bool SequenceFileView::read_seq(vector<Letter>& seq, string& id, std::vector<char>* quals)
+{
+	if (oid_ >= (OId)oids_.size())
+		return false;
+	parent_->set_seqinfo_ptr(oids_[oid_]);
+	parent_->seek_offset(entries_[oid_].pos);
+	++oid_;
+	return parent_->read_seq(seq, id, quals);
+}
+
+void SequenceFileView::create_partition_balanced(int64_t max_letters) {
+	throw OperationNotSupported();
+}
+
+void SequenceFileView::save_partition(const string& partition_file_name, const string& annotation) {
+	throw OperationNotSupported();
+}
+
+int SequenceFileView::get_n_partition_chunks() {
+	throw OperationNotSupported();
+}
+
+void SequenceFileView::init_seqinfo_access() {
+}
+
+void SequenceFileView::seek_chunk(const Chunk& chunk) {
+	throw OperationNotSupported();
+}
+
+std::string SequenceFileView::seqid(OId oid) const {
+	return parent_->seqid(oids_[oid]);
+}
+
+std::string SequenceFileView::dict_title(DictId dict_id, const size_t ref_block) const {
+	const size_t b = dict_block(ref_block);
+	if (b >= dict_oid_.size() || dict_id >= (DictId)dict_oid_[b].size())
+		throw std::runtime_error("Dictionary not loaded.");
+	return Block::dict_title(seqid(dict_oid_[b][dict_id]).c_str());
+}
+
+size_t SequenceFileView::id_len(const SeqInfo& seq_info, const SeqInfo& seq_info_next) {
+	return entries_[seq_info.pos].id_len;
+}
+
+void SequenceFileView::seek_offset(size_t p) {
+}
+
+void SequenceFileView::read_seq_data(Letter* dst, size_t len, size_t& pos, bool seek) {
+	size_t parent_pos = entries_[pos].pos;
+	parent_->read_seq_data(dst, len, parent_pos, true);
+	++pos;
+}
+
+void SequenceFileView::decode_seq_data(SequenceSet& seqs) {
+	parent_->decode_seq_data(seqs);
+}
+
+void SequenceFileView::read_id_data(const int64_t oid, char* dst, size_t len) {
+	parent_->read_id_data(oids_[oid], dst, len);
+}
+
+void SequenceFileView::skip_id_data() {
+	parent_->skip_id_data();
+}
+
+int64_t SequenceFileView::sequence_count() const {
+	return oids_.size();
+}
+
+size_t SequenceFileView::letters() const {
+	return letters_;
+}
+
+int SequenceFileView::db_version() const {
+	return parent_->db_version();
+}
+
+int SequenceFileView::program_build_version() const {
+	return parent_->program_build_version();
+}
+
+SequenceFile::Metadata SequenceFileView::metadata() const {
+	return Metadata();
+}
+
+int SequenceFileView::build_version() {
+	return parent_->build_version();
+}
+
+SequenceFileView::~SequenceFileView()
+{
+}
+
+void SequenceFileView::close_weakly()
+{
+	parent_->close_weakly();
+}
+
+void SequenceFileView::reopen()
+{
+	parent_->reopen();
+}
+
+BitVector* SequenceFileView::filter_by_accession(const std::string& file_name)
+{
+	throw OperationNotSupported();
+}
+
+const BitVector* SequenceFileView::builtin_filter()
+{
+	return nullptr;
+}
+
+std::string SequenceFileView::file_name()
+{
+	return parent_->file_name();
+}
+
+int64_t SequenceFileView::sparse_sequence_count() const
+{
+	return sequence_count();
+}
+
+std::vector<TaxId> SequenceFileView::taxids(size_t oid) const
+{
+	return parent_->taxids(oids_[oid]);
+}
+
+void SequenceFileView::seq_data(size_t oid, std::vector<Letter>& dst) const
+{
+	parent_->seq_data(oids_[oid], dst);
+}
+
+size_t SequenceFileView::seq_length(size_t oid) const
+{
+	if (oid < entries_.size())
+		return entries_[oid].len;
+	throw std::out_of_range("SequenceFileView::seq_length");
+}
+
+void SequenceFileView::init_random_access(const size_t query_block, const size_t ref_blocks, bool dictionary)
+{
+	parent_->init_random_access(query_block, ref_blocks, false);
+	if (dictionary)
+		load_dictionary(query_block, ref_blocks);
+}
+
+void SequenceFileView::end_random_access(bool dictionary)
+{
+	if (!dictionary)
+		return;
+	free_dictionary();
+}
@@ -0,0 +1,110 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2024 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <buchfink@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#pragma once
+#include <memory>
+#include "sequence_file.h"
+#include "fasta/fasta_file.h"
+
+// Read-only view of a subset of the sequences of a database. OId i of the view refers to
+// OId oids[i] of the parent, sequence data and titles are read from the parent on demand.
+// The parent needs to be a .dmnd file or another view.
+struct SequenceFileView : public SequenceFile
+{
+
+	SequenceFileView(const std::shared_ptr<SequenceFile>& parent, std::vector<OId>&& oids);
+	SequenceFileView(const std::shared_ptr<SequenceFile>& parent, const BitVector& filter);
+
+	static bool supported(const SequenceFile& parent);
+
+	virtual int64_t file_count() const override;
+	virtual void create_partition_balanced(int64_t max_letters) override;
+	virtual void save_partition(const std::string& partition_file_name, const std::string& annotation = "") override;
+	virtual int get_n_partition_chunks() override;
+	virtual void close() override;
+	virtual void set_seqinfo_ptr(OId i) override;
+	virtual OId tell_seq() const override;
+	virtual bool eof() const override;
+	virtual bool files_synced() override;
+	virtual void init_seq_access() override;
+	virtual void init_seqinfo_access() override;
+	virtual void seek_chunk(const Chunk& chunk) override;
+	virtual SeqInfo read_seqinfo() override;
+	virtual void putback_seqinfo() override;
+	virtual size_t id_len(const SeqInfo& seq_info, const SeqInfo& seq_info_next) override;
+	virtual void seek_offset(size_t p) override;
+	virtual void read_seq_data(Letter* dst, size_t len, size_t& pos, bool seek) override;
+	virtual void decode_seq_data(SequenceSet& seqs) override;
+	virtual void read_id_data(const int64_t oid, char* dst, size_t len) override;
+	virtual void skip_id_data() override;
+	virtual std::string seqid(OId oid) const override;
+	virtual std::string dict_title(DictId dict_id, const size_t ref_block) const override;
+	virtual int64_t sequence_count() const override;
+	virtual bool read_seq(std::vector<Letter>& seq, std::string& id, std::vector<char>* quals = nullptr) override;
+	virtual size_t letters() const override;
+	virtual int db_version() const override;
+	virtual int program_build_version() const override;
+	virtual Metadata metadata() const override;
+	virtual int build_version() override;
+	virtual ~SequenceFileView();
+	virtual void close_weakly() override;
+	virtual void reopen() override;
+	virtual BitVector* filter_by_accession(const std::string& file_name) override;
+	virtual const BitVector* builtin_filter() override;
+	virtual std::string file_name() override;
+	virtual int64_t sparse_sequence_count() const override;
+	virtual std::vector<TaxId> taxids(size_t oid) const override;
+	virtual void seq_data(size_t oid, std::vector<Letter>& dst) const override;
+	virtual size_t seq_length(size_t oid) const override;
+	virtual void init_random_access(const size_t query_block, const size_t ref_blocks, bool dictionary = true) override;
+	virtual void end_random_access(bool dictionary = true) override;
+
+	const std::vector<OId>& parent_oids() const {
+		return oids_;
+	}
+
+private:
+
+	void init();
+
+	struct Entry {
+		uint64_t pos;
+		uint32_t len;
+		uint32_t id_len;
+	};
+
+	const std::shared_ptr<SequenceFile> parent_;
+	const std::vector<OId> oids_;
+	std::vector<Entry> entries_;
+	size_t letters_;
+	OId oid_;
+
+};
+
+// Returns a view of the given sequences of db if the format supports it, otherwise the
+// sequences are written to a temporary FASTA file.
+template<typename It>
+SequenceFile* sub_db_view(const std::shared_ptr<SequenceFile>& db, It begin, It end) {
+	if (SequenceFileView::supported(*db))
+		return new SequenceFileView(db, std::vector<OId>(begin, end));
+	SequenceFile* f = db->sub_db(begin, end);
+	f->set_seqinfo_ptr(0);
+	return f;
+}
@@ -3,7 +3,8 @@
 
 namespace DP {
 
-	enum class Flags { NONE = 0, PARALLEL = 1, FULL_MATRIX = 2, SEMI_GLOBAL = 4 };
+	// THREAD_POOL runs the PARALLEL stages as tasks on the align thread pool instead of on threads of their own.
+	enum class Flags { NONE = 0, PARALLEL = 1, FULL_MATRIX = 2, SEMI_GLOBAL = 4, THREAD_POOL = 8 };
 
 	DEFINE_ENUM_FLAG_OPERATORS(Flags)
 
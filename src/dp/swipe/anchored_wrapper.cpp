@@ -92,11 +92,13 @@ static void add_target(DpTarget& t, TargetVector& targets,
 static void swipe_threads(DP::AnchoredSwipe::Target<int16_t>* targets, int64_t count, const DP::AnchoredSwipe::Options& options, const DP::AnchoredSwipe::Config& cfg) {
 	using Target = DP::AnchoredSwipe::Target<int16_t>;
 	ThreadPool::TaskSet task_set(*cfg.thread_pool, 0);
-	int64_t size = 0;
+	int64_t size = 0, cells = 0;
 	Target* i0 = targets, *i1 = targets, *end = targets + count;
 	while (i1 < end) {
 		const auto n = std::min((ptrdiff_t)16, end - i1);
-		size += accumulate(i1, i1 + n, (int64_t)0, [](int64_t n, const Target& t) {return n + t.gross_cells(); });
+		const int64_t c = accumulate(i1, i1 + n, (int64_t)0, [](int64_t n, const Target& t) {return n + t.gross_cells(); });
+		size += c;
+		cells += c;
 		i1 += n;
 		if (size >= config.swipe_task_size) {
 #if ARCH_ID == 2
@@ -108,6 +110,7 @@ static void swipe_threads(DP::AnchoredSwipe::Target<int16_t>* targets, int64_t c
 			size = 0;
 		}
 	}
+	cfg.stats.inc(Statistics::GROSS_DP_CELLS, cells);
 	if (task_set.total() == 0) {
 		cfg.stats.inc(Statistics::SWIPE_TASKS_TOTAL);
 #if ARCH_ID == 2
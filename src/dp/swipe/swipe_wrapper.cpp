@@ -253,7 +253,7 @@ static list<Hsp> swipe_threads(const It begin, const It end, vector<DpTarget> &o
 		return {};
 
 	atomic<BlockId> next(0);
-	if (flag_any(p.flags, Flags::PARALLEL)) {
+	if (flag_any(p.flags, Flags::PARALLEL) && !flag_any(p.flags, Flags::THREAD_POOL)) {
 		TaskTimer timer("Banded swipe (run)", config.target_parallel_verbosity);
 		const size_t n = config.threads_align ? config.threads_align : config.threads_;
 		vector<thread> threads;
@@ -416,6 +416,9 @@ list<Hsp> swipe(const Targets &targets, Params& p)
 			round_targets.reserve(targets[bin].size() + result.second.size());
 			round_targets.insert(round_targets.end(), targets[bin].begin(), targets[bin].end());
 			round_targets.insert(round_targets.end(), result.second.begin(), result.second.end());
+#ifndef DP_STAT
+			p.stat.inc(Statistics::GROSS_DP_CELLS, accumulate(round_targets.begin(), round_targets.end(), (int64_t)0, [&p](int64_t n, const DpTarget& t) { return n + t.cells(p.flags, p.query.length()); }));
+#endif
 			result = swipe_bin(bin, round_targets.begin(), round_targets.end(), 0, p);
 			if(algo_bin == 0)
 				out.splice(out.end(), result.first);
@@ -0,0 +1,133 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2024 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <buchfink@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#include <algorithm>
+#include <cmath>
+#include "config.h"
+#include "../basic/config.h"
+#include "../data/block/block.h"
+#include "../data/sequence_file.h"
+#include "../data/seed_array.h"
+#include "../search/search.h"
+#include "../search/hit.h"
+#include "../util/string/string.h"
+#include "../util/system/system.h"
+#include "../util/log_stream.h"
+
+using std::endl;
+
+namespace Search {
+
+// Share of the memory limit available to sequences and seed arrays, the rest is left to the
+// extension stage (seed hit bins, alignment buffers).
+static const double INDEX_MEMORY_FRACTION = 0.75;
+// Share of the memory limit that one bin of seed hits may occupy.
+static const double BIN_MEMORY_FRACTION = 0.125;
+static const unsigned MAX_INDEX_CHUNKS = 64, MIN_QUERY_BINS = 4, MAX_QUERY_BINS = 1024;
+static const uint32_t MIN_TILE_SIZE = 256, MAX_TILE_SIZE = 4096;
+// Size of a stage 1 seed fingerprint (48 letters).
+static const size_t FINGERPRINT_SIZE = 48;
+static const double MIN_BLOCK_SIZE = 1e6;
+
+static uint32_t tile_size() {
+	const size_t l3 = l3_cache_size();
+	if (l3 == 0)
+		return config.tile_size;
+	// Two tiles of fingerprints per thread should fit into its share of the L3 cache.
+	const size_t n = l3 / std::max(config.threads_, 1) / (2 * FINGERPRINT_SIZE);
+	uint32_t t = MIN_TILE_SIZE;
+	while (t * 2 <= n && t < MAX_TILE_SIZE)
+		t *= 2;
+	return t;
+}
+
+// The cost model assumes that the time for building seed arrays scales with the number of index
+// chunks (every chunk enumerates all seeds of a block), that the query seed arrays are rebuilt for
+// every reference block, and that the join, stage 1 and extension work is independent of the
+// blocking. Among the configurations that fit into the memory limit, the one with the lowest
+// estimated time for the rest of the database is chosen.
+void auto_tune(Config& cfg) {
+	const TuningSample& s = cfg.tuning;
+	const double ref_letters = (double)cfg.target->seqs().letters(),
+		query_letters = (double)cfg.query->seqs().letters(),
+		block_size = (double)config.block_size(),
+		remaining = std::max((double)cfg.db_letters - ref_letters, 0.0);
+	if (ref_letters == 0.0 || remaining == 0.0)
+		return;
+
+	double memory = (double)Util::String::interpret_number(config.memory_limit.get(DEFAULT_MEMORY_LIMIT));
+	const double ram = total_ram() * 1e9;
+	if (ram > 0.0)
+		memory = std::min(memory, ram);
+	const double budget = memory * INDEX_MEMORY_FRACTION;
+	const size_t entry_size = keep_target_id(cfg) ? sizeof(SeedArray<PackedLocId>::Entry) : sizeof(SeedArray<PackedLoc>::Entry);
+	// Later query blocks are loaded with the tuned block size if the query file is not exhausted.
+	const bool query_scales = cfg.query_file && !cfg.query_file->eof();
+
+	const double query_fraction = query_letters / (query_letters + ref_letters),
+		query_index_time = s.seed_array_time * query_fraction / cfg.index_chunks,
+		ref_index_time = s.seed_array_time * (1.0 - query_fraction) / cfg.index_chunks,
+		other_time = (s.join_time + s.stage1_time + s.extension_time) * remaining / ref_letters;
+
+	verbose_stream << "Auto-tune: seed array build rate = " << (s.query_seeds + s.ref_seeds) / std::max(s.seed_array_time, 1e-9) << " seeds/s" << endl;
+	verbose_stream << "Auto-tune: join throughput = " << (s.query_seeds + s.ref_seeds) / std::max(s.join_time, 1e-9) << " seeds/s" << endl;
+	verbose_stream << "Auto-tune: stage 1 rate = " << s.seed_hits / std::max(s.stage1_time, 1e-9) << " seed hits/s" << endl;
+	verbose_stream << "Auto-tune: extension rate = " << s.stored_hits / std::max(s.extension_time, 1e-9) << " seed hits/s" << endl;
+	verbose_stream << "Auto-tune: L3 cache = " << l3_cache_size() << ", RAM = " << (int64_t)ram << ", memory limit = " << (int64_t)memory << endl;
+
+	const unsigned max_chunks = config.algo == ::Config::Algo::DOUBLE_INDEXED ? MAX_INDEX_CHUNKS : 1;
+	double best_time = INFINITY, best_block_size = 0.0;
+	unsigned best_chunks = 0;
+	for (unsigned c = 1; c <= max_chunks; c *= 2) {
+		const double ref_bytes = (double)cfg.target->mem_size() / ref_letters + (double)entry_size * cfg.target->hst().max_chunk_size(c) / ref_letters,
+			query_bytes = (double)cfg.query->mem_size() + (double)entry_size * cfg.query->hst().max_chunk_size(c);
+		double b = query_scales ? budget / (ref_bytes + query_bytes / block_size) : (budget - query_bytes) / ref_bytes;
+		b = std::min(b, remaining);
+		if (b < MIN_BLOCK_SIZE)
+			continue;
+		const double t = std::ceil(remaining / b) * query_index_time * c + ref_index_time * c * remaining / ref_letters + other_time;
+		verbose_stream << "Auto-tune: index chunks = " << c << ", block size = " << (int64_t)b << ", estimated time = " << t << "s" << endl;
+		if (t < best_time) {
+			best_time = t;
+			best_block_size = b;
+			best_chunks = c;
+		}
+	}
+	if (best_chunks == 0) {
+		message_stream << "Auto-tune: no configuration fits into the memory limit, keeping the current parameters." << endl;
+		return;
+	}
+
+	const double hits = (double)s.stored_hits / ref_letters * best_block_size * (query_scales ? best_block_size / block_size : 1.0);
+	const unsigned bins = (unsigned)std::min(std::max(std::ceil(hits * sizeof(Hit) / (memory * BIN_MEMORY_FRACTION)), (double)MIN_QUERY_BINS), (double)MAX_QUERY_BINS);
+
+	config.chunk_size = best_block_size / 1e9;
+	config.lowmem_ = cfg.index_chunks = best_chunks;
+	config.query_bins_ = cfg.query_bins = bins;
+	config.tile_size = tile_size();
+	cfg.ref_blocks = cfg.current_ref_block + 1 + (uint64_t)std::ceil(remaining / best_block_size);
+
+	message_stream << "Auto-tune: block size = " << config.chunk_size << ", index chunks = " << config.lowmem_ << ", query bins = " << config.query_bins_
+		<< ", tile size = " << config.tile_size << " (estimated time for the remaining database = " << best_time << "s)" << endl;
+	message_stream << "Auto-tune: use -b" << config.chunk_size << " -c" << config.lowmem_ << " --bin " << config.query_bins_ << " --tile-size " << config.tile_size
+		<< " to reproduce these settings." << endl;
+}
+
+}
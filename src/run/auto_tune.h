@@ -0,0 +1,38 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2024 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <buchfink@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#pragma once
+#include <stdint.h>
+
+namespace Search {
+
+struct Config;
+
+// Timings and work counts of the processed reference blocks, used by --auto-tune.
+struct TuningSample {
+	double seed_array_time = 0.0, join_time = 0.0, stage1_time = 0.0, extension_time = 0.0;
+	int64_t query_seeds = 0, ref_seeds = 0, seed_hits = 0, stored_hits = 0;
+};
+
+// Chooses block size, index chunks, query bins and tile size for the remainder of the run based on
+// the sample of the first reference block. Must be called before the reference block is deallocated.
+void auto_tune(Config& cfg);
+
+}
@@ -26,6 +26,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../util/data_structures/bit_vector.h"
 #include "../util/scores/cutoff_table.h"
 #include "../stats/dna_scoring/build_score.h"
+#include "auto_tune.h"
 
 struct SequenceFile;
 struct Consumer;
@@ -137,6 +138,7 @@ struct Config {
 	Util::Scores::CutoffTable2D cutoff_gapped1_new, cutoff_gapped2_new;
 
 	BlockId                                    iteration_query_aligned;
+	TuningSample                               tuning;
 
 	std::unique_ptr<ThreadPool>                thread_pool;
 
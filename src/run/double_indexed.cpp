@@ -55,6 +55,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "config.h"
 #include "../data/seed_array.h"
 #include "../data/fasta/fasta_file.h"
+#include "../util/metrics.h"
+#include "../util/memory/memory_tracker.h"
+#include "../util/status.h"
+#include "../util/string/string.h"
 
 #ifdef WITH_DNA
 #include "../dna/dna_index.h"
@@ -116,6 +120,7 @@ static void run_ref_chunk(SequenceFile &db_file,
 	PtrVector<TempFile> &tmp_file,
 	Config& cfg)
 {
+	Util::Metrics::set_context(Util::Metrics::Context::REF_BLOCK, (int)cfg.current_ref_block);
 	TaskTimer timer;
 	log_rss();
 	auto& query_seqs = cfg.query->seqs();
@@ -139,7 +144,7 @@ static void run_ref_chunk(SequenceFile &db_file,
 
 	if (flag_any(cfg.output_format->flags, Output::Flags::SELF_ALN_SCORES)) {
 		timer.go("Computing self alignment scores");
-		cfg.target->compute_self_aln();
+		cfg.target->compute_self_aln(cfg.lazy_masking ? MaskingAlgo::NONE : cfg.target_masking);
 	}
 
 	const bool daa = *cfg.output_format == OutputFormat::daa;
@@ -152,6 +157,8 @@ static void run_ref_chunk(SequenceFile &db_file,
 			db_file.init_dict_block(cfg.current_ref_block, cfg.target->seqs().size(), persist_dict);
 	}
 
+	Util::Memory::set(Util::Memory::Tag::TARGET_BLOCK, cfg.target->mem_size());
+
 	timer.go("Initializing temporary storage");
 	if (config.global_ranking_targets)
 		;// cfg.global_ranking_buffer.reset(new Config::RankingBuffer());
@@ -191,10 +198,12 @@ static void run_ref_chunk(SequenceFile &db_file,
             for (unsigned i = 0; i < shapes.count(); ++i) {
                 if(config.global_ranking_targets)
                     cfg.global_ranking_buffer.reset(new Config::RankingBuffer());
+                Util::Metrics::set_context(Util::Metrics::Context::SHAPE, (int)i);
                 search_shape(i, cfg.current_query_block, query_iteration, query_buffer, ref_buffer, cfg, target_seeds); //index_targets(0,cfg,ref_buffer,target_seeds);
                 if (config.global_ranking_targets)
                     Extension::GlobalRanking::update_table(cfg);
             }
+            Util::Metrics::set_context(Util::Metrics::Context::SHAPE, -1);
         }
 #ifdef WITH_DNA
         else
@@ -207,8 +216,8 @@ static void run_ref_chunk(SequenceFile &db_file,
 #ifdef WITH_DNA
         if(config.command != ::Config::blastn)
 #endif
-		delete[] ref_buffer;
-		delete[] query_buffer;
+		Util::Memory::deallocate(ref_buffer);
+		Util::Memory::deallocate(query_buffer);
 		delete target_seeds;
 
 		timer.go("Clearing query masking");
@@ -239,18 +248,31 @@ static void run_ref_chunk(SequenceFile &db_file,
 	}
 	else {
 		timer.go("Computing alignments");
+		for (int i = 0; i < cfg.seed_hit_buf->bins(); ++i)
+			cfg.tuning.stored_hits += cfg.seed_hit_buf->bin_size(i);
 		align_queries(out, cfg);
+		cfg.tuning.extension_time += timer.microseconds() / 1e6;
 		cfg.seed_hit_buf.reset();
+		Util::Memory::set(Util::Memory::Tag::DICTIONARY, db_file.dict_mem_size());
 	}
 
 	if (temp_output)
 		IntermediateRecord::finish_file(*out);
 
+	if (config.auto_tune && cfg.current_query_block == 0 && cfg.current_ref_block == 0 && query_iteration == 0 && cfg.blocked_processing
+		&& !config.self && !config.global_ranking_targets && !config.swipe_all && config.command != ::Config::blastn) {
+		timer.go("Auto-tuning parameters");
+		auto_tune(cfg);
+	}
+
 	timer.go("Deallocating reference");
 	cfg.target.reset();
 	cfg.db->close_dict_block(persist_dict);
+	Util::Memory::set(Util::Memory::Tag::TARGET_BLOCK, 0);
+	Util::Memory::set(Util::Memory::Tag::DICTIONARY, db_file.dict_mem_size());
 
 	timer.finish();
+	Util::Metrics::set_context(Util::Metrics::Context::REF_BLOCK, -1);
 }
 
 static void run_query_iteration(const unsigned query_iteration,
@@ -413,7 +435,9 @@ static void run_query_iteration(const unsigned query_iteration,
 			}
 			if (options.target->empty()) break;
 			timer.finish();
+			Util::Status::set_work(options.current_ref_block, options.ref_blocks);
 			run_ref_chunk(db_file, query_iteration, master_out, tmp_file, options);
+			Util::Status::set_work(options.current_ref_block + 1, std::max(options.ref_blocks, (uint64_t)options.current_ref_block + 1));
 		}
 		log_rss();
 	}
@@ -443,6 +467,9 @@ static void run_query_chunk(Consumer &master_out,
 	OutputFile *aligned_file,
 	Config &options)
 {
+	Util::Metrics::set_context(Util::Metrics::Context::QUERY_BLOCK, (int)options.current_query_block);
+	Util::Memory::set(Util::Memory::Tag::QUERY_BLOCK, options.query->mem_size());
+	Util::Status::set_query_block(options.current_query_block, options.self ? (int64_t)options.db->total_blocks() : -1);
 	auto P = Parallelizer::get();
 	TaskTimer timer;
 	auto& db_file = *options.db;
@@ -455,7 +482,7 @@ static void run_query_chunk(Consumer &master_out,
 	}
 	if (flag_any(options.output_format->flags, Output::Flags::SELF_ALN_SCORES)) {
 		timer.go("Computing self alignment scores");
-		options.query->compute_self_aln();
+		options.query->compute_self_aln(options.query_masking);
 	}
 
 	log_rss();
@@ -550,6 +577,9 @@ static void run_query_chunk(Consumer &master_out,
 
 	timer.go("Deallocating queries");
 	options.query.reset();
+	Util::Memory::set(Util::Memory::Tag::QUERY_BLOCK, 0);
+	timer.finish();
+	Util::Metrics::set_context(Util::Metrics::Context::QUERY_BLOCK, -1);
 }
 
 static void master_thread(TaskTimer &total_timer, Config &options)
@@ -741,6 +771,7 @@ static void master_thread(TaskTimer &total_timer, Config &options)
 	log_rss();
 	message_stream << "Total time = " << total_timer.get() << "s" << endl;
 	statistics.print();
+	Util::Memory::log_peaks();
 	//print_warnings();
 }
 
@@ -761,6 +792,7 @@ void run(const shared_ptr<SequenceFile>& db, const shared_ptr<SequenceFile>& que
 	Config cfg;
 	cfg.output_format.reset(init_output(cfg.max_target_seqs));
 	statistics.reset();
+	Util::Memory::set_limit(Util::String::interpret_number(config.memory_limit.get(DEFAULT_MEMORY_LIMIT)));
 
 	const bool taxon_filter = !config.taxonlist.empty() || !config.taxon_exclude.empty();
 	const bool taxon_culling = config.taxon_k != 0;
@@ -784,6 +816,8 @@ void run(const shared_ptr<SequenceFile>& db, const shared_ptr<SequenceFile>& que
 		flags |= SequenceFile::Flags::TARGET_SEQS;
 	if (flag_any(cfg.output_format->flags, Output::Flags::SELF_ALN_SCORES))
 		flags |= SequenceFile::Flags::SELF_ALN_SCORES;
+	if (flag_any(cfg.output_format->flags, Output::Flags::SELF_ALN_SCORES) || config.linsearch || cfg.min_length_ratio > 0.0)
+		flags |= SequenceFile::Flags::CLUSTER_LAYOUT;
 	if (!config.unaligned_targets.empty())
 		flags |= SequenceFile::Flags::OID_TO_ACC_MAPPING;
 	if (db) {
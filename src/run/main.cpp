@@ -33,6 +33,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../util/simd.h"
 #include "../data/dmnd/dmnd.h"
 #include "../util/command_line_parser.h"
+#include "../util/metrics.h"
+#include "../util/trace.h"
+#include "../util/status.h"
+#include "../align/replay.h"
 
 using std::cout;
 using std::cerr;
@@ -94,13 +98,25 @@ void recluster();
 namespace Incremental {
 }}
 
+// Writes the run reports after an error. Errors while doing so must not replace the original error.
+static void report_error(const string& error) {
+	try {
+		Util::Status::finish(true);
+		Util::Metrics::write(error);
+	}
+	catch (...) {
+	}
+}
+
 int main(int ac, const char* av[])
 {
 	try {
 		init_motif_table();
 		CommandLineParser parser;
 		config = Config(ac, av, true, parser);
-
+		Util::Metrics::init(config.metrics_file, config.perf_counters);
+		Util::Trace::init(config.trace_out);
+		Util::Status::init(config.status_file, config.status_interval);
 
 		switch (config.command) {
 		case Config::help:
@@ -178,6 +194,9 @@ int main(int ac, const char* av[])
 		case Config::benchmark:
 			Benchmark::benchmark();
 			break;
+		case Config::REPLAY:
+			Replay::run();
+			break;
 		case Config::split:
 			split();
 			break;
@@ -263,21 +282,28 @@ int main(int ac, const char* av[])
 		default:
 			return 1;
 		}
+		Util::Status::finish();
+		Util::Metrics::write();
+		Util::Trace::write();
 	}
 	catch (const std::bad_alloc &e) {
 		cerr << "Failed to allocate sufficient memory. Please refer to the manual for instructions on memory usage." << endl;
 		log_stream << "Error: " << e.what() << endl;
+		report_error(e.what());
 		return 1;
 	}
-	catch (const FileOpenException&) {
+	catch (const FileOpenException& e) {
+		report_error(e.what());
 		return 1;
 	} catch(const std::exception& e) {
         cerr << "Error: " << e.what() << endl;
         log_stream << "Error: " << e.what() << endl;
+        report_error(e.what());
         return 1;
     }
     catch(...) {
         cerr << "Exception of unknown type!" << endl;
+        report_error("Exception of unknown type");
         return 1;
     }
 
@@ -34,6 +34,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../util/data_structures/deque.h"
 #include "../util/util.h"
 #include "../util/async_buffer.h"
+#include "../util/trace.h"
 #include "seed_complexity.h"
 
 using std::vector;
@@ -58,6 +59,7 @@ static void seed_join_worker(
 	if (bits != ref_seeds->key_bits)
 		throw std::runtime_error("Joining seed arrays with different key lengths.");
 	while ((p = (*seedp)++) < seedp_range->end()) {
+		Util::Trace::Span span("Hash join partition");
 		std::pair<DoubleArray<SeedLoc>, DoubleArray<SeedLoc>> join = hash_join(
 			Relation<typename SeedArray<SeedLoc>::Entry>(query_seeds->begin(p), query_seeds->size(p)),
 			Relation<typename SeedArray<SeedLoc>::Entry>(ref_seeds->begin(p), ref_seeds->size(p)),
@@ -82,6 +84,7 @@ static void search_worker(atomic<unsigned> *seedp, const SeedPartitionRange *see
 #endif
 	int p;
 	while ((p = (*seedp)++) < seedp_range->end()) {
+		Util::Trace::Span span("Stage 1 partition");
 		auto it = JoinIterator<SeedLoc>(query_seed_hits[p].begin(), ref_seed_hits[p].begin());
 		run_stage1(it, work_set.get(), cfg);
 	}
@@ -122,6 +125,7 @@ void search_shape(unsigned sid, int query_block, unsigned query_iteration, char
 			//ref_idx = new SeedArray(ref_seqs, sid, range, query_seeds_hashed.get(), true);
 		else
 			ref_idx = new SA(*cfg.target, ref_hst.get(sid), range, ref_buffer, &no_filter, enum_ref);
+		cfg.tuning.seed_array_time += timer.microseconds() / 1e6;
 		timer.finish();
 		log_rss();
 
@@ -133,6 +137,9 @@ void search_shape(unsigned sid, int query_block, unsigned query_iteration, char
 			query_idx = new SA(*cfg.query, range, target_seeds, enum_query);
 		else
 			query_idx = new SA(*cfg.query, query_hst.get(sid), range, query_buffer, &no_filter, enum_query);
+		cfg.tuning.seed_array_time += timer.microseconds() / 1e6;
+		cfg.tuning.query_seeds += query_idx->size();
+		cfg.tuning.ref_seeds += ref_idx->size();
 		timer.finish();
 		log_rss();
 
@@ -150,6 +157,7 @@ void search_shape(unsigned sid, int query_block, unsigned query_iteration, char
 			threads.emplace_back(seed_join_worker<SeedLoc>, query_idx, ref_idx, &seedp, &range, query_seed_hits, ref_seed_hits);
 		for (auto &t : threads)
 			t.join();
+		cfg.tuning.join_time += timer.microseconds() / 1e6;
 		timer.finish();
 		log_rss();
 
@@ -179,10 +187,13 @@ void search_shape(unsigned sid, int query_block, unsigned query_iteration, char
 		timer.go("Searching alignments");
 		seedp = range.begin();
 		threads.clear();
+		const stat_type seed_hits = statistics.get(Statistics::SEED_HITS);
 		for (int i = 0; i < config.threads_; ++i)
 			threads.emplace_back(search_worker<SeedLoc>, &seedp, &range, sid, i, query_seed_hits, ref_seed_hits, context, &cfg);
 		for (auto &t : threads)
 			t.join();
+		cfg.tuning.stage1_time += timer.microseconds() / 1e6;
+		cfg.tuning.seed_hits += statistics.get(Statistics::SEED_HITS) - seed_hits;
 		timer.finish();
 		log_rss();
 
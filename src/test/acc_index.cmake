@@ -0,0 +1,40 @@
+# Filters a database by an accession list with and without the accession index (makeidx --accessions)
+# and checks that both lookups select the same sequences.
+file(READ ${TEST_DIR}/1.faa S1)
+file(READ ${TEST_DIR}/2.faa S2)
+file(READ ${TEST_DIR}/3.faa S3)
+file(READ ${TEST_DIR}/4.faa S4)
+file(WRITE acc_index_db.faa "${S1}\n${S2}\n${S3}\n${S4}\n")
+file(WRITE acc_index_list.txt "NP_620158.3\nXP_011540306.1\n")
+file(REMOVE acc_index_db.dmnd.acc_idx)
+
+function(run)
+  execute_process(COMMAND ./diamond ${ARGN} RESULT_VARIABLE RESULT OUTPUT_QUIET ERROR_QUIET)
+  if(NOT ${RESULT} EQUAL 0)
+    message(FATAL_ERROR "diamond ${ARGN} failed.")
+  endif()
+endfunction()
+
+run(makedb --in acc_index_db.faa -d acc_index_db)
+run(blastp -q acc_index_db.faa -d acc_index_db --seqidlist acc_index_list.txt -p1 -o acc_index_scan.out)
+run(makeidx -d acc_index_db --accessions)
+if(NOT EXISTS acc_index_db.dmnd.acc_idx)
+  message(FATAL_ERROR "Accession index was not written.")
+endif()
+run(blastp -q acc_index_db.faa -d acc_index_db --seqidlist acc_index_list.txt -p1 -o acc_index_idx.out)
+
+file(READ acc_index_scan.out SCAN)
+file(READ acc_index_idx.out IDX)
+if(SCAN STREQUAL "")
+  message(FATAL_ERROR "acc_index: no hits against the filtered database.")
+endif()
+if(NOT SCAN STREQUAL IDX)
+  message(FATAL_ERROR "acc_index: lookups through the accession index differ from the database scan.")
+endif()
+file(STRINGS acc_index_idx.out LINES)
+foreach(L IN LISTS LINES)
+  string(REGEX MATCH "^[^\t]+\t([^\t]+)" M "${L}")
+  if(NOT CMAKE_MATCH_1 STREQUAL "NP_620158.3" AND NOT CMAKE_MATCH_1 STREQUAL "XP_011540306.1")
+    message(FATAL_ERROR "acc_index: hit against a sequence that is not in the accession list: ${CMAKE_MATCH_1}")
+  endif()
+endforeach()
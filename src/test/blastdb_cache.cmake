@@ -0,0 +1,35 @@
+# Searches a BLAST database with and without --blastdb-cache and checks that the results agree and that an
+# existing cache is reused instead of being rebuilt.
+file(REMOVE_RECURSE blastdb_test)
+file(MAKE_DIRECTORY blastdb_test/cache)
+execute_process(COMMAND ${MAKEBLASTDB} -in ${TEST_DIR}/2.faa -dbtype prot -parse_seqids -out blastdb_test/db RESULT_VARIABLE RESULT OUTPUT_QUIET)
+if(NOT ${RESULT} EQUAL 0)
+  message(FATAL_ERROR "makeblastdb failed.")
+endif()
+
+function(run log)
+  execute_process(COMMAND ./diamond ${ARGN} RESULT_VARIABLE RESULT OUTPUT_QUIET ERROR_VARIABLE ERR)
+  if(NOT ${RESULT} EQUAL 0)
+    message(FATAL_ERROR "diamond ${ARGN} failed: ${ERR}")
+  endif()
+  set(${log} "${ERR}" PARENT_SCOPE)
+endfunction()
+
+run(LOG prepdb -d blastdb_test/db)
+set(ARGS blastp -q ${TEST_DIR}/1.faa -d blastdb_test/db -p1)
+run(LOG ${ARGS} -o blastdb_test/plain.out)
+run(LOG ${ARGS} -o blastdb_test/build.out --blastdb-cache blastdb_test/cache)
+if(NOT LOG MATCHES "Sequence cache written")
+  message(FATAL_ERROR "blastdb_cache: the sequence cache was not built.")
+endif()
+run(LOG ${ARGS} -o blastdb_test/reuse.out --blastdb-cache blastdb_test/cache)
+if(LOG MATCHES "Sequence cache written|will be rebuilt")
+  message(FATAL_ERROR "blastdb_cache: a valid sequence cache was rebuilt.")
+endif()
+
+file(READ blastdb_test/plain.out PLAIN)
+file(READ blastdb_test/build.out BUILD)
+file(READ blastdb_test/reuse.out REUSE)
+if(PLAIN STREQUAL "" OR NOT PLAIN STREQUAL BUILD OR NOT PLAIN STREQUAL REUSE)
+  message(FATAL_ERROR "blastdb_cache: results with the sequence cache differ.")
+endif()
@@ -0,0 +1,57 @@
+# Runs the greedy vertex cover on the same synthetic edge set in memory and out of core (--external-gvc).
+# With a single run of buckets both must give the same clustering, with several runs the result must
+# still assign every node to a centroid that represents itself.
+set(NODES 400)
+set(NODE_LIST "")
+set(EDGE_LIST "")
+math(EXPR LAST "${NODES} - 1")
+foreach(I RANGE ${LAST})
+  string(APPEND NODE_LIST "n${I}\n")
+  foreach(K RANGE 1 4)
+    math(EXPR J "(${I} / 10 * 10 + (${I} * 7 + ${K} * ${K} * 13) % 10 + (${I} % 3) * ${K} * 29) % ${NODES}")
+    math(EXPR W "(${I} + ${J}) % 17 + 1")
+    string(APPEND EDGE_LIST "n${I}\tn${J}\t${W}\n")
+  endforeach()
+endforeach()
+file(WRITE gvc_nodes.tsv "${NODE_LIST}")
+file(WRITE gvc_edges.tsv "${EDGE_LIST}")
+
+function(run OUT)
+  execute_process(COMMAND ./diamond greedy-vertex-cover -d gvc_nodes.tsv --edges gvc_edges.tsv --edge-format triplet --symmetric -p1 -o ${OUT} ${ARGN}
+    RESULT_VARIABLE RESULT OUTPUT_QUIET ERROR_QUIET)
+  if(NOT ${RESULT} EQUAL 0)
+    message(FATAL_ERROR "greedy-vertex-cover ${ARGN} failed.")
+  endif()
+endfunction()
+
+run(gvc_memory.tsv)
+run(gvc_external.tsv --external-gvc)
+run(gvc_runs.tsv --external-gvc --memory-limit 1K)
+
+file(READ gvc_memory.tsv MEMORY)
+file(READ gvc_external.tsv EXTERNAL)
+if(MEMORY STREQUAL "")
+  message(FATAL_ERROR "external_gvc: empty clustering.")
+endif()
+if(NOT MEMORY STREQUAL EXTERNAL)
+  message(FATAL_ERROR "external_gvc: out-of-core clustering with a single run differs from the in-memory one.")
+endif()
+
+file(STRINGS gvc_runs.tsv RUNS)
+list(LENGTH RUNS COUNT)
+if(NOT COUNT EQUAL NODES)
+  message(FATAL_ERROR "external_gvc: ${COUNT} of ${NODES} nodes assigned with several runs.")
+endif()
+set(CENTROIDS "")
+foreach(LINE IN LISTS RUNS)
+  string(REPLACE "\t" ";" FIELDS "${LINE}")
+  list(GET FIELDS 0 CENTROID)
+  list(APPEND CENTROIDS ${CENTROID})
+endforeach()
+list(REMOVE_DUPLICATES CENTROIDS)
+foreach(CENTROID IN LISTS CENTROIDS)
+  list(FIND RUNS "${CENTROID}\t${CENTROID}" FOUND)
+  if(FOUND EQUAL -1)
+    message(FATAL_ERROR "external_gvc: centroid ${CENTROID} is not its own representative.")
+  endif()
+endforeach()
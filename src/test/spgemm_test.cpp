@@ -0,0 +1,129 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2024 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <buchfink@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+// Checks the SpGEMM kernel of the MCL clustering against a dense reference product. Matrices with
+// more than ColumnAccumulator::DENSE_LIMIT rows exercise the hash accumulator and are compared
+// against a reference computed over a map.
+
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <random>
+#include <vector>
+#include "../contrib/mcl/csc_matrix.h"
+
+using std::vector;
+using std::map;
+using std::pair;
+using std::cout;
+using std::endl;
+using namespace Workflow::Cluster;
+
+struct Triplet {
+	int64_t r, c;
+	float v;
+	int64_t row() const { return r; }
+	int64_t col() const { return c; }
+	float value() const { return v; }
+};
+
+static vector<Triplet> random_triplets(int64_t n, int64_t count, std::mt19937& rng) {
+	std::uniform_int_distribution<int64_t> idx(0, n - 1);
+	std::uniform_real_distribution<float> val(0.0f, 1.0f);
+	vector<Triplet> v;
+	for (int64_t i = 0; i < count; ++i)
+		v.push_back({ idx(rng), idx(rng), val(rng) });
+	return v;
+}
+
+static bool close(double x, double y) {
+	return std::abs(x - y) <= 1e-4 * std::max(1.0, std::abs(y));
+}
+
+static map<pair<int64_t, int64_t>, double> product(const CscMatrix& m) {
+	map<pair<int64_t, int64_t>, double> r;
+	for (int64_t j = 0; j < m.n; ++j)
+		for (int64_t p = m.col_ptr[j]; p < m.col_ptr[j + 1]; ++p)
+			r[{ (int64_t)m.row[p], j }] += m.value[p];
+	return r;
+}
+
+static bool check(const CscMatrix& a, const CscMatrix& b, uint32_t threads) {
+	SpGemmWorkspace ws;
+	CscMatrix c;
+	spgemm(&a, b, c, ws, threads, [](int64_t, vector<pair<uint32_t, float>>&, SpGemmWorkspace::Thread&) {});
+	for (int64_t j = 0; j < c.n; ++j)
+		for (int64_t p = c.col_ptr[j] + 1; p < c.col_ptr[j + 1]; ++p)
+			if (c.row[p - 1] >= c.row[p])
+				return false;
+	const map<pair<int64_t, int64_t>, double> actual = product(c);
+	map<pair<int64_t, int64_t>, double> expected;
+	if (a.n <= ColumnAccumulator::DENSE_LIMIT) {
+		const int64_t n = a.n;
+		vector<double> da(n * n, 0.0), dc(n * n, 0.0);
+		for (int64_t k = 0; k < n; ++k)
+			for (int64_t p = a.col_ptr[k]; p < a.col_ptr[k + 1]; ++p)
+				da[a.row[p] * n + k] = a.value[p];
+		for (int64_t j = 0; j < n; ++j)
+			for (int64_t p = b.col_ptr[j]; p < b.col_ptr[j + 1]; ++p)
+				for (int64_t i = 0; i < n; ++i)
+					dc[i * n + j] += da[i * n + b.row[p]] * b.value[p];
+		for (int64_t i = 0; i < n; ++i)
+			for (int64_t j = 0; j < n; ++j)
+				if (dc[i * n + j] != 0.0)
+					expected[{ i, j }] = dc[i * n + j];
+	}
+	else {
+		for (int64_t j = 0; j < b.n; ++j)
+			for (int64_t p = b.col_ptr[j]; p < b.col_ptr[j + 1]; ++p) {
+				const int64_t k = b.row[p];
+				for (int64_t q = a.col_ptr[k]; q < a.col_ptr[k + 1]; ++q)
+					expected[{ (int64_t)a.row[q], j }] += (double)a.value[q] * b.value[p];
+			}
+	}
+	if (actual.size() != expected.size())
+		return false;
+	for (const auto& e : expected) {
+		auto it = actual.find(e.first);
+		if (it == actual.end() || !close(it->second, e.second))
+			return false;
+	}
+	return true;
+}
+
+int main() {
+	std::mt19937 rng(1);
+	struct Case {
+		int64_t n, entries;
+		bool symmetric;
+	};
+	const vector<Case> cases = { { 1, 1, false }, { 17, 40, false }, { 200, 3000, true }, { 300, 300, false }, { ColumnAccumulator::DENSE_LIMIT + 1000, 200000, true } };
+	int failed = 0;
+	for (const Case& t : cases) {
+		const CscMatrix a = CscMatrix::from_triplets(t.n, random_triplets(t.n, t.entries, rng), t.symmetric),
+			b = CscMatrix::from_triplets(t.n, random_triplets(t.n, t.entries, rng), t.symmetric);
+		for (uint32_t threads : { 1u, 4u }) {
+			const bool ok = check(a, b, threads) && check(a, a, threads);
+			cout << "n=" << t.n << " nnz=" << a.nnz() << " threads=" << threads << (ok ? " passed" : " FAILED") << endl;
+			failed += !ok;
+		}
+	}
+	return failed ? 1 : 0;
+}
@@ -45,9 +45,23 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../dp/swipe/anchored.h"
 #include "../dp/swipe/config.h"
 #include "../util/simd/dispatch.h"
+#include "benchmark.h"
 
 void benchmark_io();
 
+// The kernels are called in the namespace of the architecture this file is compiled for instead of
+// through the dispatcher, so that every instantiation can be measured (--type kernels).
+namespace DP {
+namespace DISPATCH_ARCH {
+void window_ungapped(const Letter* query, const Letter** subjects, int subject_count, int window, int* out);
+void scan_diags128(const LongScoreProfile<int8_t>& qp, Sequence s, int d_begin, int j_begin, int j_end, int* out);
+}
+namespace BandedSwipe { namespace DISPATCH_ARCH {
+std::list<Hsp> swipe(const Targets& targets, Params& params);
+std::list<Hsp> anchored_swipe(Targets& targets, const DP::AnchoredSwipe::Config& cfg);
+}}
+}
+
 using std::vector;
 using std::endl;
 using std::chrono::high_resolution_clock;
@@ -70,6 +84,10 @@ static inline void transpose_scalar(const signed char **data, size_t n, signed c
 
 namespace Benchmark { namespace DISPATCH_ARCH {
 
+static void report(const char* name, double work, high_resolution_clock::time_point t1, const char* unit = "cells/s") {
+	::Benchmark::record(name, work, (double)duration_cast<nanoseconds>(high_resolution_clock::now() - t1).count() / 1e9, unit);
+}
+
 #if defined(__SSE4_1__) && defined(EXTRA)
 void swipe_cell_update();
 #endif
@@ -95,6 +113,7 @@ void benchmark_hamming(const Sequence& s1, const Sequence& s2) {
 	message_stream << "SSE hamming distance:\t\t"
 #endif
 		<< (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / (n * 48) * 1000 << " ps/Cell" << endl;
+	report("fingerprint_match", (double)n * 48, t1);
 }
 #endif
 
@@ -115,6 +134,7 @@ void benchmark_ungapped(const Sequence& s1, const Sequence& s2)
 	std::chrono::nanoseconds time_span = duration_cast<std::chrono::nanoseconds>(t2 - t1);
 
 	message_stream << "Scalar ungapped extension:\t" << (double)time_span.count() / (n*64) * 1000 << " ps/Cell" << endl;
+	report("ungapped_scalar", (double)n * 64, t1);
 }
 
 #if (defined(__SSSE3__) && defined(__SSE4_1__)) | defined(__aarch64__)
@@ -147,36 +167,19 @@ void benchmark_ungapped_sse(const Sequence&s1, const Sequence&s2) {
 	static const size_t n = 1000000llu;
 	high_resolution_clock::time_point t1 = high_resolution_clock::now();
 
-	const Letter* targets[16];
-	//int out[16];
-	for (int i = 0; i < 16; ++i)
+	constexpr int CHANNELS = ::DISPATCH_ARCH::ScoreTraits<ScoreVector<int8_t, SCHAR_MIN>>::CHANNELS;
+	const Letter* targets[CHANNELS];
+	int out[CHANNELS];
+	for (int i = 0; i < CHANNELS; ++i)
 		targets[i] = s2.data();
 
 	for (size_t i = 0; i < n; ++i) {
-		//::DP::ARCH_SSE4_1::window_ungapped(s1.data(), targets, 16, 64, out);
+		::DP::DISPATCH_ARCH::window_ungapped(s1.data(), targets, CHANNELS, 64, out);
+		volatile int x = out[i & (CHANNELS - 1)];
 	}
-#ifdef __ARM_NEON
-	message_stream << "NEON ungapped extend:\t\t"
-#else
-	message_stream << "SSE ungapped extend:\t\t"
-#endif
-		<< (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / (n * 16 * 64) * 1000 << " ps/Cell" << endl;
-
-#ifdef __AVX2__
-	{
-		high_resolution_clock::time_point t1 = high_resolution_clock::now();
-
-		const Letter* targets[32];
-		// int out[32];
-		for (int i = 0; i < 32; ++i)
-			targets[i] = s2.data();
-
-		for (size_t i = 0; i < n; ++i) {
-			//::DP::ARCH_AVX2::window_ungapped(s1.data(), targets, 32, 64, out);
-		}
-		message_stream << "AVX2 ungapped extend:\t\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / (n * 32 * 64) * 1000 << " ps/Cell" << endl;
-	}
-#endif
+	message_stream << "SIMD ungapped extend:\t\t"
+		<< (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / (n * CHANNELS * 64) * 1000 << " ps/Cell" << endl;
+	report("window_ungapped", (double)n * CHANNELS * 64, t1);
 }
 #endif
 
@@ -194,6 +197,7 @@ void benchmark_transpose() {
 		in[0] = out[0];
 	}
 	message_stream << "Transpose (16x16, scalar):\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / (n * 16 * 16) * 1000 << " ps/Letter" << endl;
+	report("transpose16_scalar", (double)n * 16 * 16, t1, "letters/s");
 
         high_resolution_clock::time_point t2 = high_resolution_clock::now();
         for (size_t i = 0; i < n; ++i) {
@@ -205,6 +209,7 @@ void benchmark_transpose() {
             in[0] = out[0];
         }
         message_stream << "Transpose (16x16, vectorized):\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t2).count() / (n * 16 * 16) * 1000 << " ps/Letter" << endl;
+	report("transpose16", (double)n * 16 * 16, t2, "letters/s");
 
 
 #if ARCH_ID == 2
@@ -220,6 +225,7 @@ void benchmark_transpose() {
 			in[0] = out[0];
 		}
 		message_stream << "Transpose (32x32, scalar):\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / (n * 32 * 32) * 1000 << " ps/Letter" << endl;
+		report("transpose32_scalar", (double)n * 32 * 32, t1, "letters/s");
 
 		high_resolution_clock::time_point t2 = high_resolution_clock::now();
 		for (size_t i = 0; i < n; ++i) {
@@ -227,6 +233,7 @@ void benchmark_transpose() {
 			in[0] = out[0];
 		}
 		message_stream << "Transpose(32x32, vectorized):\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t2).count() / (n * 32 * 32) * 1000 << " ps/Letter" << endl;
+		report("transpose32", (double)n * 32 * 32, t2, "letters/s");
 	}
 #endif
 }
@@ -253,7 +260,7 @@ void mt_swipe(const Sequence& s1, const Sequence& s2) {
 	auto f = [&]() {
 		for (size_t i = 0; i < n; ++i) {
 			//volatile list<Hsp> v = ::DP::BandedSwipe::ARCH_SSE4_1::swipe(targets, params);
-			volatile list<Hsp> v = ::DP::BandedSwipe::swipe(targets, params);
+			volatile list<Hsp> v = ::DP::BandedSwipe::DISPATCH_ARCH::swipe(targets, params);
 		}
 	};
 	using std::thread;
@@ -285,41 +292,54 @@ void swipe(const Sequence&s1, const Sequence&s2) {
 
 	high_resolution_clock::time_point t1 = high_resolution_clock::now();
 	for (size_t i = 0; i < n; ++i) {
-		volatile list<Hsp> v = ::DP::BandedSwipe::swipe(targets, params);
+		volatile list<Hsp> v = ::DP::BandedSwipe::DISPATCH_ARCH::swipe(targets, params);
 	}
 	message_stream << "SWIPE (int8_t):\t\t\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / dp_size * 1000 << " ps/Cell" << endl;
+	report("swipe_int8", (double)dp_size, t1);
 
 	t1 = high_resolution_clock::now();
 	targets[1] = targets[0];
 	targets[0].clear();
 	for (size_t i = 0; i < n; ++i) {
-		volatile list<Hsp> v = ::DP::BandedSwipe::swipe(targets, params);
+		volatile list<Hsp> v = ::DP::BandedSwipe::DISPATCH_ARCH::swipe(targets, params);
 	}
 	message_stream << "SWIPE (int16_t):\t\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / dp_size * 1000 << " ps/Cell" << endl;
+	report("swipe_int16", (double)dp_size, t1);
+
+	targets[2] = targets[1];
+	targets[1].clear();
+	t1 = high_resolution_clock::now();
+	for (size_t i = 0; i < n / 10; ++i) {
+		volatile list<Hsp> v = ::DP::BandedSwipe::DISPATCH_ARCH::swipe(targets, params);
+	}
+	message_stream << "SWIPE (int32_t):\t\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / (dp_size / 10) * 1000 << " ps/Cell" << endl;
+	report("swipe_int32", (double)(dp_size / 10), t1);
+	targets[1] = targets[2];
+	targets[2].clear();
 
 	t1 = high_resolution_clock::now();
 	for (size_t i = 0; i < n; ++i) {
-		volatile list<Hsp> v = ::DP::BandedSwipe::swipe(targets, params);
+		volatile list<Hsp> v = ::DP::BandedSwipe::DISPATCH_ARCH::swipe(targets, params);
 	}
 	message_stream << "SWIPE (int8_t, Stats):\t\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / dp_size * 1000 << " ps/Cell" << endl;
 
 	t1 = high_resolution_clock::now();
 	for (size_t i = 0; i < 32; ++i)
-		targets[0][i].matrix = &matrix;
+		targets[1][i].matrix = &matrix;
 	for (size_t i = 0; i < n; ++i) {
-		volatile list<Hsp> v = ::DP::BandedSwipe::swipe(targets, params);
+		volatile list<Hsp> v = ::DP::BandedSwipe::DISPATCH_ARCH::swipe(targets, params);
 	}
 	message_stream << "SWIPE (int8_t, MatrixAdjust):\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / dp_size * 1000 << " ps/Cell" << endl;
 
 	t1 = high_resolution_clock::now();
 	for (size_t i = 0; i < n; ++i) {
-		volatile list<Hsp> v = ::DP::BandedSwipe::swipe(targets, params);
+		volatile list<Hsp> v = ::DP::BandedSwipe::DISPATCH_ARCH::swipe(targets, params);
 	}
 	message_stream << "SWIPE (int8_t, CBS):\t\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / dp_size * 1000 << " ps/Cell" << endl;
 
 	t1 = high_resolution_clock::now();
 	for (size_t i = 0; i < n; ++i) {
-		volatile list<Hsp> v = ::DP::BandedSwipe::swipe(targets, params);
+		volatile list<Hsp> v = ::DP::BandedSwipe::DISPATCH_ARCH::swipe(targets, params);
 	}
 	message_stream << "SWIPE (int8_t, TB):\t\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / dp_size * 1000 << " ps/Cell" << endl;
 }
@@ -339,22 +359,44 @@ void banded_swipe(const Sequence &s1, const Sequence &s2) {
 	};
 	high_resolution_clock::time_point t1 = high_resolution_clock::now();
 	for (size_t i = 0; i < n; ++i) {
-		volatile auto out = ::DP::BandedSwipe::swipe(targets, params);
+		volatile auto out = ::DP::BandedSwipe::DISPATCH_ARCH::swipe(targets, params);
 	}
 	message_stream << "Banded SWIPE (int16_t, CBS):\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / (n * s1.length() * 65 * 16) * 1000 << " ps/Cell" << endl;
+	report("banded_swipe_int16_cbs", (double)n * s1.length() * 65 * 16, t1);
 	
 	t1 = high_resolution_clock::now();
 	for (size_t i = 0; i < n; ++i) {
-		volatile auto out = ::DP::BandedSwipe::swipe(targets, params);
+		volatile auto out = ::DP::BandedSwipe::DISPATCH_ARCH::swipe(targets, params);
 	}
 	message_stream << "Banded SWIPE (int16_t):\t\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / (n * s1.length() * 65 * 16) * 1000 << " ps/Cell" << endl;
+	report("banded_swipe_int16", (double)n * s1.length() * 65 * 16, t1);
 
 	params.v = HspValues::TRANSCRIPT;
 	t1 = high_resolution_clock::now();
 	for (size_t i = 0; i < n; ++i) {
-		volatile auto out = ::DP::BandedSwipe::swipe(targets, params);
+		volatile auto out = ::DP::BandedSwipe::DISPATCH_ARCH::swipe(targets, params);
 	}
 	message_stream << "Banded SWIPE (int16_t, CBS, TB):" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / (n * s1.length() * 65 * 16) * 1000 << " ps/Cell" << endl;
+	report("banded_swipe_int16_tb", (double)n * s1.length() * 65 * 16, t1);
+
+	params.v = HspValues();
+	targets[0] = targets[1];
+	targets[1].clear();
+	t1 = high_resolution_clock::now();
+	for (size_t i = 0; i < n; ++i) {
+		volatile auto out = ::DP::BandedSwipe::DISPATCH_ARCH::swipe(targets, params);
+	}
+	message_stream << "Banded SWIPE (int8_t, CBS):\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / (n * s1.length() * 65 * 16) * 1000 << " ps/Cell" << endl;
+	report("banded_swipe_int8_cbs", (double)n * s1.length() * 65 * 16, t1);
+
+	targets[2] = targets[0];
+	targets[0].clear();
+	t1 = high_resolution_clock::now();
+	for (size_t i = 0; i < n / 10; ++i) {
+		volatile auto out = ::DP::BandedSwipe::DISPATCH_ARCH::swipe(targets, params);
+	}
+	message_stream << "Banded SWIPE (int32_t, CBS):\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / (n / 10 * s1.length() * 65 * 16) * 1000 << " ps/Cell" << endl;
+	report("banded_swipe_int32_cbs", (double)(n / 10) * s1.length() * 65 * 16, t1);
 }
 
 #if ARCH_ID == 2
@@ -386,6 +428,7 @@ void anchored_swipe(const Sequence& s1, const Sequence& s2) {
 		volatile auto x = targets[0].score;
 	}
 	message_stream << "Anchored Swipe (int8_t):\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / (n * cols * 64 * 32) * 1000 << " ps/Cell" << endl;
+	report("anchored_swipe_int8", (double)n * cols * 64 * 32, t1);
 
 	vector<DP::AnchoredSwipe::Target<int16_t>> targets16;
 	for (int i = 0; i < 16; ++i) {
@@ -398,6 +441,7 @@ void anchored_swipe(const Sequence& s1, const Sequence& s2) {
 		volatile auto x = targets[0].score;
 	}
 	message_stream << "Anchored Swipe (int16_t):\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / (n * cols * 64 * 16) * 1000 << " ps/Cell" << endl;
+	report("anchored_swipe_int16", (double)n * cols * 64 * 16, t1);
 
 	DP::Targets dp_targets;
 	Anchor a(DiagonalSegment(0, 0, 0, 0), 0, 0, 0, 0, 0);
@@ -407,10 +451,11 @@ void anchored_swipe(const Sequence& s1, const Sequence& s2) {
 
 	t1 = high_resolution_clock::now();
 	for (size_t i = 0; i < n; ++i) {
-		DP::BandedSwipe::anchored_swipe(dp_targets, cfg);
+		::DP::BandedSwipe::DISPATCH_ARCH::anchored_swipe(dp_targets, cfg);
 		volatile auto x = targets[0].score;
 	}
 	message_stream << "Anchored Swipe2 (int16_t):\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / (n * 128 * 64 * 16) * 1000 << " ps/Cell" << endl;
+	report("anchored_swipe_wrapper_int16", (double)n * 128 * 64 * 16, t1);
 }
 
 //#endif
@@ -460,10 +505,11 @@ void diag_scores(const Sequence& s1, const Sequence& s2) {
 	LongScoreProfile<int8_t> p = DP::make_profile8(s1, cbs.int8.data(), 0);
 	int scores[128];
 	for (size_t i = 0; i < n; ++i) {
-		DP::scan_diags128(p, s2, -32, 0, (int)s2.length(), scores);
-		volatile int x = scores[i & 128];
+		::DP::DISPATCH_ARCH::scan_diags128(p, s2, -32, 0, (int)s2.length(), scores);
+		volatile int x = scores[i & 127];
 	}
 	message_stream << "Diagonal scores:\t\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / (n * s2.length() * 128) * 1000 << " ps/Cell" << endl;
+	report("scan_diags128", (double)n * s2.length() * 128, t1);
 }
 #endif
 
@@ -505,6 +551,7 @@ void matrix_adjust(const Sequence& s1, const Sequence& s2) {
 	}
 
 	message_stream << "Matrix adjust:\t\t\t" << (double)duration_cast<std::chrono::microseconds>(high_resolution_clock::now() - t1).count() / (n) << " ms" << endl;
+	report("matrix_adjust", (double)n, t1, "matrices/s");
 
 	t1 = high_resolution_clock::now();
 	for (size_t i = 0; i < n; ++i) {
@@ -512,21 +559,12 @@ void matrix_adjust(const Sequence& s1, const Sequence& s2) {
 	}
 
 	message_stream << "Matrix adjust (vectorized):\t" << (double)duration_cast<std::chrono::microseconds>(high_resolution_clock::now() - t1).count() / (n) << " micros" << endl;
+	report("matrix_adjust_vectorized", (double)n, t1, "matrices/s");
 
 	//Profiler::print(n);
 }
 
-void benchmark() {
-	if (config.type == "swipe") {
-#if defined(__SSE4_1__) && defined(EXTRA)
-		swipe_cell_update();
-#endif
-		return;
-	}if (!config.type.empty()) {
-		benchmark_io();
-		return;
-	}
-
+void kernels() {
 	vector<Letter> s1, s2, s3, s4;
 
 	s1 = Sequence::from_string("mpeeeysefkelilqkelhvvyalshvcgqdrtllasillriflhekleslllctlndreismedeattlfrattlastlmeqymkatatqfvhhalkdsilkimeskqscelspskleknedvntnlthllnilselvekifmaseilpptlryiygclqksvqhkwptnttmrtrvvsgfvflrlicpailnprmfniisdspspiaartlilvaksvqnlanlvefgakepymegvnpfiksnkhrmimfldelgnvpelpdttehsrtdlsrdlaalheicvahsdelrtlsnergaqqhvlkkllaitellqqkqnqyt"); // d1wera_
@@ -573,8 +611,31 @@ void benchmark() {
 #endif
 }
 
+void benchmark() {
+	if (config.type == "swipe") {
+#if defined(__SSE4_1__) && defined(EXTRA)
+		swipe_cell_update();
+#endif
+		return;
+	}
+	if (config.type == "suite") {
+		suite();
+		return;
+	}
+	if (config.type == "kernels") {
+		kernel_matrix();
+		return;
+	}
+	if (!config.type.empty()) {
+		benchmark_io();
+		return;
+	}
+	kernels();
+}
+
 }
 
 DISPATCH_0V(benchmark)
+DISPATCH_0V(kernels)
 
 }
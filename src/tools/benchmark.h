@@ -0,0 +1,37 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2024 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <buchfink@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#pragma once
+
+namespace Benchmark {
+
+void benchmark();
+// Micro-benchmarks of the alignment kernels, dispatched to the CPU architecture.
+void kernels();
+// Benchmark suite on synthetic data (--type suite), results are written as JSON and optionally
+// compared against a baseline file.
+void suite();
+// Runs the micro-benchmarks of every compiled architecture supported by the CPU several times and
+// reports mean and standard deviation (--type kernels).
+void kernel_matrix();
+// Records a throughput result (work units per second) of the suite.
+void record(const char* name, double work, double seconds, const char* unit);
+
+}
@@ -139,6 +139,8 @@ static void load_mmap() {
 	SequenceFile* db = SequenceFile::auto_create({ config.database }, SequenceFile::Flags::NONE);
 	timer.finish();
 	message_stream << "Type: " << to_string(db->type()) << endl;
+	if (db->type() == SequenceFile::Type::DMND)
+		db->init_random_access(0, 0, false);
 	size_t n = db->sequence_count(), l = 0;
 	vector<Letter> v, buf;
 	buf.reserve(BUF);
@@ -159,6 +161,8 @@ static void load_mmap_mt() {
 	SequenceFile* db = SequenceFile::auto_create({ config.database }, SequenceFile::Flags::NONE);
 	timer.finish();
 	message_stream << "Type: " << to_string(db->type()) << endl;
+	if (db->type() == SequenceFile::Type::DMND)
+		db->init_random_access(0, 0, false);
 	size_t n = db->sequence_count();
 	std::atomic_size_t i(0);
 	vector<std::thread> threads;
@@ -0,0 +1,468 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2024 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <buchfink@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include "benchmark.h"
+#include "../basic/config.h"
+#include "../basic/statistics.h"
+#include "../data/block/block.h"
+#include "../data/dmnd/dmnd.h"
+#include "../data/fasta/fasta_file.h"
+#include "../data/seed_array.h"
+#include "../masking/masking.h"
+#include "../run/workflow.h"
+#include "../cluster/cluster_registry.h"
+#include "../stats/standard_matrix.h"
+#include "../util/algo/hash_join.h"
+#include "../util/command_line_parser.h"
+#include "../util/io/temp_file.h"
+#include "../util/io/output_file.h"
+#include "../util/sequence/translate.h"
+#include "../util/string/string.h"
+#include "../util/simd.h"
+#include "../util/simd/dispatch.h"
+#include "../util/util.h"
+
+using std::string;
+using std::vector;
+using std::endl;
+using std::runtime_error;
+using std::chrono::steady_clock;
+
+// The suite generates a database of protein families and queries that are mutated family members
+// (protein and back-translated DNA). All data is derived from a fixed random seed, so runs with the
+// same --bench-scale are comparable. Every result is a throughput (higher is better).
+
+namespace Benchmark {
+
+namespace {
+
+struct Result {
+	string name, unit;
+	double value, seconds, stddev;
+	int runs;
+};
+
+struct Options {
+	double scale, tolerance;
+	string baseline, output_file, tmpdir;
+	int threads;
+};
+
+}
+
+static const uint64_t SEED = 1;
+static vector<Result> results;
+// Prepended to the names of recorded results, identifies the architecture in the kernel matrix.
+static string name_prefix;
+
+void record(const char* name, double work, double seconds, const char* unit) {
+	results.push_back({ name_prefix + name, unit, seconds > 0.0 ? work / seconds : 0.0, seconds, 0.0, 1 });
+}
+
+static double seconds_since(steady_clock::time_point t) {
+	return std::chrono::duration<double>(steady_clock::now() - t).count();
+}
+
+using Rng = std::mt19937_64;
+
+struct Generator {
+
+	Generator() :
+		rng(SEED),
+		aa(Stats::blosum62.background_freqs.begin(), Stats::blosum62.background_freqs.end())
+	{
+		for (int i = 0; i < 4; ++i)
+			for (int j = 0; j < 4; ++j)
+				for (int k = 0; k < 4; ++k) {
+					const Letter l = Translator::lookup[i][j][k];
+					if (l < TRUE_AA)
+						codons[(int)l].push_back({ i, j, k });
+				}
+	}
+
+	vector<Letter> random_protein(int len) {
+		vector<Letter> s(len);
+		for (Letter& l : s)
+			l = (Letter)aa(rng);
+		return s;
+	}
+
+	// Substitutions are drawn from the background distribution, insertions and deletions of
+	// single letters occur at 1/20 of the substitution rate.
+	vector<Letter> mutate(const vector<Letter>& s, double id) {
+		std::uniform_real_distribution<double> p(0.0, 1.0);
+		const double indel = (1.0 - id) / 20.0;
+		vector<Letter> r;
+		r.reserve(s.size());
+		for (Letter l : s) {
+			const double x = p(rng);
+			if (x < indel)
+				continue;
+			if (x < 2 * indel)
+				r.push_back((Letter)aa(rng));
+			r.push_back(p(rng) < id ? l : (Letter)aa(rng));
+		}
+		return r;
+	}
+
+	vector<Letter> back_translate(const vector<Letter>& s) {
+		std::uniform_int_distribution<int> nt(0, 3), flank(30, 90);
+		vector<Letter> r;
+		for (int i = flank(rng); i > 0; --i)
+			r.push_back((Letter)nt(rng));
+		for (Letter l : s) {
+			const vector<std::array<int, 3>>& c = codons[(int)l];
+			const std::array<int, 3>& codon = c[std::uniform_int_distribution<size_t>(0, c.size() - 1)(rng)];
+			r.insert(r.end(), codon.begin(), codon.end());
+		}
+		for (int i = flank(rng); i > 0; --i)
+			r.push_back((Letter)nt(rng));
+		return r;
+	}
+
+	Rng rng;
+	std::discrete_distribution<int> aa;
+	vector<std::array<int, 3>> codons[TRUE_AA];
+
+};
+
+struct Dataset {
+	vector<vector<Letter>> db, queries, dna_queries;
+	int64_t db_letters = 0, query_letters = 0, dna_letters = 0;
+};
+
+static Dataset generate(double scale) {
+	Generator gen;
+	Dataset d;
+	const int64_t db_count = std::max((int64_t)(2000 * scale), (int64_t)4), query_count = std::max((int64_t)(200 * scale), (int64_t)1);
+	std::uniform_int_distribution<int> len(100, 600), family_size(1, 7);
+	std::uniform_real_distribution<double> member_id(0.4, 0.95), query_id(0.3, 0.9);
+	vector<vector<Letter>> roots;
+	while ((int64_t)d.db.size() < db_count) {
+		roots.push_back(gen.random_protein(len(gen.rng)));
+		d.db.push_back(roots.back());
+		for (int i = family_size(gen.rng); i > 0 && (int64_t)d.db.size() < db_count; --i)
+			d.db.push_back(gen.mutate(roots.back(), member_id(gen.rng)));
+	}
+	std::uniform_int_distribution<size_t> root(0, roots.size() - 1);
+	for (int64_t i = 0; i < query_count; ++i) {
+		d.queries.push_back(gen.mutate(roots[root(gen.rng)], query_id(gen.rng)));
+		d.dna_queries.push_back(gen.back_translate(d.queries.back()));
+	}
+	for (const auto& s : d.db)
+		d.db_letters += s.size();
+	for (const auto& s : d.queries)
+		d.query_letters += s.size();
+	for (const auto& s : d.dna_queries)
+		d.dna_letters += s.size();
+	return d;
+}
+
+// The name of a reserved temporary file serves as the stem of the data files, so that concurrent
+// runs in the same directory do not overwrite each other's files.
+static string unique_stem() {
+	TempFile f(false);
+	const string name = f.file_name();
+	f.close();
+	return name;
+}
+
+static size_t write_fasta(const string& file_name, const vector<vector<Letter>>& seqs, const char* alphabet) {
+	OutputFile out(file_name);
+	string buf;
+	size_t bytes = 0;
+	for (size_t i = 0; i < seqs.size(); ++i) {
+		buf = '>' + std::to_string(i) + '\n';
+		for (Letter l : seqs[i])
+			buf += alphabet[(int)l];
+		buf += '\n';
+		out.write(buf.data(), buf.length());
+		bytes += buf.length();
+	}
+	out.close();
+	return bytes;
+}
+
+// Replaces the global configuration by a command line of a workflow run.
+static void set_config(const Options& options, vector<string> args) {
+	args.insert(args.begin(), "diamond");
+	args.insert(args.end(), { "--threads", std::to_string(options.threads) });
+	if (!options.tmpdir.empty())
+		args.insert(args.end(), { "--tmpdir", options.tmpdir });
+	CommandLineParser parser;
+	config = Config((int)args.size(), charp_array(args.begin(), args.end()).data(), false, parser);
+	statistics.reset();
+}
+
+static void hash_join_kernel(const Dataset& d) {
+	using Entry = SeedArray<PackedLoc>::Entry;
+	const int BITS = 24;
+	Rng rng(SEED);
+	std::uniform_int_distribution<uint32_t> key(0, (1u << BITS) - 1);
+	vector<Entry> r(d.query_letters * 8), s(d.db_letters);
+	for (size_t i = 0; i < r.size(); ++i)
+		r[i] = Entry(key(rng), (PackedLoc)(uint32_t)i);
+	for (size_t i = 0; i < s.size(); ++i)
+		s[i] = Entry(key(rng), (PackedLoc)(uint32_t)i);
+	const auto t = steady_clock::now();
+	auto out = hash_join(Relation<Entry>(r.data(), r.size()), Relation<Entry>(s.data(), s.size()), BITS);
+	record("hash_join", double(r.size() + s.size()), seconds_since(t), "seeds/s");
+}
+
+static void tantan_kernel(const Dataset& d) {
+	vector<vector<Letter>> seqs = d.db;
+	const auto t = steady_clock::now();
+	for (size_t i = 0; i < seqs.size(); ++i)
+		Masking::get()(seqs[i].data(), seqs[i].size(), MaskingAlgo::TANTAN, i);
+	record("tantan", (double)d.db_letters, seconds_since(t), "letters/s");
+}
+
+static void io_kernels(const Dataset& d, const string& file_name) {
+	auto t = steady_clock::now();
+	const size_t bytes = write_fasta(file_name, d.db, amino_acid_traits.alphabet);
+	record("fasta_write", bytes / 1e6, seconds_since(t), "MB/s");
+	t = steady_clock::now();
+	FastaFile in({ file_name });
+	std::unique_ptr<Block> block(in.load_seqs(INT64_MAX));
+	in.close();
+	record("fasta_load", bytes / 1e6, seconds_since(t), "MB/s");
+}
+
+static void search(const char* name, const Options& options, const vector<string>& args, int64_t query_letters) {
+	set_config(options, args);
+	const auto t = steady_clock::now();
+	Search::run();
+	const double s = seconds_since(t);
+	record(name, (double)query_letters, s, "letters/s");
+	record((string(name) + "_seed_hits").c_str(), (double)statistics.get(Statistics::SEED_HITS), s, "seeds/s");
+	record((string(name) + "_dp_cells").c_str(), (double)statistics.get(Statistics::GROSS_DP_CELLS), s, "cells/s");
+}
+
+static void write_results(std::ostream& out, const Options& options) {
+	out << std::setprecision(6);
+	out << "{" << endl;
+	out << "\"arch\": \"" << SIMD::features() << "\"," << endl;
+	out << "\"scale\": " << options.scale << "," << endl;
+	out << "\"threads\": " << options.threads << "," << endl;
+	out << "\"results\": [" << endl;
+	for (size_t i = 0; i < results.size(); ++i)
+		out << "{\"name\": \"" << results[i].name << "\", \"value\": " << results[i].value << ", \"unit\": \"" << results[i].unit
+		<< "\", \"seconds\": " << results[i].seconds << ", \"stddev\": " << results[i].stddev << ", \"runs\": " << results[i].runs << "}" << (i + 1 < results.size() ? "," : "") << endl;
+	out << "]" << endl << "}" << endl;
+}
+
+// Reads the results of a file written by write_results (one result per line).
+static std::map<string, double> read_baseline(const string& file_name) {
+	std::ifstream in(file_name);
+	if (!in)
+		throw runtime_error("Error opening baseline file: " + file_name);
+	std::map<string, double> r;
+	string line;
+	const string name_tag = "\"name\": \"", value_tag = "\"value\": ";
+	while (std::getline(in, line)) {
+		const size_t i = line.find(name_tag), j = line.find(value_tag);
+		if (i == string::npos || j == string::npos)
+			continue;
+		const size_t k = line.find('"', i + name_tag.length());
+		r[line.substr(i + name_tag.length(), k - i - name_tag.length())] = std::stod(line.substr(j + value_tag.length()));
+	}
+	return r;
+}
+
+static int compare(const std::map<string, double>& baseline, double tolerance) {
+	int regressions = 0;
+	message_stream << endl << std::left << std::setw(32) << "Benchmark" << std::setw(16) << "Baseline" << std::setw(16) << "Current" << "Change" << endl;
+	for (const Result& r : results) {
+		auto it = baseline.find(r.name);
+		if (it == baseline.end() || it->second <= 0.0)
+			continue;
+		const double change = r.value / it->second - 1.0;
+		const bool regression = change < -tolerance;
+		regressions += regression;
+		message_stream << std::setw(32) << r.name << std::setw(16) << it->second << std::setw(16) << r.value
+			<< std::fixed << std::setprecision(1) << change * 100 << '%' << (regression ? " REGRESSION" : "") << std::defaultfloat << std::setprecision(6) << endl;
+	}
+	return regressions;
+}
+
+static void write_results(const Options& options) {
+	if (options.output_file.empty())
+		write_results(std::cout, options);
+	else {
+		std::ofstream out(options.output_file);
+		write_results(out, options);
+	}
+	if (!options.baseline.empty()) {
+		const int regressions = compare(read_baseline(options.baseline), options.tolerance);
+		if (regressions > 0)
+			throw runtime_error(std::to_string(regressions) + " benchmark result(s) below the baseline tolerance.");
+	}
+}
+
+void suite() {
+	const Options options{ config.bench_scale, config.bench_tolerance, config.bench_baseline, config.output_file, config.tmpdir, config.threads_ };
+	results.clear();
+
+	TaskTimer timer("Generating synthetic data");
+	const Dataset data = generate(options.scale);
+	const string stem = unique_stem(),
+		db_fasta = stem + "_db.faa",
+		db_file = stem + "_db.dmnd",
+		query_file = stem + "_query.faa",
+		dna_query_file = stem + "_query.fna",
+		out_file = stem + "_out.tsv";
+	write_fasta(query_file, data.queries, amino_acid_traits.alphabet);
+	write_fasta(dna_query_file, data.dna_queries, nucleotide_traits.alphabet);
+	timer.finish();
+	message_stream << "Database: " << data.db.size() << " sequences, " << data.db_letters << " letters" << endl;
+	message_stream << "Queries: " << data.queries.size() << " sequences, " << data.query_letters << " letters" << endl;
+
+	kernels();
+	timer.go("Running hash join");
+	hash_join_kernel(data);
+	timer.go("Running tantan");
+	tantan_kernel(data);
+	timer.go("Running I/O");
+	io_kernels(data, db_fasta);
+	timer.finish();
+
+	set_config(options, { "makedb", "--in", db_fasta, "-d", db_file });
+	auto t = steady_clock::now();
+	DatabaseFile::make_db();
+	record("makedb", (double)data.db_letters, seconds_since(t), "letters/s");
+
+	search("blastp", options, { "blastp", "-q", query_file, "-d", db_file, "-o", out_file }, data.query_letters);
+	search("blastp_sensitive", options, { "blastp", "-q", query_file, "-d", db_file, "-o", out_file, "--sensitive" }, data.query_letters);
+	search("blastx", options, { "blastx", "-q", dna_query_file, "-d", db_file, "-o", out_file }, data.dna_letters);
+
+	set_config(options, { "cluster", "-d", db_file, "-o", out_file });
+	t = steady_clock::now();
+	Workflow::Cluster::ClusterRegistry::get(config.cluster_algo.get("cascaded"))->run();
+	record("cluster", (double)data.db.size(), seconds_since(t), "sequences/s");
+
+	for (const string& f : { stem, db_fasta, db_file, query_file, dna_query_file, out_file })
+		std::remove(f.c_str());
+
+	write_results(options);
+}
+
+namespace ARCH_GENERIC { void kernels(); }
+HAVE_SSE4_1(namespace ARCH_SSE4_1 { void kernels(); })
+HAVE_AVX2(namespace ARCH_AVX2 { void kernels(); })
+#ifdef WITH_AVX512
+namespace ARCH_AVX512 { void kernels(); }
+#endif
+HAVE_NEON(namespace ARCH_NEON { void kernels(); })
+
+namespace {
+
+struct ArchKernels {
+	const char* name;
+	SIMD::Arch arch;
+	void (*run)();
+};
+
+}
+
+static bool supported(SIMD::Arch arch, SIMD::Arch cpu) {
+	if (arch == SIMD::Arch::Generic)
+		return true;
+	if (arch == SIMD::Arch::NEON || cpu == SIMD::Arch::NEON)
+		return arch == cpu;
+	return (int)arch <= (int)cpu;
+}
+
+// Merges the results of the runs into one result per kernel, the value is the mean throughput.
+static void merge_runs() {
+	vector<Result> merged;
+	std::map<string, vector<double>> values;
+	for (const Result& r : results) {
+		if (values.find(r.name) == values.end())
+			merged.push_back(r);
+		values[r.name].push_back(r.value);
+	}
+	for (Result& r : merged) {
+		const vector<double>& v = values[r.name];
+		double sum = 0.0, sq = 0.0;
+		for (double x : v)
+			sum += x;
+		r.value = sum / v.size();
+		for (double x : v)
+			sq += (x - r.value) * (x - r.value);
+		r.stddev = v.size() > 1 ? std::sqrt(sq / (v.size() - 1)) : 0.0;
+		r.runs = (int)v.size();
+	}
+	results = std::move(merged);
+}
+
+void kernel_matrix() {
+	const Options options{ 0.0, config.bench_tolerance, config.bench_baseline, config.output_file, config.tmpdir, config.threads_ };
+	if (config.bench_runs <= 0)
+		throw runtime_error("Invalid value for --bench-runs.");
+	const vector<ArchKernels> archs{
+		{ "generic", SIMD::Arch::Generic, ARCH_GENERIC::kernels },
+#ifdef WITH_SSE4_1
+		{ "sse4_1", SIMD::Arch::SSE4_1, ARCH_SSE4_1::kernels },
+#endif
+#ifdef WITH_AVX2
+		{ "avx2", SIMD::Arch::AVX2, ARCH_AVX2::kernels },
+#endif
+#ifdef WITH_AVX512
+		{ "avx512", SIMD::Arch::AVX512, ARCH_AVX512::kernels },
+#endif
+#ifdef WITH_NEON
+		{ "neon", SIMD::Arch::NEON, ARCH_NEON::kernels },
+#endif
+	};
+	const SIMD::Arch cpu = SIMD::arch();
+	results.clear();
+	message_stream << "CPU features: " << SIMD::features() << endl;
+	auto dispatch = std::find_if(archs.begin(), archs.end(), [cpu](const ArchKernels& a) { return a.arch == cpu; });
+	message_stream << "Dispatch target: " << (dispatch == archs.end() ? "generic" : dispatch->name) << endl;
+	for (int run = 0; run < config.bench_runs; ++run)
+		for (const ArchKernels& a : archs) {
+			if (!supported(a.arch, cpu))
+				continue;
+			message_stream << endl << "Architecture " << a.name << ", run " << run + 1 << '/' << config.bench_runs << ':' << endl;
+			name_prefix = string(a.name) + '/';
+			a.run();
+		}
+	name_prefix.clear();
+	merge_runs();
+
+	message_stream << endl << std::left << std::setw(40) << "Kernel" << std::setw(16) << "Mean" << std::setw(16) << "Stddev" << std::setw(10) << "CV(%)" << "Unit" << endl;
+	for (const Result& r : results)
+		message_stream << std::setw(40) << r.name << std::setw(16) << r.value << std::setw(16) << r.stddev
+			<< std::fixed << std::setprecision(1) << std::setw(10) << (r.value > 0.0 ? r.stddev / r.value * 100 : 0.0) << std::defaultfloat << std::setprecision(6) << r.unit << endl;
+	write_results(options);
+}
+
+}
@@ -29,6 +29,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../util/log_stream.h"
 #include "../util/string/fixed_string.h"
 #include "../util/string/tokenizer.h"
+#include "../util/string/string.h"
 #include "../util/algo/algo.h"
 #include "../util/system/system.h"
 #include "../cluster/cluster.h"
@@ -147,12 +148,34 @@ void greedy_vertex_cover() {
 	timer.finish();
 	log_rss();
 
-	timer.go("Making flat array");
-	FlatArray<Edge> edge_array = make_flat_array_dense(move(edges), (Int)acc2oid.size(), config.threads_, Edge::GetKey());
-	timer.finish();
-	log_rss();
+	vector<Int> r;
+	const Int ccd = config.connected_component_depth.empty() ? 0 : (Int)atoi(config.connected_component_depth.front().c_str());
+	if (config.external_gvc) {
+		// The buckets are held in memory, this mode only serves to compare the out-of-core algorithm with the in-memory one.
+		if (ccd > 0)
+			throw runtime_error("Option --connected-component-depth is not supported with --external-gvc.");
+		timer.go("Bucketing edges");
+		const Int node_count = (Int)acc2oid.size(), bucket_size = node_count / 1024 + 1;
+		vector<vector<Edge>> buckets(node_count / bucket_size + 1);
+		for (const Edge& e : edges)
+			buckets[e.node1 / bucket_size].push_back(e);
+		vector<Edge>().swap(edges);
+		vector<int64_t> bucket_edges;
+		for (const vector<Edge>& b : buckets)
+			bucket_edges.push_back((int64_t)b.size());
+		timer.finish();
+		const int64_t max_edges = std::max(Util::String::interpret_number(config.memory_limit.get(DEFAULT_MEMORY_LIMIT)) / (int64_t)(sizeof(Edge) * 2), (int64_t)1);
+		const std::function<vector<Edge>(int)> load_bucket = [&buckets](int bucket) { return buckets[bucket]; };
+		r = Util::Algo::greedy_vertex_cover_external(node_count, bucket_size, bucket_edges, max_edges, load_bucket, nullptr, !config.strict_gvc, !config.no_gvc_reassign, config.threads_);
+	}
+	else {
+		timer.go("Making flat array");
+		FlatArray<Edge> edge_array = make_flat_array_dense(move(edges), (Int)acc2oid.size(), config.threads_, Edge::GetKey());
+		timer.finish();
+		log_rss();
 
-	auto r = Util::Algo::greedy_vertex_cover(edge_array, nullptr, !config.strict_gvc, !config.no_gvc_reassign, (Int)atoi(config.connected_component_depth.front().c_str()));
+		r = Util::Algo::greedy_vertex_cover(edge_array, nullptr, !config.strict_gvc, !config.no_gvc_reassign, ccd, config.parallel_gvc ? config.threads_ : 1);
+	}
 
 	timer.go("Building reverse mapping");
 	vector<string> acc(acc2oid.size());
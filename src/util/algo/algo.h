@@ -1,6 +1,7 @@
 #pragma once
 #include <stdint.h>
 #include <vector>
+#include <functional>
 #include <stddef.h>
 #include "partition.h"
 #define _REENTRANT
@@ -32,8 +33,20 @@ struct Edge {
 	double weight;
 };
 
+// With threads > 1 (and no connected component depth), centroids are selected in parallel rounds. The result
+// is deterministic but may differ from the sequential algorithm.
 template<typename Int>
-std::vector<Int> greedy_vertex_cover(FlatArray<Edge<Int>>& neighbors, const SuperBlockId* member_counts = nullptr, bool merge_recursive = false, bool reassign = true, Int connected_component_depth = 0);
+std::vector<Int> greedy_vertex_cover(FlatArray<Edge<Int>>& neighbors, const SuperBlockId* member_counts = nullptr, bool merge_recursive = false, bool reassign = true, Int connected_component_depth = 0, int threads = 1);
+
+// Greedy vertex cover for edge sets that do not fit into memory. The edges are partitioned into buckets by node1,
+// bucket b holding the bucket_edges[b] edges with node1 in [b * bucket_size, (b + 1) * bucket_size). Runs of
+// consecutive buckets with up to max_edges edges in total are loaded together, and centroids are selected greedily
+// within each run, with runs processed in ascending order. Nodes without unassigned neighbors are left open until
+// the last run, so that a later run can still assign them as members. The cover depends on how the buckets are
+// split into runs: with a single run it equals the sequential in-memory algorithm (threads = 1, no connected
+// component depth), with several runs it generally differs from it.
+template<typename Int>
+std::vector<Int> greedy_vertex_cover_external(Int node_count, Int bucket_size, const std::vector<int64_t>& bucket_edges, int64_t max_edges, const std::function<std::vector<Edge<Int>>(int)>& load_bucket, const SuperBlockId* member_counts, bool merge_recursive, bool reassign, int threads);
 
 template<typename It, typename Out>
 size_t merge_capped(It i0, const It i1, It j0, const It j1, const size_t cap, Out out) {
@@ -19,8 +19,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ****/
 
 #include <algorithm>
+#include <atomic>
 #include <float.h>
+#include <numeric>
 #include <queue>
+#include <thread>
 #include "algo.h"
 #include "../log_stream.h"
 
@@ -30,6 +33,7 @@ using std::pair;
 using std::numeric_limits;
 using std::swap;
 using std::queue;
+using std::atomic;
 
 namespace Util { namespace Algo {
 
@@ -73,6 +77,14 @@ static Int neighbor_count(Int node, It begin, It end, const vector<Int>& centroi
 	return n;
 }
 
+template<typename Int, typename It>
+static bool has_open_neighbor(Int node, It begin, It end, const vector<Int>& centroids) {
+	for (It i = begin; i != end && i->node1 != -1; ++i)
+		if (i->node2 != node && centroids[i->node2] == -1)
+			return true;
+	return false;
+}
+
 template<typename Int>
 static void fix_assignment(vector<Int>& centroids) {
 	for (Int i = 0; i < (Int)centroids.size();) {
@@ -118,16 +130,25 @@ void make_cluster_cc(Int rep, FlatArray<Edge<Int>>& neighbors, vector<Int>& cent
 	}
 }
 
-template<typename Int>
-vector<Int> greedy_vertex_cover(FlatArray<Edge<Int>>& neighbors, const SuperBlockId* member_counts, bool merge_recursive, bool reassign, Int connected_component_depth) {
-	TaskTimer timer("Computing edge counts");
-	priority_queue<pair<Int, Int>> q;
-	vector<Int> centroids(neighbors.size(), -1);
-	for (Int i = 0; i < neighbors.size(); ++i)
-		q.emplace(member_counts ? neighbor_count(i, neighbors.cbegin(i), neighbors.cend(i), centroids, member_counts) :
-			(Int)neighbors.count(i), i);
+template<typename F>
+static void parallel_for(int64_t n, int threads, F f) {
+	vector<std::thread> t;
+	for (int i = 0; i < threads; ++i)
+		t.emplace_back([&f, n, threads, i] {
+			for (int64_t j = n * i / threads; j < n * (i + 1) / threads; ++j)
+				f(j);
+		});
+	for (auto& i : t)
+		i.join();
+}
+
+static void atomic_max(atomic<uint64_t>& a, uint64_t v) {
+	uint64_t c = a.load(std::memory_order_relaxed);
+	while (c < v && !a.compare_exchange_weak(c, v, std::memory_order_relaxed));
+}
 
-	timer.go("Computing vertex cover");
+template<typename Int>
+static void greedy_cover(FlatArray<Edge<Int>>& neighbors, const SuperBlockId* member_counts, bool merge_recursive, Int connected_component_depth, vector<Int>& centroids, priority_queue<pair<Int, Int>>& q) {
 	while (!q.empty()) {
 		const Int node = q.top().second;
 		q.pop();
@@ -144,6 +165,93 @@ vector<Int> greedy_vertex_cover(FlatArray<Edge<Int>>& neighbors, const SuperBloc
 				make_cluster_gvc(node, neighbors, centroids, merge_recursive);
 		}
 	}
+}
+
+// Selects centroids in synchronous rounds. Every unassigned node proposes itself and its unassigned neighbors
+// with a priority key of (neighbor count, node id), resolved by an atomic maximum. A node whose own claim is
+// not overruled becomes a centroid and receives the neighbors it won. The claims are independent of thread
+// scheduling, so the result is deterministic. The globally best node always wins its claim, so every round
+// makes progress. Once rounds stop resolving a meaningful fraction of the remaining nodes, the sequential
+// algorithm completes the cover.
+template<typename Int>
+static void greedy_cover_parallel(FlatArray<Edge<Int>>& neighbors, const SuperBlockId* member_counts, bool merge_recursive, vector<Int>& centroids, int threads) {
+	static const size_t MIN_PARALLEL_NODES = 65536;
+	static const size_t MIN_ROUND_FRACTION = 64;
+	const Int n = neighbors.size();
+	vector<Int> active(n);
+	std::iota(active.begin(), active.end(), 0);
+	vector<atomic<uint64_t>> claim(n);
+	vector<uint64_t> key(n);
+	vector<char> selected(n, 0);
+	auto make_key = [](uint64_t count, Int node) {
+		return (std::min(count + 1, (uint64_t)std::numeric_limits<uint32_t>::max()) << 32) | (uint64_t)node;
+	};
+	int rounds = 0;
+	while (active.size() >= MIN_PARALLEL_NODES) {
+		++rounds;
+		const int64_t m = (int64_t)active.size();
+		parallel_for(m, threads, [&](int64_t i) {
+			const Int node = active[i];
+			claim[node].store(0, std::memory_order_relaxed);
+			key[node] = make_key(member_counts ? neighbor_count(node, neighbors.cbegin(node), neighbors.cend(node), centroids, member_counts)
+				: neighbor_count2(neighbors.cbegin(node), neighbors.cend(node), centroids), node);
+			if (merge_recursive)
+				for (auto j = neighbors.cbegin(node); j != neighbors.cend(node); ++j)
+					if (centroids[j->node2] == j->node2)
+						claim[j->node2].store(0, std::memory_order_relaxed);
+		});
+		parallel_for(m, threads, [&](int64_t i) {
+			const Int node = active[i];
+			const uint64_t k = key[node];
+			atomic_max(claim[node], k);
+			for (auto j = neighbors.cbegin(node); j != neighbors.cend(node); ++j)
+				if (centroids[j->node2] == -1 || (merge_recursive && centroids[j->node2] == j->node2))
+					atomic_max(claim[j->node2], k);
+		});
+		parallel_for(m, threads, [&](int64_t i) {
+			const Int node = active[i];
+			selected[node] = claim[node].load(std::memory_order_relaxed) == key[node];
+		});
+		parallel_for(m, threads, [&](int64_t i) {
+			const Int node = active[i];
+			if (!selected[node])
+				return;
+			centroids[node] = node;
+			for (auto j = neighbors.cbegin(node); j != neighbors.cend(node); ++j)
+				if (j->node2 != node && claim[j->node2].load(std::memory_order_relaxed) == key[node])
+					centroids[j->node2] = node;
+		});
+		const auto end = std::remove_if(active.begin(), active.end(), [&centroids](Int node) { return centroids[node] != -1; });
+		const size_t resolved = active.end() - end;
+		active.erase(end, active.end());
+		if (resolved < (size_t)m / MIN_ROUND_FRACTION)
+			break;
+	}
+	log_stream << "Parallel vertex cover rounds: " << rounds << ", remaining nodes: " << active.size() << std::endl;
+
+	priority_queue<pair<Int, Int>> q;
+	for (Int node : active)
+		q.emplace(member_counts ? neighbor_count(node, neighbors.cbegin(node), neighbors.cend(node), centroids, member_counts)
+			: neighbor_count2(neighbors.cbegin(node), neighbors.cend(node), centroids), node);
+	greedy_cover(neighbors, member_counts, merge_recursive, (Int)0, centroids, q);
+}
+
+template<typename Int>
+vector<Int> greedy_vertex_cover(FlatArray<Edge<Int>>& neighbors, const SuperBlockId* member_counts, bool merge_recursive, bool reassign, Int connected_component_depth, int threads) {
+	TaskTimer timer("Computing edge counts");
+	vector<Int> centroids(neighbors.size(), -1);
+	if (threads > 1 && connected_component_depth == 0 && (uint64_t)neighbors.size() <= (uint64_t)std::numeric_limits<uint32_t>::max()) {
+		timer.go("Computing vertex cover");
+		greedy_cover_parallel(neighbors, member_counts, merge_recursive, centroids, threads);
+	}
+	else {
+		priority_queue<pair<Int, Int>> q;
+		for (Int i = 0; i < neighbors.size(); ++i)
+			q.emplace(member_counts ? neighbor_count(i, neighbors.cbegin(i), neighbors.cend(i), centroids, member_counts) :
+				(Int)neighbors.count(i), i);
+		timer.go("Computing vertex cover");
+		greedy_cover(neighbors, member_counts, merge_recursive, connected_component_depth, centroids, q);
+	}
 
 	if (reassign) {
 		timer.go("Computing reassignment");
@@ -165,7 +273,104 @@ vector<Int> greedy_vertex_cover(FlatArray<Edge<Int>>& neighbors, const SuperBloc
 	return centroids;
 }
 
-template vector<int32_t> greedy_vertex_cover<int32_t>(FlatArray<Edge<int32_t>>&, const SuperBlockId*, bool, bool, int32_t);
-template vector<int64_t> greedy_vertex_cover<int64_t>(FlatArray<Edge<int64_t>>&, const SuperBlockId*, bool, bool, int64_t);
+template vector<int32_t> greedy_vertex_cover<int32_t>(FlatArray<Edge<int32_t>>&, const SuperBlockId*, bool, bool, int32_t, int);
+template vector<int64_t> greedy_vertex_cover<int64_t>(FlatArray<Edge<int64_t>>&, const SuperBlockId*, bool, bool, int64_t, int);
+
+template<typename Int>
+vector<Int> greedy_vertex_cover_external(Int node_count, Int bucket_size, const vector<int64_t>& bucket_edges, int64_t max_edges, const std::function<vector<Edge<Int>>(int)>& load_bucket, const SuperBlockId* member_counts, bool merge_recursive, bool reassign, int threads) {
+	TaskTimer timer;
+	vector<Int> centroids(node_count, -1);
+	// Runs of consecutive buckets that are loaded together, given by their first bucket.
+	vector<int> runs;
+	const int bucket_count = (int)bucket_edges.size();
+	int64_t run_edges = 0;
+	for (int bucket = 0; bucket < bucket_count; ++bucket) {
+		if (bucket == 0 || run_edges + bucket_edges[bucket] > max_edges) {
+			runs.push_back(bucket);
+			run_edges = 0;
+		}
+		run_edges += bucket_edges[bucket];
+	}
+	runs.push_back(bucket_count);
+	log_stream << "External vertex cover: buckets=" << bucket_count << " runs=" << runs.size() - 1 << std::endl;
+	auto range = [&](size_t run) {
+		const Int begin = std::min((Int)runs[run] * bucket_size, node_count);
+		return std::make_pair(begin, std::min((Int)runs[run + 1] * bucket_size, node_count));
+	};
+	auto load = [&](size_t run) {
+		const Int begin = range(run).first, end = range(run).second;
+		vector<Edge<Int>> edges;
+		for (int bucket = runs[run]; bucket < runs[run + 1]; ++bucket) {
+			vector<Edge<Int>> v = load_bucket(bucket);
+			edges.insert(edges.end(), v.begin(), v.end());
+		}
+		for (Edge<Int>& e : edges)
+			e.node1 -= begin;
+		return make_flat_array_dense(std::move(edges), end - begin, threads, typename Edge<Int>::GetKey());
+	};
+
+	for (size_t run = 0; run < runs.size() - 1; ++run) {
+		Int begin, end;
+		std::tie(begin, end) = range(run);
+		const bool last_run = run == runs.size() - 2;
+		timer.go("Loading edges");
+		FlatArray<Edge<Int>> neighbors = load(run);
+		timer.go("Computing vertex cover");
+		priority_queue<pair<Int, Int>> q;
+		for (Int i = 0; i < end - begin; ++i)
+			if (centroids[begin + i] == -1)
+				q.emplace(member_counts ? neighbor_count(begin + i, neighbors.cbegin(i), neighbors.cend(i), centroids, member_counts) :
+					(Int)neighbors.count(i), i);
+		while (!q.empty()) {
+			const Int i = q.top().second, node = begin + i;
+			q.pop();
+			if (centroids[node] != -1)
+				continue;
+			const Int count = member_counts ? neighbor_count(node, neighbors.cbegin(i), neighbors.cend(i), centroids, member_counts) :
+				neighbor_count(neighbors.begin(i), neighbors.end(i), centroids);
+			if (!last_run && !has_open_neighbor(node, neighbors.cbegin(i), neighbors.cend(i), centroids))
+				continue;
+			if (!q.empty() && count < q.top().first)
+				q.emplace(count, i);
+			else {
+				centroids[node] = node;
+				for (auto j = neighbors.cbegin(i); j != neighbors.cend(i); ++j)
+					if (centroids[j->node2] == -1 || (merge_recursive && centroids[j->node2] == j->node2))
+						centroids[j->node2] = node;
+			}
+		}
+	}
+	for (Int node = 0; node < node_count; ++node)
+		if (centroids[node] == -1)
+			centroids[node] = node;
+
+	if (reassign) {
+		vector<double> weights(node_count, numeric_limits<double>::lowest());
+		for (size_t run = 0; run < runs.size() - 1; ++run) {
+			Int begin, end;
+			std::tie(begin, end) = range(run);
+			timer.go("Loading edges");
+			const FlatArray<Edge<Int>> neighbors = load(run);
+			timer.go("Computing reassignment");
+			for (Int i = 0; i < end - begin; ++i)
+				if (centroids[begin + i] == begin + i)
+					for (auto j = neighbors.cbegin(i); j != neighbors.cend(i); ++j)
+						if (centroids[j->node2] != j->node2 && j->weight > weights[j->node2]) {
+							weights[j->node2] = j->weight;
+							centroids[j->node2] = begin + i;
+						}
+		}
+	}
+
+	if (merge_recursive) {
+		timer.go("Computing merges");
+		fix_assignment(centroids);
+	}
+
+	return centroids;
+}
+
+template vector<int32_t> greedy_vertex_cover_external<int32_t>(int32_t, int32_t, const vector<int64_t>&, int64_t, const std::function<vector<Edge<int32_t>>(int)>&, const SuperBlockId*, bool, bool, int);
+template vector<int64_t> greedy_vertex_cover_external<int64_t>(int64_t, int64_t, const vector<int64_t>&, int64_t, const std::function<vector<Edge<int64_t>>(int)>&, const SuperBlockId*, bool, bool, int);
 
 }}
\ No newline at end of file
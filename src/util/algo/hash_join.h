@@ -29,6 +29,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../data_structures/hash_table.h"
 #include "../data_structures/double_array.h"
 #include "../math/integer.h"
+#include "../memory/memory_tracker.h"
 
 struct RelPtr
 {
@@ -212,11 +213,12 @@ std::pair<DoubleArray<typename _t::Value>, DoubleArray<typename _t::Value>> hash
 	const bool swap = config.hash_join_swap && R.n > S.n;
 	if (swap)
 		std::swap(R, S);
-	_t *buf_r = (_t*)malloc(sizeof(_t) * R.n), *buf_s = (_t*)malloc(sizeof(_t) * S.n);
+	_t *buf_r = (_t*)Util::Memory::allocate(Util::Memory::Tag::JOIN_BUFFERS, sizeof(_t) * R.n),
+		*buf_s = (_t*)Util::Memory::allocate(Util::Memory::Tag::JOIN_BUFFERS, sizeof(_t) * S.n);
 	DoubleArray<typename _t::Value> out_r((void*)R.data), out_s((void*)S.data);
 	hash_join(R, S, buf_r, buf_s, out_r, out_s, total_bits);
-	free(buf_r);
-	free(buf_s);
+	Util::Memory::deallocate(buf_r);
+	Util::Memory::deallocate(buf_s);
 	if (swap)
 		std::swap(out_r, out_s);
 	return { out_r, out_s };
@@ -25,7 +25,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../math/integer.h"
 
 template<typename _t, typename _get_key>
-void radix_sort(_t* begin, _t* end, uint32_t max_key, size_t threads) {
+void radix_sort(_t* begin, _t* end, uint64_t max_key, size_t threads) {
 	typedef typename _t::Key Key;
 	const size_t n = end - begin;
 	if (n <= 1)
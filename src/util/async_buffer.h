@@ -31,6 +31,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "io/temp_file.h"
 #include "io/input_file.h"
 #include "log_stream.h"
+#include "trace.h"
+#include "memory/memory_tracker.h"
 #include "../util/ptr_vector.h"
 #include "io/async_file.h"
 #include "io/input_stream_buffer.h"
@@ -42,7 +44,7 @@ template<typename T>
 struct AsyncBuffer
 {
 
-	typedef std::vector<T> Vector;
+	typedef std::vector<T, Util::Memory::TrackingAllocator<T, Util::Memory::Tag::SEED_HITS>> Vector;
 	using Key = typename SerializerTraits<T>::Key;
 	static const int64_t ENTRY_SIZE = (int64_t)sizeof(T);
 
@@ -126,6 +128,7 @@ struct AsyncBuffer
 	void load(int64_t max_size) {
 		max_size = std::max(max_size, (int64_t)1);
 		auto worker = [this](int end) {
+			Util::Trace::Span span("AsyncBuffer load");
 			for (; bins_processed_ < end; ++bins_processed_)
 				load_bin(*data_next_, bins_processed_);
 		};
@@ -142,19 +145,19 @@ struct AsyncBuffer
 		}
 		log_stream << "Async_buffer.load() " << size << "(" << (double)size * sizeof(T) / (1 << 30) << " GB, " << (double)disk_size / (1 << 30) << " GB on disk)" << std::endl;
 		total_disk_size_ += disk_size;
-		data_next_ = new std::vector<T>;
+		data_next_ = new Vector;
 		data_next_->reserve(size);
 		input_range_next_.first = begin(bins_processed_);
 		input_range_next_.second = this->end(end - 1);
 		load_worker_ = new std::thread(worker, end);
 	}
 
-	std::tuple<std::vector<T>*, Key, Key> retrieve() {
+	std::tuple<Vector*, Key, Key> retrieve() {
 		if (data_next_ != nullptr) {
 			load_worker_->join();
 			delete load_worker_;
 		}
-		return std::tuple<std::vector<T>*, Key, Key> { data_next_, input_range_next_.first, input_range_next_.second };
+		return std::tuple<Vector*, Key, Key> { data_next_, input_range_next_.first, input_range_next_.second };
 	}
 
 	int bins() const
@@ -166,13 +169,21 @@ struct AsyncBuffer
 		return total_disk_size_;
 	}
 
+	// Size of the bins on disk, before any bin has been loaded.
+	int64_t disk_size() {
+		int64_t n = 0;
+		for (int i = 0; i < bins_; ++i)
+			n += tmp_file_[i].tell();
+		return n;
+	}
+
 	int64_t bin_size(int i) const {
 		return count_[i];
 	}
 
 private:
 
-	void load_bin(std::vector<T> &out, size_t bin)
+	void load_bin(Vector &out, size_t bin)
 	{
 		InputFile f(tmp_file_[bin], InputStreamBuffer::ASYNC);
 		const size_t n = out.size();
@@ -193,7 +204,7 @@ private:
 	PtrVector<AsyncFile> tmp_file_;
 	std::atomic_size_t *count_;
 	std::pair<Key, Key> input_range_next_;
-	std::vector<T>* data_next_;
+	Vector* data_next_;
 	std::thread* load_worker_;
 
 };
\ No newline at end of file
@@ -92,6 +92,18 @@ struct BitVector {
 		return size_;
 	}
 
+	uint64_t* data() {
+		return data_.data();
+	}
+
+	const uint64_t* data() const {
+		return data_.data();
+	}
+
+	size_t word_count() const {
+		return data_.size();
+	}
+
 	std::vector<int64_t> negative_list() const {
 		std::vector<int64_t> v;
 		for (int64_t i = 0; i < size_; ++i)
@@ -1,5 +1,9 @@
 #pragma once
+#include <condition_variable>
+#include <map>
 #include <mutex>
+#include <vector>
+#include "../memory/memory_tracker.h"
 
 template<typename T, typename F>
 struct ReorderQueue
@@ -9,7 +13,8 @@ struct ReorderQueue
 		begin_(begin),
 		next_(begin),
 		size_(0),
-		max_size_(0)
+		max_size_(0),
+		size_limit_(0)
 	{}
 
 	size_t size() const
@@ -28,23 +33,32 @@ struct ReorderQueue
 		return begin_;
 	}
 
+	// Out of order values block while the backlog exceeds the limit (0 = unlimited). The value
+	// that is next in order is never blocked, so the backlog is always drained eventually.
+	void set_size_limit(size_t limit) {
+		size_limit_ = limit;
+	}
+
 	void push(size_t n, T value)
 	{
-		mtx_.lock();
+		std::unique_lock<std::mutex> lock(mtx_);
 		//cout << "n=" << n << " next=" << next_ << endl;
+		while (n != next_ && size_limit_ > 0 && size_ > size_limit_)
+			drained_.wait(lock);
 		if (n != next_) {
+			const size_t size = value ? value->alloc_size() : 0;
 			backlog_[n] = value;
-			size_ += value ? value->alloc_size() : 0;
+			size_ += size;
 			max_size_ = std::max(max_size_, size_);
-			mtx_.unlock();
+			Util::Memory::track(Util::Memory::Tag::OUTPUT_BACKLOG, (int64_t)size);
 		}
 		else
-			flush(value);
+			flush(value, lock);
 	}
 
 private:
 
-	void flush(T value)
+	void flush(T value, std::unique_lock<std::mutex>& lock)
 	{
 		size_t n = next_ + 1;
 		std::vector<T> out;
@@ -56,7 +70,7 @@ private:
 				backlog_.erase(i);
 				++n;
 			}
-			mtx_.unlock();
+			lock.unlock();
 			size_t size = 0;
 			for (typename std::vector<T>::iterator j = out.begin(); j < out.end(); ++j) {
 				if (*j) {
@@ -67,15 +81,18 @@ private:
 				}
 			}
 			out.clear();
-			mtx_.lock();
+			lock.lock();
 			size_ -= size;
+			Util::Memory::track(Util::Memory::Tag::OUTPUT_BACKLOG, -(int64_t)size);
 		} while ((i = backlog_.begin()) != backlog_.end() && i->first == n);
 		next_ = n;
-		mtx_.unlock();
+		lock.unlock();
+		drained_.notify_all();
 	}
 
 	std::mutex mtx_;
+	std::condition_variable drained_;
 	F& f_;
 	std::map<size_t, T> backlog_;
-	size_t begin_, next_, size_, max_size_;
-};
\ No newline at end of file
+	size_t begin_, next_, size_, max_size_, size_limit_;
+};
@@ -63,10 +63,24 @@ Deserializer& Deserializer::seek(int64_t pos)
 	return *this;
 }
 
-void Deserializer::seek_forward(size_t n)
+bool Deserializer::seek_forward(size_t n)
 {
-	buffer_->seek(n, SEEK_CUR);
-	begin_ = end_ = nullptr;
+	// File backed sources skip by seeking instead of reading the data. The file offset is only known to match the
+	// end of the current block once this deserializer has fetched one (data put back by the compression detection is
+	// not accounted for), otherwise the data is read and discarded.
+	if (n > avail() && end_ && buffer_ && buffer_->seekable() && buffer_->tell() > 0) {
+		const int64_t pos = buffer_->tell() - (int64_t)avail() + (int64_t)n;
+		if (pos > buffer_->file_size())
+			return false;
+		seek(pos);
+		return true;
+	}
+	do {
+		const size_t k = std::min(n, avail());
+		begin_ += k;
+		n -= k;
+	} while (n > 0 && buffer_ && fetch());
+	return n == 0;
 }
 
 size_t Deserializer::read_raw(char *ptr, size_t count)
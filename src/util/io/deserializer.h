@@ -40,7 +40,7 @@ struct Deserializer
 	Deserializer(StreamEntity* buffer);
 	void rewind();
 	Deserializer& seek(int64_t pos);
-	void seek_forward(size_t n);
+	bool seek_forward(size_t n);
 	bool seek_forward(char delimiter);
 	void close();
 
@@ -35,6 +35,7 @@ InputStreamBuffer::InputStreamBuffer(StreamEntity* prev, int flags) :
 	load_buf_((flags& ASYNC) != 0 ? new char[buf_size_] : nullptr),
 	putback_count_(0),
 	load_count_(0),
+	file_offset_(0),
 	async_((flags & ASYNC) != 0),
 	load_worker_(nullptr)
 {
@@ -27,6 +27,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <limits.h>
 #include <chrono>
 #include <stdint.h>
+#include "metrics.h"
+#include "trace.h"
+#include "status.h"
 
 struct MessageStream
 {
@@ -60,7 +63,8 @@ struct TaskTimer
 	TaskTimer(MessageStream& stream, unsigned level = 1) :
 		level_(level),
 		msg_(nullptr),
-		stream_(stream)
+		stream_(stream),
+		metrics_node_(-1)
 	{
 		start(nullptr);
 	}
@@ -70,7 +74,8 @@ struct TaskTimer
 	TaskTimer(const char* msg, MessageStream& stream, unsigned level = 1) :
 		level_(level),
 		msg_(msg),
-		stream_(stream)
+		stream_(stream),
+		metrics_node_(-1)
 	{
 		start(msg);
 	}
@@ -100,6 +105,10 @@ struct TaskTimer
 		if (!msg_ || level_ == UINT_MAX)
 			return;
 		stream_ << " [" << get() << "s]" << std::endl;
+		if (Util::Metrics::enabled)
+			Util::Metrics::phase_end(metrics_node_);
+		if (Util::Trace::enabled)
+			Util::Trace::complete(msg_, nanoseconds());
 		msg_ = 0;
 	}
 	double get()
@@ -127,7 +136,10 @@ private:
 		if (!msg)
 			return;
 		stream_ << msg << "... " << std::flush;
-
+		if (Util::Metrics::enabled)
+			metrics_node_ = Util::Metrics::phase_begin(msg);
+		if (Util::Status::enabled)
+			Util::Status::set_phase(msg);
 	}
 	MessageStream& get_stream() const
 	{
@@ -145,6 +157,7 @@ private:
 	unsigned level_;
 	const char *msg_;
 	MessageStream& stream_;
+	int metrics_node_;
 	std::chrono::high_resolution_clock::time_point t;
 };
 
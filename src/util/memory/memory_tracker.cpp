@@ -0,0 +1,108 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2024 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <buchfink@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#include <atomic>
+#include <limits>
+#include <new>
+#include <stdlib.h>
+#include "memory_tracker.h"
+#include "../log_stream.h"
+
+using std::endl;
+
+namespace Util { namespace Memory {
+
+const char* const TAG_NAMES[(int)Tag::COUNT] = { "seed_arrays", "join_buffers", "seed_hits", "query_block", "target_block", "dictionary", "output_backlog" };
+
+// Keeps the blocks returned by allocate aligned like those returned by malloc.
+static const size_t HEADER_SIZE = 16;
+
+static std::atomic<int64_t> current_[(int)Tag::COUNT], peak_[(int)Tag::COUNT];
+static std::atomic<int64_t> limit_(std::numeric_limits<int64_t>::max());
+
+static void update_peak(Tag tag, int64_t value) {
+	int64_t p = peak_[(int)tag].load(std::memory_order_relaxed);
+	while (value > p && !peak_[(int)tag].compare_exchange_weak(p, value, std::memory_order_relaxed));
+}
+
+void track(Tag tag, int64_t bytes) {
+	const int64_t c = current_[(int)tag].fetch_add(bytes, std::memory_order_relaxed) + bytes;
+	if (bytes > 0)
+		update_peak(tag, c);
+}
+
+void set(Tag tag, int64_t bytes) {
+	current_[(int)tag].store(bytes, std::memory_order_relaxed);
+	update_peak(tag, bytes);
+}
+
+int64_t current(Tag tag) {
+	return current_[(int)tag].load(std::memory_order_relaxed);
+}
+
+int64_t peak(Tag tag) {
+	return peak_[(int)tag].load(std::memory_order_relaxed);
+}
+
+int64_t total() {
+	int64_t n = 0;
+	for (int i = 0; i < (int)Tag::COUNT; ++i)
+		n += current_[i].load(std::memory_order_relaxed);
+	return n;
+}
+
+void set_limit(int64_t bytes) {
+	limit_ = bytes;
+}
+
+int64_t limit() {
+	return limit_;
+}
+
+int64_t available() {
+	return limit_ - total();
+}
+
+void log_peaks() {
+	log_stream << "Peak memory use by subsystem:";
+	for (int i = 0; i < (int)Tag::COUNT; ++i)
+		log_stream << ' ' << TAG_NAMES[i] << '=' << peak_[i];
+	log_stream << endl;
+}
+
+void* allocate(Tag tag, size_t n) {
+	char* p = (char*)malloc(n + HEADER_SIZE);
+	if (p == nullptr)
+		throw std::bad_alloc();
+	*(size_t*)p = n;
+	*(int*)(p + sizeof(size_t)) = (int)tag;
+	track(tag, (int64_t)n);
+	return p + HEADER_SIZE;
+}
+
+void deallocate(void* p) {
+	if (p == nullptr)
+		return;
+	char* q = (char*)p - HEADER_SIZE;
+	track((Tag)*(int*)(q + sizeof(size_t)), -(int64_t)*(size_t*)q);
+	free(q);
+}
+
+}}
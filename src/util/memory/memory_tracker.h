@@ -0,0 +1,89 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2024 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <buchfink@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+
+// Accounting of the memory used by the large data structures of a search, tagged by subsystem.
+// Memory is either allocated through the tracker (allocate/deallocate, TrackingAllocator) or, for
+// structures that manage their own storage, reported as a gauge (set). The tracked total is
+// compared against the memory limit to decide how much data may be loaded at once.
+
+namespace Util { namespace Memory {
+
+enum class Tag { SEED_ARRAYS, JOIN_BUFFERS, SEED_HITS, QUERY_BLOCK, TARGET_BLOCK, DICTIONARY, OUTPUT_BACKLOG, COUNT };
+
+extern const char* const TAG_NAMES[(int)Tag::COUNT];
+
+void track(Tag tag, int64_t bytes);
+void set(Tag tag, int64_t bytes);
+int64_t current(Tag tag);
+int64_t peak(Tag tag);
+int64_t total();
+void set_limit(int64_t bytes);
+int64_t limit();
+// Bytes left until the memory limit is reached (may be negative).
+int64_t available();
+void log_peaks();
+
+// Allocates raw memory charged to the tag. The size is stored in front of the block, so it has to be
+// freed using deallocate.
+void* allocate(Tag tag, size_t n);
+void deallocate(void* p);
+
+template<typename T, Tag tag>
+struct TrackingAllocator {
+
+	using value_type = T;
+
+	template<typename U>
+	struct rebind {
+		using other = TrackingAllocator<U, tag>;
+	};
+
+	TrackingAllocator() noexcept {}
+
+	template<typename U>
+	TrackingAllocator(const TrackingAllocator<U, tag>&) noexcept {}
+
+	T* allocate(size_t n) {
+		T* p = std::allocator<T>().allocate(n);
+		track(tag, (int64_t)(n * sizeof(T)));
+		return p;
+	}
+
+	void deallocate(T* p, size_t n) {
+		track(tag, -(int64_t)(n * sizeof(T)));
+		std::allocator<T>().deallocate(p, n);
+	}
+
+	bool operator==(const TrackingAllocator&) const {
+		return true;
+	}
+
+	bool operator!=(const TrackingAllocator&) const {
+		return false;
+	}
+
+};
+
+}}
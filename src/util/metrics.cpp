@@ -0,0 +1,220 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2024 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <buchfink@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <vector>
+#include "metrics.h"
+#include "../basic/statistics.h"
+#include "system/system.h"
+#include "system/perf_counters.h"
+#include "memory/memory_tracker.h"
+#include "log_stream.h"
+#include "string/string.h"
+
+using std::string;
+using std::vector;
+using std::tuple;
+using std::endl;
+using std::chrono::steady_clock;
+
+namespace Util { namespace Metrics {
+
+bool enabled = false;
+
+static const int CONTEXT_COUNT = (int)Context::COUNT;
+static const char* const CONTEXT_NAMES[] = { "query_block", "ref_block", "shape" };
+
+namespace {
+
+struct Node {
+	int parent;
+	string name;
+	int context[CONTEXT_COUNT];
+	double wall, cpu;
+	int64_t count;
+	uint64_t counters[PerfCounters::COUNT];
+	vector<int> children;
+};
+
+struct Instance {
+	int node;
+	steady_clock::time_point wall_begin;
+	std::clock_t cpu_begin;
+	uint64_t counters_begin[PerfCounters::COUNT];
+};
+
+}
+
+static string file_name;
+static std::thread::id main_thread;
+static vector<Node> nodes;
+static std::map<tuple<int, string, int, int, int>, int> node_index;
+static vector<Instance> stack;
+static int context[CONTEXT_COUNT];
+static stat_type counters[Statistics::COUNT];
+static bool has_counters = false;
+static bool perf_counters = false;
+
+void init(const string& file, bool perf) {
+	file_name = file;
+	enabled = !file.empty();
+	main_thread = std::this_thread::get_id();
+	std::fill(context, context + CONTEXT_COUNT, -1);
+	std::fill(counters, counters + Statistics::COUNT, (stat_type)0);
+	if (!perf)
+		return;
+	if (!enabled)
+		throw std::runtime_error("Option --perf-counters requires --metrics-file.");
+	perf_counters = PerfCounters::init();
+	if (!perf_counters)
+		message_stream << "Warning: hardware performance counters are not available (see /proc/sys/kernel/perf_event_paranoid)." << endl;
+}
+
+int phase_begin(const char* name) {
+	if (std::this_thread::get_id() != main_thread)
+		return -1;
+	const int parent = stack.empty() ? -1 : stack.back().node;
+	const auto key = std::make_tuple(parent, string(name), context[0], context[1], context[2]);
+	auto it = node_index.find(key);
+	int node;
+	if (it == node_index.end()) {
+		node = (int)nodes.size();
+		nodes.push_back({ parent, name, { context[0], context[1], context[2] }, 0.0, 0.0, 0, {}, {} });
+		if (parent >= 0)
+			nodes[parent].children.push_back(node);
+		node_index[key] = node;
+	}
+	else
+		node = it->second;
+	stack.push_back({ node, steady_clock::now(), std::clock(), {} });
+	if (perf_counters)
+		PerfCounters::read(stack.back().counters_begin);
+	return node;
+}
+
+// Timers are not always finished in reverse order of their creation. Phases that are still open
+// above the finished one are closed without being accounted.
+void phase_end(int node) {
+	if (node < 0)
+		return;
+	auto it = std::find_if(stack.rbegin(), stack.rend(), [node](const Instance& i) { return i.node == node; });
+	if (it == stack.rend())
+		return;
+	Node& n = nodes[node];
+	n.wall += std::chrono::duration<double>(steady_clock::now() - it->wall_begin).count();
+	n.cpu += (double)(std::clock() - it->cpu_begin) / CLOCKS_PER_SEC;
+	++n.count;
+	if (perf_counters) {
+		uint64_t c[PerfCounters::COUNT];
+		PerfCounters::read(c);
+		for (int i = 0; i < PerfCounters::COUNT; ++i)
+			n.counters[i] += c[i] - it->counters_begin[i];
+	}
+	stack.erase(std::prev(it.base()), stack.end());
+}
+
+void set_context(Context key, int value) {
+	if (enabled)
+		context[(int)key] = value;
+}
+
+// Counters of several search runs (e.g. cascaded clustering rounds) are summed up, the temporary
+// disk space is the maximum over the runs.
+void add_statistics(const Statistics& stats) {
+	if (!enabled)
+		return;
+	for (int i = 0; i < Statistics::COUNT; ++i)
+		if (i == Statistics::SEARCH_TEMP_SPACE)
+			counters[i] = std::max(counters[i], stats.data_[i]);
+		else
+			counters[i] += stats.data_[i];
+	has_counters = true;
+}
+
+static void write_node(std::ostream& out, int node, int indent) {
+	const Node& n = nodes[node];
+	const string pad(indent, '\t');
+	out << pad << "{\"name\": \"" << Util::String::json_escape(n.name) << "\", ";
+	for (int i = 0; i < CONTEXT_COUNT; ++i)
+		if (n.context[i] >= 0)
+			out << '"' << CONTEXT_NAMES[i] << "\": " << n.context[i] << ", ";
+	out << "\"count\": " << n.count << ", \"wall\": " << n.wall << ", \"cpu\": " << n.cpu << ", ";
+	if (perf_counters) {
+		out << "\"counters\": {";
+		bool first = true;
+		for (int i = 0; i < PerfCounters::COUNT; ++i)
+			if (PerfCounters::available(i)) {
+				out << (first ? "" : ", ") << '"' << PerfCounters::NAMES[i] << "\": " << n.counters[i];
+				first = false;
+			}
+		out << "}, ";
+	}
+	out << "\"children\": [";
+	for (size_t i = 0; i < n.children.size(); ++i) {
+		out << (i == 0 ? "\n" : ",\n");
+		write_node(out, n.children[i], indent + 1);
+	}
+	out << (n.children.empty() ? "" : "\n" + pad) << "]}";
+}
+
+void write(const string& error) {
+	if (!enabled)
+		return;
+	if (!has_counters)
+		add_statistics(statistics);
+	std::ofstream out(file_name);
+	if (!out)
+		throw std::runtime_error("Error opening metrics file: " + file_name);
+	out << "{" << endl << "\"phases\": [";
+	bool first = true;
+	for (int i = 0; i < (int)nodes.size(); ++i)
+		if (nodes[i].parent < 0) {
+			out << (first ? "\n" : ",\n");
+			write_node(out, i, 1);
+			first = false;
+		}
+	out << endl << "]," << endl << "\"statistics\": {";
+	for (int i = 0; i < Statistics::COUNT; ++i)
+		out << (i == 0 ? "\n" : ",\n") << "\t\"" << Statistics::name((Statistics::value)i) << "\": " << counters[i];
+	out << endl << "}," << endl;
+	out << "\"peak_rss\": " << getPeakRSS() << "," << endl;
+	out << "\"memory_peaks\": {";
+	for (int i = 0; i < (int)Memory::Tag::COUNT; ++i)
+		out << (i == 0 ? "" : ", ") << '"' << Memory::TAG_NAMES[i] << "\": " << Memory::peak((Memory::Tag)i);
+	out << "}," << endl;
+	out << "\"temp_disk_space\": " << counters[Statistics::SEARCH_TEMP_SPACE];
+	if (perf_counters)
+		out << ',' << endl << "\"counter_scope\": \"main thread and joined threads\"";
+	if (!error.empty())
+		out << ',' << endl << "\"error\": \"" << Util::String::json_escape(error) << '"';
+	out << endl;
+	out << "}" << endl;
+	if (!out)
+		throw std::runtime_error("Error writing metrics file: " + file_name);
+}
+
+}}
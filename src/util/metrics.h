@@ -0,0 +1,45 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2024 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <buchfink@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#pragma once
+#include <string>
+
+struct Statistics;
+
+// Machine-readable run metrics (--metrics-file). Phases are the messages of the TaskTimers of the
+// main thread, aggregated into a tree by their parent phase, name and the current query block,
+// reference block and shape. Nothing is recorded unless the metrics file is enabled. Optionally,
+// the hardware performance counters of every phase are recorded as well.
+
+namespace Util { namespace Metrics {
+
+enum class Context { QUERY_BLOCK, REF_BLOCK, SHAPE, COUNT };
+
+extern bool enabled;
+
+void init(const std::string& file_name, bool perf_counters);
+int phase_begin(const char* name);
+void phase_end(int node);
+void set_context(Context key, int value);
+void add_statistics(const Statistics& stats);
+// Writes the metrics file. After a failed run, the error message is included.
+void write(const std::string& error = std::string());
+
+}}
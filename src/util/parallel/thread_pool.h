@@ -28,6 +28,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <numeric>
 #include <functional>
 #include "../log_stream.h"
+#include "../trace.h"
 
 namespace Util { namespace Parallel {
 
@@ -161,7 +162,12 @@ struct ThreadPool {
 				}
 				if (!task) {
 					++default_started_;
-					if (!default_task_(*this))
+					bool more;
+					{
+						Util::Trace::Span span("Thread pool default task");
+						more = default_task_(*this);
+					}
+					if (!more)
 						run_default_ = false;
 					++default_finished_;
 					if (!run_default_ && default_started_ == default_finished_) {
@@ -183,7 +189,10 @@ struct ThreadPool {
 				task = pop_task(task_set ? task_set->priority : PRIORITY_COUNT - 1);
 			}
 
-			task.f();
+			{
+				Util::Trace::Span span("Thread pool task");
+				task.f();
+			}
 			if (task.task_set)
 				task.task_set->finish();
 		}
@@ -234,6 +243,10 @@ struct ThreadPool {
 		return tasks_[priority].size();
 	}
 
+	int64_t thread_count() const {
+		return (int64_t)workers_.size();
+	}
+
 private:
 
 	bool queue_empty(int priority = PRIORITY_COUNT - 1) {
@@ -264,3 +277,18 @@ private:
 	std::atomic<int64_t> default_started_, default_finished_, threads_finished_;
 
 };
+
+namespace Util { namespace Parallel {
+
+// Like scheduled_thread_pool_auto, but runs the workers as tasks of an existing thread pool, with the calling thread taking part.
+template<typename F, typename... Args>
+void thread_pool_tasks(ThreadPool& thread_pool, size_t partition_count, F f, Args... args) {
+	std::atomic<size_t> partition(0);
+	ThreadPool::TaskSet task_set(thread_pool, 0);
+	const int64_t n = thread_pool.thread_count() > 0 ? thread_pool.thread_count() : 1;
+	for (int64_t i = 0; i < n; ++i)
+		task_set.enqueue(pool_worker<F, Args...>, &partition, (size_t)i, partition_count, f, args...);
+	task_set.run();
+}
+
+}}
@@ -15,7 +15,10 @@ struct Profiler {
 
 	void finish() {
 		if (!key) return;
-		times[key] += timer.nanoseconds();
+		const int64_t t = timer.nanoseconds();
+		times[key] += t;
+		if (Util::Trace::enabled)
+			Util::Trace::complete(key, t);
 		key = nullptr;
 	}
 
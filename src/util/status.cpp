@@ -0,0 +1,191 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2024 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <buchfink@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include "status.h"
+#include "../basic/statistics.h"
+#include "system/system.h"
+#include "string/string.h"
+
+using std::string;
+using std::endl;
+using std::mutex;
+using std::chrono::steady_clock;
+
+namespace Util { namespace Status {
+
+bool enabled = false;
+
+namespace {
+
+struct Counters {
+	steady_clock::time_point time;
+	stat_type queries, dp_cells;
+};
+
+}
+
+static string file_name;
+static std::chrono::seconds interval;
+static std::thread::id main_thread;
+static std::thread* writer = nullptr;
+static mutex mtx;
+static std::condition_variable stop_signal;
+static bool stop = false;
+static const char* state = "running";
+static string phase;
+static int64_t query_block = -1, query_blocks = -1, work_done = 0, work_total = 0;
+static steady_clock::time_point work_start;
+static std::atomic<int64_t> temp_disk(0);
+
+// Counters are reset at the start of every search (e.g. in clustering rounds), so the totals are
+// accumulated from the differences between two updates.
+static stat_type diff(stat_type now, stat_type last) {
+	return now >= last ? now - last : now;
+}
+
+static Counters counters() {
+	return { steady_clock::now(), statistics.get_synchronized(Statistics::QUERIES_EXTENDED), statistics.get_synchronized(Statistics::GROSS_DP_CELLS) };
+}
+
+static double seconds(steady_clock::time_point t0, steady_clock::time_point t1) {
+	return std::chrono::duration<double>(t1 - t0).count();
+}
+
+// The ETA covers the whole run if the number of query blocks is known and the current query block
+// otherwise. Completed query blocks are assumed to have taken as long as the current one will.
+static void write(const Counters& now, const Counters& last, const Counters& total, steady_clock::time_point begin) {
+	std::unique_lock<mutex> lock(mtx);
+	const double dt = std::max(seconds(last.time, now.time), 1e-3), elapsed = seconds(begin, now.time);
+	double fraction = work_total > 0 ? (double)work_done / work_total : 0.0, eta = -1.0;
+	const bool run_scope = query_blocks > 0 && query_block >= 0;
+	if (run_scope)
+		fraction = (query_block + fraction) / query_blocks;
+	const double scope_elapsed = run_scope ? elapsed : seconds(work_start, now.time);
+	if (fraction > 0.0)
+		eta = scope_elapsed / fraction * (1.0 - fraction);
+	const string tmp_name = file_name + ".tmp";
+	{
+		std::ofstream out(tmp_name);
+		out << "{" << endl;
+		out << "\"state\": \"" << state << "\"," << endl;
+		out << "\"phase\": \"" << Util::String::json_escape(phase) << "\"," << endl;
+		out << "\"elapsed_seconds\": " << elapsed << "," << endl;
+		out << "\"query_block\": " << query_block << "," << endl;
+		out << "\"query_blocks\": " << query_blocks << "," << endl;
+		out << "\"work_units_completed\": " << work_done << "," << endl;
+		out << "\"work_units_total\": " << work_total << "," << endl;
+		out << "\"queries_per_second\": " << diff(now.queries, last.queries) / dt << "," << endl;
+		out << "\"queries_per_second_average\": " << total.queries / std::max(elapsed, 1e-3) << "," << endl;
+		out << "\"dp_cells_per_second\": " << diff(now.dp_cells, last.dp_cells) / dt << "," << endl;
+		out << "\"dp_cells_per_second_average\": " << total.dp_cells / std::max(elapsed, 1e-3) << "," << endl;
+		out << "\"temp_disk\": " << temp_disk << "," << endl;
+		out << "\"peak_rss\": " << getPeakRSS() << "," << endl;
+		out << "\"eta_scope\": \"" << (run_scope ? "run" : "query_block") << "\"," << endl;
+		out << "\"eta_seconds\": " << eta << endl;
+		out << "}" << endl;
+	}
+	std::rename(tmp_name.c_str(), file_name.c_str());
+}
+
+// The file is written once more after the stop signal, so that it always ends in the final state.
+static void writer_loop() {
+	Counters last = counters(), total{ last.time, 0, 0 };
+	std::unique_lock<mutex> lock(mtx);
+	for (bool done = false; !done;) {
+		if (!stop)
+			stop_signal.wait_for(lock, interval);
+		done = stop;
+		lock.unlock();
+		const Counters now = counters();
+		total.queries += diff(now.queries, last.queries);
+		total.dp_cells += diff(now.dp_cells, last.dp_cells);
+		write(now, last, total, total.time);
+		last = now;
+		lock.lock();
+	}
+}
+
+void init(const string& file, int seconds) {
+	if (file.empty())
+		return;
+	if (seconds <= 0)
+		throw std::runtime_error("Invalid value for --status-interval.");
+	file_name = file;
+	interval = std::chrono::seconds(seconds);
+	main_thread = std::this_thread::get_id();
+	work_start = steady_clock::now();
+	enabled = true;
+	writer = new std::thread(writer_loop);
+}
+
+void set_phase(const char* p) {
+	if (std::this_thread::get_id() != main_thread)
+		return;
+	std::lock_guard<mutex> lock(mtx);
+	phase = p;
+}
+
+void set_query_block(int64_t block, int64_t total) {
+	if (!enabled)
+		return;
+	std::lock_guard<mutex> lock(mtx);
+	query_block = block;
+	query_blocks = total;
+	work_done = work_total = 0;
+	work_start = steady_clock::now();
+}
+
+void set_work(int64_t done, int64_t total) {
+	if (!enabled)
+		return;
+	std::lock_guard<mutex> lock(mtx);
+	work_done = done;
+	work_total = total;
+}
+
+void set_temp_disk(int64_t bytes) {
+	temp_disk = bytes;
+}
+
+void finish(bool failed) {
+	if (!enabled)
+		return;
+	{
+		std::lock_guard<mutex> lock(mtx);
+		stop = true;
+		state = failed ? "failed" : "finished";
+		phase.clear();
+	}
+	stop_signal.notify_all();
+	writer->join();
+	delete writer;
+	writer = nullptr;
+	enabled = false;
+}
+
+}}
@@ -0,0 +1,42 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2024 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <buchfink@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#pragma once
+#include <stdint.h>
+#include <string>
+
+// Live status of a run (--status-file). A background thread periodically replaces the status file
+// by a JSON document with the current phase (the message of the last TaskTimer of the main thread),
+// the progress in work units (reference blocks of a query block), throughput and ETA.
+
+namespace Util { namespace Status {
+
+extern bool enabled;
+
+void init(const std::string& file_name, int interval);
+void set_phase(const char* phase);
+// Sets the current query block and the number of query blocks (-1 if not known in advance).
+void set_query_block(int64_t block, int64_t total);
+void set_work(int64_t done, int64_t total);
+void set_temp_disk(int64_t bytes);
+// Writes the final state (finished or failed) and stops the writer thread.
+void finish(bool failed = false);
+
+}}
@@ -85,4 +85,35 @@ int64_t interpret_number(const std::string& s) {
 	return int64_t(n * mult);
 }
 
+string json_escape(const string& s) {
+	string r;
+	for (char c : s)
+		switch (c) {
+		case '"':
+			r += "\\\"";
+			break;
+		case '\\':
+			r += "\\\\";
+			break;
+		case '\n':
+			r += "\\n";
+			break;
+		case '\r':
+			r += "\\r";
+			break;
+		case '\t':
+			r += "\\t";
+			break;
+		default:
+			if ((unsigned char)c < 0x20) {
+				char buf[8];
+				snprintf(buf, sizeof(buf), "\\u%04x", (unsigned)(unsigned char)c);
+				r += buf;
+			}
+			else
+				r += c;
+		}
+	return r;
+}
+
 }}
@@ -58,5 +58,7 @@ std::string replace(const std::string& s, char a, char b);
 std::string ratio_percentage(const double x, const double y);
 std::string ratio_percentage(const size_t x, const size_t y);
 int64_t interpret_number(const std::string& s);
+// Escapes a string for use inside a JSON string literal.
+std::string json_escape(const std::string& s);
 
 }}
@@ -0,0 +1,96 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2024 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <buchfink@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#include <algorithm>
+#include "perf_counters.h"
+#ifdef __linux__
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+namespace Util { namespace PerfCounters {
+
+const char* const NAMES[COUNT] = { "cycles", "instructions", "llc_misses", "dtlb_misses", "branch_misses" };
+
+static int fd[COUNT] = { -1, -1, -1, -1, -1 };
+
+#ifdef __linux__
+
+static int open_counter(uint32_t type, uint64_t config, int group_fd) {
+	perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	attr.disabled = group_fd == -1 ? 1 : 0;
+	attr.inherit = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+	return (int)syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+static uint64_t cache_event(uint64_t cache, uint64_t op, uint64_t result) {
+	return cache | (op << 8) | (result << 16);
+}
+
+bool init() {
+	fd[CYCLES] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1);
+	if (fd[CYCLES] == -1)
+		return false;
+	fd[INSTRUCTIONS] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, fd[CYCLES]);
+	fd[LLC_MISSES] = open_counter(PERF_TYPE_HW_CACHE, cache_event(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS), fd[CYCLES]);
+	fd[DTLB_MISSES] = open_counter(PERF_TYPE_HW_CACHE, cache_event(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS), fd[CYCLES]);
+	fd[BRANCH_MISSES] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, fd[CYCLES]);
+	ioctl(fd[CYCLES], PERF_EVENT_IOC_ENABLE, 0);
+	return true;
+}
+
+void read(uint64_t* values) {
+	for (int i = 0; i < COUNT; ++i) {
+		uint64_t buf[3];
+		if (fd[i] == -1 || ::read(fd[i], buf, sizeof(buf)) != sizeof(buf) || buf[2] == 0) {
+			values[i] = 0;
+			continue;
+		}
+		values[i] = buf[2] == buf[1] ? buf[0] : (uint64_t)((double)buf[0] * buf[1] / buf[2]);
+	}
+}
+
+#else
+
+bool init() {
+	return false;
+}
+
+void read(uint64_t* values) {
+	std::fill(values, values + COUNT, (uint64_t)0);
+}
+
+#endif
+
+bool available(int counter) {
+	return fd[counter] != -1;
+}
+
+}}
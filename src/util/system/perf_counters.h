@@ -0,0 +1,43 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2024 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <buchfink@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#pragma once
+#include <stdint.h>
+
+// Hardware performance counters (Linux perf_event_open). The counters are opened as one group on
+// the calling thread and are inherited by the threads it creates afterwards. The kernel only adds
+// the counts of an inherited thread to the group when that thread exits, so a reading covers the
+// calling thread and the threads that have been joined so far. Work of a thread that outlives a
+// phase (e.g. a thread pool that is shared by several phases) is credited to the phase that reads
+// the counters after the thread was joined, not to the phase that did the work.
+
+namespace Util { namespace PerfCounters {
+
+enum { CYCLES, INSTRUCTIONS, LLC_MISSES, DTLB_MISSES, BRANCH_MISSES, COUNT };
+
+extern const char* const NAMES[COUNT];
+
+// Returns false if no counter could be opened (unsupported platform, perf_event_paranoid etc.).
+bool init();
+bool available(int counter);
+// Reads the counter values scaled for multiplexing. Unavailable counters are set to zero.
+void read(uint64_t* values);
+
+}}
@@ -0,0 +1,150 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2024 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <buchfink@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+#include "trace.h"
+#include "string/string.h"
+
+using std::string;
+using std::vector;
+using std::unique_ptr;
+using std::endl;
+using std::chrono::steady_clock;
+
+namespace Util { namespace Trace {
+
+bool enabled = false;
+
+namespace {
+
+struct Event {
+	int64_t begin, duration;
+	char name[48];
+};
+
+struct Buffer {
+	static constexpr uint64_t CAPACITY = 1 << 14;
+	Buffer(int tid) :
+		tid(tid),
+		count(0),
+		events(CAPACITY)
+	{}
+	const int tid;
+	uint64_t count;
+	vector<Event> events;
+};
+
+}
+
+static string file_name;
+static steady_clock::time_point start;
+static std::mutex mtx;
+static vector<unique_ptr<Buffer>> buffers;
+static vector<Buffer*> free_buffers;
+
+namespace {
+
+// Returns the buffer of a thread to the free list when the thread exits. A thread started later
+// continues recording into it, so the number of buffers is bounded by the number of concurrently
+// running threads and the spans of successive threads share a track.
+struct BufferOwner {
+	~BufferOwner() {
+		if (!buffer)
+			return;
+		std::lock_guard<std::mutex> lock(mtx);
+		free_buffers.push_back(buffer);
+	}
+	Buffer* buffer = nullptr;
+};
+
+}
+
+static thread_local BufferOwner thread_buffer;
+
+// Buffers are owned by the global list since threads may exit before the trace is written. The
+// lock is only taken on the first span of a thread.
+static Buffer& get_buffer() {
+	if (!thread_buffer.buffer) {
+		std::lock_guard<std::mutex> lock(mtx);
+		if (free_buffers.empty()) {
+			buffers.emplace_back(new Buffer((int)buffers.size()));
+			thread_buffer.buffer = buffers.back().get();
+		}
+		else {
+			thread_buffer.buffer = free_buffers.back();
+			free_buffers.pop_back();
+		}
+	}
+	return *thread_buffer.buffer;
+}
+
+void init(const string& file) {
+	file_name = file;
+	enabled = !file.empty();
+	start = steady_clock::now();
+	if (enabled)
+		get_buffer();
+}
+
+void complete(const char* name, int64_t duration_ns) {
+	Buffer& b = get_buffer();
+	Event& e = b.events[b.count++ & (Buffer::CAPACITY - 1)];
+	e.duration = duration_ns;
+	e.begin = std::chrono::duration_cast<std::chrono::nanoseconds>(steady_clock::now() - start).count() - duration_ns;
+	strncpy(e.name, name, sizeof(e.name) - 1);
+	e.name[sizeof(e.name) - 1] = '\0';
+}
+
+// Must be called after all worker threads have finished.
+void write() {
+	if (!enabled)
+		return;
+	std::ofstream out(file_name);
+	if (!out)
+		throw std::runtime_error("Error opening trace file: " + file_name);
+	out << std::fixed << std::setprecision(3);
+	out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [" << endl;
+	uint64_t dropped = 0;
+	bool first = true;
+	for (const unique_ptr<Buffer>& b : buffers) {
+		out << (first ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": " << b->tid
+			<< ", \"args\": {\"name\": \"" << (b->tid == 0 ? string("main") : "thread " + std::to_string(b->tid)) << "\"}}";
+		first = false;
+		const uint64_t n = std::min(b->count, Buffer::CAPACITY);
+		dropped += b->count - n;
+		for (uint64_t i = b->count - n; i < b->count; ++i) {
+			const Event& e = b->events[i & (Buffer::CAPACITY - 1)];
+			out << ",\n{\"name\": \"" << Util::String::json_escape(e.name) << "\", \"ph\": \"X\", \"pid\": 0, \"tid\": " << b->tid
+				<< ", \"ts\": " << e.begin / 1000.0 << ", \"dur\": " << e.duration / 1000.0 << "}";
+		}
+	}
+	out << endl << "], \"otherData\": {\"dropped_events\": " << dropped << "}}" << endl;
+	if (!out)
+		throw std::runtime_error("Error writing trace file: " + file_name);
+}
+
+}}
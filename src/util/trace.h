@@ -0,0 +1,61 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2024 Max Planck Society for the Advancement of Science e.V.
+
+Code developed by Benjamin Buchfink <buchfink@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#pragma once
+#include <stdint.h>
+#include <chrono>
+#include <string>
+
+// Timeline of a run in Chrome trace event format (--trace-out), viewable in Perfetto or
+// chrome://tracing. Every thread records complete spans into its own ring buffer, so recording
+// does not synchronize between threads. Buffers of exited threads are reused by new threads. Only
+// the most recent spans are kept if a buffer overflows.
+
+namespace Util { namespace Trace {
+
+extern bool enabled;
+
+void init(const std::string& file_name);
+// Records a span with the given name that ends now.
+void complete(const char* name, int64_t duration_ns);
+void write();
+
+struct Span {
+
+	Span(const char* name) :
+		name_(enabled ? name : nullptr)
+	{
+		if (name_)
+			begin_ = std::chrono::steady_clock::now();
+	}
+
+	~Span() {
+		if (name_)
+			complete(name_, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin_).count());
+	}
+
+private:
+
+	const char* name_;
+	std::chrono::steady_clock::time_point begin_;
+
+};
+
+}}